@@ -0,0 +1,580 @@
+//
+//  Batch.h
+//  Modo em lote do exemplo_03: aplica uma cadeia de filtros (FilterChain.h)
+//  a muitos arquivos sem interação.
+//
+//  A entrada pode ser PPM ou qualquer formato da stb_image (ImageIO.h); a
+//  saída é sempre PPM, opcionalmente girada ou espelhada (Transform.h),
+//  redimensionada (Resize.h) e reduzida a poucas cores com difusão de erro
+//  (Dither.h) na mesma etapa dos filtros.
+//
+//  Os arquivos passam por três etapas ligadas por filas limitadas
+//  (Pipeline.h): leitura, filtros e gravação. Enquanto o arquivo N é
+//  filtrado, o N+1 já está sendo lido e o N-1 gravado, e disco e CPU
+//  trabalham ao mesmo tempo. Cada etapa tem seu número de threads; com uma
+//  só thread de filtro os filtros usam todas as threads do pool por faixas
+//  de linhas, com mais de uma cada arquivo é filtrado numa thread. No fim,
+//  a ocupação de cada etapa mostra qual delas é o gargalo.
+//
+//  Com --band cada arquivo é lido e gravado em faixas (PpmStream.h), nem
+//  uma imagem inteira precisa caber na memória, e "jobs" arquivos são
+//  processados ao mesmo tempo. Com --gpu a cadeia roda num shader
+//  (GpuFilters.h); o contexto GL é de uma thread só, então a etapa de
+//  filtros fica com uma thread, a que chamou runBatch.
+//
+//  Imagens e máscaras vêm de um ImagePool (ImageBuffer.h): com arquivos do
+//  mesmo tamanho, a partir do segundo nenhum buffer é alocado.
+//
+
+#ifndef Batch_h
+#define Batch_h
+
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <filesystem>
+#include <fstream>
+#include <iostream>
+#include <map>
+#include <mutex>
+#include <set>
+#include <string>
+#include <thread>
+#include <vector>
+#include <stdio.h>
+
+#include "PpmIO.h"
+#include "ImageIO.h"
+#include "FilterChain.h"
+#include "ThreadPool.h"
+#include "PpmStream.h"
+#include "GpuFilters.h"
+#include "Pipeline.h"
+#include "Resize.h"
+#include "Transform.h"
+#include "Dither.h"
+
+using namespace std;
+
+struct BatchOptions {
+    string spec;
+    string outDir;
+    vector<string> inputs;
+    unsigned int jobs = 0;  // threads de filtro (0 = 1; com --band, 0 = uma por thread de hardware)
+    unsigned int readers = 1, writers = 1; // threads das etapas de leitura e gravação
+    size_t queueDepth = 2;  // imagens esperando entre duas etapas
+    bool binary = true;     // P6 (padrão) ou P3
+    bool saveMask = false;  // grava <nome>_mask.pgm
+    int bandRows = 0;       // > 0: processa em faixas desta altura
+    bool gpu = false;       // filtra com GpuFilter em vez da CPU
+    int resizeWidth = 0, resizeHeight = 0; // --resize: 0 nos dois = sem redimensionar
+    ResizeFilter resizeFilter = RESIZE_LANCZOS3;
+    bool transform = false; // --transform: gira ou espelha antes do --resize
+    ImageTransform transformKind = TRANSFORM_ROTATE_90;
+    int colors = 0;         // --colors: > 0 reduz a esta paleta, por último
+    PaletteMethod paletteMethod = PALETTE_MEDIAN_CUT;
+    DitherMethod dither = DITHER_FLOYD_STEINBERG;
+};
+
+struct FileStats {
+    string path;
+    bool ok = false;
+    int width = 0, height = 0;
+    double readMs = 0, filterMs = 0, writeMs = 0;
+    size_t inBytes = 0, outBytes = 0;
+};
+
+// '*' e '?' sobre o nome do arquivo (sem '/').
+inline bool wildcardMatch(const char *pat, const char *name) {
+    if (*pat == '\0') return *name == '\0';
+    if (*pat == '*') {
+        for (const char *n = name; ; n++) {
+            if (wildcardMatch(pat + 1, n)) return true;
+            if (*n == '\0') return false;
+        }
+    }
+    if (*name == '\0') return false;
+    return (*pat == '?' || *pat == *name) && wildcardMatch(pat + 1, name + 1);
+}
+
+// Expande um argumento: diretório (todas as imagens, ver isImageExtension),
+// padrão com * ou ? no nome do arquivo, ou caminho simples. Os resultados de
+// cada padrão são ordenados.
+inline void expandInput(const string &arg, vector<string> &out) {
+    namespace fs = std::filesystem;
+    error_code ec;
+    fs::path p(arg);
+    if (fs::is_directory(p, ec)) {
+        vector<string> found;
+        for (const fs::directory_entry &e : fs::directory_iterator(p, ec)) {
+            if (e.is_regular_file(ec) && isImageExtension(e.path().extension().string())) {
+                found.push_back(e.path().string());
+            }
+        }
+        sort(found.begin(), found.end());
+        out.insert(out.end(), found.begin(), found.end());
+        return;
+    }
+    string pattern = p.filename().string();
+    if (pattern.find_first_of("*?") == string::npos) {
+        out.push_back(arg);
+        return;
+    }
+    fs::path dir = p.has_parent_path() ? p.parent_path() : fs::path(".");
+    vector<string> found;
+    for (const fs::directory_entry &e : fs::directory_iterator(dir, ec)) {
+        if (e.is_regular_file(ec) && wildcardMatch(pattern.c_str(), e.path().filename().string().c_str())) {
+            found.push_back(e.path().string());
+        }
+    }
+    if (found.empty()) cerr << "Nenhum arquivo para " << arg << endl;
+    sort(found.begin(), found.end());
+    out.insert(out.end(), found.begin(), found.end());
+}
+
+// Lista de caminhos, um por linha (linhas vazias e # são ignoradas).
+inline bool readInputList(const string &listFile, vector<string> &out) {
+    ifstream arq(listFile);
+    if (!arq) return false;
+    string line;
+    while (getline(arq, line)) {
+        while (!line.empty() && (line.back() == '\r' || line.back() == ' ')) line.pop_back();
+        if (!line.empty() && line[0] != '#') expandInput(line, out);
+    }
+    return true;
+}
+
+inline double msSince(chrono::steady_clock::time_point t0) {
+    return chrono::duration<double, milli>(chrono::steady_clock::now() - t0).count();
+}
+
+inline string batchOutputPath(const BatchOptions &opt, const string &input, const string &suffix) {
+    namespace fs = std::filesystem;
+    fs::path name = fs::path(input).stem();
+    return (fs::path(opt.outDir) / (name.string() + suffix)).string();
+}
+
+// Duas entradas com o mesmo nome (x.png e x.jpg, ou x.ppm de pastas
+// diferentes) iriam para a mesma saída, gravadas ao mesmo tempo por threads
+// diferentes, e uma sumiria; uma saída que é uma entrada (ela mesma ou
+// outra) seria sobrescrita. false (com a mensagem) nesses casos.
+inline bool checkOutputPaths(const BatchOptions &opt) {
+    namespace fs = std::filesystem;
+    map<string, string> outputs; // saída normalizada -> entrada
+    set<string> inputs;
+    for (const string &input : opt.inputs) inputs.insert(fs::absolute(input).lexically_normal().string());
+    for (const string &input : opt.inputs) {
+        string out = fs::absolute(batchOutputPath(opt, input, ".ppm")).lexically_normal().string();
+        auto [it, fresh] = outputs.emplace(out, input);
+        if (!fresh) {
+            cerr << input << " e " << it->second << " seriam gravados no mesmo arquivo " << out << endl;
+            return false;
+        }
+        if (inputs.count(out)) {
+            cerr << input << ": a saída " << out << " sobrescreveria uma entrada" << endl;
+            return false;
+        }
+    }
+    return true;
+}
+
+// Um arquivo a caminho entre as etapas: a imagem lida (e depois filtrada) e
+// a máscara. valid fica false se uma etapa falhar; as seguintes só o
+// repassam.
+struct BatchItem {
+    FileStats st;
+    string output;
+    ImageBuffer image;
+    ImageBuffer mask;
+    bool valid = false;
+};
+
+// Leitura: o arquivo (PPM ou outro formato da stb_image) vai para um buffer
+// do pool. loadThreads: threads do leitor P3.
+inline BatchItem decodeFile(const BatchOptions &opt, const string &input, unsigned int loadThreads) {
+    namespace fs = std::filesystem;
+    BatchItem item;
+    item.st.path = input;
+    item.output = batchOutputPath(opt, input, ".ppm");
+    error_code ec;
+    if (fs::equivalent(input, item.output, ec)) {
+        cerr << input << ": a saída sobrescreveria a entrada" << endl;
+        return item;
+    }
+    auto t0 = chrono::steady_clock::now();
+    if (!loadImage(input, item.image, loadThreads)) return item;
+    item.valid = true;
+    item.st.inBytes = (size_t)fs::file_size(input, ec);
+    item.st.width = item.image.getWidth();
+    item.st.height = item.image.getHeight();
+    item.st.readMs = msSince(t0);
+    return item;
+}
+
+// Filtros: chain.apply ou, com gpu, o shader equivalente; depois, com
+// --transform e --resize, imagem e máscara são giradas e vão para o tamanho
+// final; com --colors a imagem final é reduzida à sua paleta.
+inline void filterItem(const BatchOptions &opt, const FilterChain &chain, BatchItem &item,
+                       GpuFilter *gpu = nullptr) {
+    if (!item.valid) return;
+    int w = item.st.width, h = item.st.height;
+    if (opt.saveMask) item.mask = ImagePool::shared().acquire(w, h, 1);
+    auto t0 = chrono::steady_clock::now();
+    if (gpu) {
+        item.valid = gpu->apply(item.image.data(), w, h, item.mask.data());
+    } else {
+        chain.apply(item.image.data(), w, h, item.mask.data());
+    }
+    if (item.valid && opt.transform) {
+        transformBuffer(item.image, opt.transformKind);
+        if (opt.saveMask) transformBuffer(item.mask, opt.transformKind);
+        if (transformSwapsAxes(opt.transformKind)) swap(w, h);
+        item.st.width = w;
+        item.st.height = h;
+    }
+    int dw = opt.resizeWidth, dh = opt.resizeHeight;
+    if (item.valid && resizeTarget(w, h, dw, dh)) {
+        resizeBuffer(item.image, dw, dh, opt.resizeFilter);
+        if (opt.saveMask) resizeBuffer(item.mask, dw, dh, opt.resizeFilter);
+        item.st.width = dw;
+        item.st.height = dh;
+    }
+    if (item.valid && opt.colors > 0) {
+        int fw = item.st.width, fh = item.st.height;
+        Palette pal = buildPalette(item.image.data(), (size_t)fw * fh, opt.colors, opt.paletteMethod);
+        ditherImage(item.image.data(), fw, fh, pal, opt.dither);
+    }
+    item.st.filterMs = msSince(t0);
+}
+
+// Gravação: imagem e máscara vão para o disco e os buffers voltam ao pool.
+inline void encodeItem(const BatchOptions &opt, BatchItem &item) {
+    namespace fs = std::filesystem;
+    if (item.valid) {
+        int w = item.st.width, h = item.st.height;
+        auto t0 = chrono::steady_clock::now();
+        item.st.ok = savePPM(item.output, item.image.data(), w, h, opt.binary);
+        if (item.st.ok && opt.saveMask) {
+            item.st.ok = savePGM(batchOutputPath(opt, item.st.path, "_mask.pgm"), item.mask.data(), w, h);
+        }
+        item.st.writeMs = msSince(t0);
+        error_code ec;
+        item.st.outBytes = (size_t)fs::file_size(item.output, ec);
+    }
+    item.image.release();
+    item.mask.release();
+}
+
+// Lê, filtra e grava um arquivo, uma etapa depois da outra (com --band, em
+// faixas). gpu (opcional): filtra na GPU em vez de chain.apply.
+inline FileStats processFile(const BatchOptions &opt, const FilterChain &chain, const string &input,
+                             unsigned int loadThreads, GpuFilter *gpu = nullptr) {
+    namespace fs = std::filesystem;
+    if (opt.bandRows <= 0) {
+        BatchItem item = decodeFile(opt, input, loadThreads);
+        filterItem(opt, chain, item, gpu);
+        encodeItem(opt, item);
+        return item.st;
+    }
+    FileStats st;
+    st.path = input;
+    string output = batchOutputPath(opt, input, ".ppm");
+    error_code ec;
+    if (fs::equivalent(input, output, ec)) {
+        cerr << input << ": a saída sobrescreveria a entrada" << endl;
+        return st;
+    }
+    // leitura, filtro e gravação se sobrepõem; o tempo todo fica em filterMs
+    auto t0 = chrono::steady_clock::now();
+    string maskPath = opt.saveMask ? batchOutputPath(opt, input, "_mask.pgm") : "";
+    st.ok = streamFilter(input, output, chain, opt.bandRows, opt.binary, maskPath, &st.width, &st.height);
+    st.filterMs = msSince(t0);
+    st.inBytes = (size_t)fs::file_size(input, ec);
+    st.outBytes = (size_t)fs::file_size(output, ec);
+    return st;
+}
+
+// Leitura -> filtros -> gravação, com no máximo opt.queueDepth imagens
+// esperando entre duas etapas. stages: leitura, filtros e gravação, com o
+// número de threads de cada uma. A etapa de filtros roda num ThreadPool
+// próprio: com uma thread ela é a que chamou (a do contexto GL, com gpu) e
+// os filtros usam o pool compartilhado; com mais, cada thread filtra um
+// arquivo sozinha. report(st) é chamado na gravação, arquivo a arquivo.
+template <typename Report>
+void runPipeline(const BatchOptions &opt, const FilterChain &chain, GpuFilter *gpu, StageStats *stages,
+                 Report report) {
+    size_t count = opt.inputs.size();
+    unsigned int readers = stages[0].threads, filters = stages[1].threads, writers = stages[2].threads;
+    BoundedQueue<BatchItem> decoded(opt.queueDepth, readers);
+    BoundedQueue<BatchItem> filtered(opt.queueDepth, filters);
+    unsigned int hw = thread::hardware_concurrency();
+    unsigned int loadThreads = hw > readers ? hw / readers : 1;
+    atomic<size_t> next{0};
+
+    auto readStage = [&]() {
+        StageTimer t;
+        size_t i;
+        while ((i = next.fetch_add(1)) < count) {
+            BatchItem item = decodeFile(opt, opt.inputs[i], loadThreads);
+            t.count++;
+            t.lap(t.busy);
+            decoded.push(std::move(item));
+            t.lap(t.outputWait);
+        }
+        decoded.producerDone();
+        t.report(stages[0]);
+    };
+    auto filterStage = [&](size_t) {
+        StageTimer t;
+        BatchItem item;
+        while (decoded.pop(item)) {
+            t.lap(t.inputWait);
+            filterItem(opt, chain, item, gpu);
+            t.count++;
+            t.lap(t.busy);
+            filtered.push(std::move(item));
+            t.lap(t.outputWait);
+        }
+        t.lap(t.inputWait);
+        filtered.producerDone();
+        t.report(stages[1]);
+    };
+    auto writeStage = [&]() {
+        StageTimer t;
+        BatchItem item;
+        while (filtered.pop(item)) {
+            t.lap(t.inputWait);
+            encodeItem(opt, item);
+            report(item.st);
+            t.count++;
+            t.lap(t.busy);
+        }
+        t.lap(t.inputWait);
+        t.report(stages[2]);
+    };
+
+    vector<thread> io;
+    for (unsigned int i = 0; i < readers; i++) io.emplace_back(readStage);
+    for (unsigned int i = 0; i < writers; i++) io.emplace_back(writeStage);
+    ThreadPool filterThreads(filters);
+    filterThreads.run(filters, filterStage);
+    for (thread &th : io) th.join();
+}
+
+inline void printFileStats(const FileStats &st) {
+    double ms = st.readMs + st.filterMs + st.writeMs;
+    double mp = (double)st.width * st.height / 1e6;
+    printf("%-40s %5dx%-5d lê %8.2f ms  filtra %8.2f ms  grava %8.2f ms  %8.1f MP/s\n",
+           st.path.c_str(), st.width, st.height, st.readMs, st.filterMs, st.writeMs, mp / (ms * 1e-3));
+}
+
+// Ocupação de cada etapa e a mais ocupada, que limita a vazão do conjunto.
+inline void printStageStats(const StageStats *stages, size_t n, double wallMs) {
+    size_t worst = 0;
+    for (size_t i = 0; i < n; i++) {
+        const StageStats &s = stages[i];
+        double total = s.threads * wallMs;
+        printf("Etapa %s (%u thread(s)): trabalhando %5.1f%%, esperando entrada %5.1f%%, esperando a seguinte %5.1f%%\n",
+               s.name.c_str(), s.threads, 100 * s.busyMs / total, 100 * s.inputWaitMs / total,
+               100 * s.outputWaitMs / total);
+        if (s.utilization(wallMs) > stages[worst].utilization(wallMs)) worst = i;
+    }
+    const StageStats &b = stages[worst];
+    double alone = b.busyMs > 0 ? b.items / (b.busyMs / b.threads * 1e-3) : 0;
+    printf("Gargalo: %s (sozinha, no máximo %.1f arquivos/s com %u thread(s))\n", b.name.c_str(), alone, b.threads);
+}
+
+// Processa todos os arquivos; devolve o número de falhas.
+inline size_t runBatch(const BatchOptions &opt, const FilterChain &chain) {
+    namespace fs = std::filesystem;
+    error_code ec;
+    fs::create_directories(opt.outDir, ec);
+
+    GpuFilter gpu;
+    bool useGpu = false;
+    if (opt.gpu) {
+        string error;
+        useGpu = gpu.init(chain, error);
+        if (useGpu) {
+            printf("GPU: %s\n", GpuContext::renderer().c_str());
+        } else {
+            cerr << "GPU indisponível (" << error << "), usando a CPU" << endl;
+        }
+    }
+
+    size_t count = opt.inputs.size();
+    auto limit = [count](unsigned int n) { return (unsigned int)max<size_t>(1, min<size_t>(n, count)); };
+
+    mutex printMtx;
+    size_t failures = 0, pixels = 0, inBytes = 0, outBytes = 0;
+    double readMs = 0, filterMs = 0, writeMs = 0;
+    auto report = [&](const FileStats &st) {
+        lock_guard<mutex> lock(printMtx);
+        if (!st.ok) {
+            failures++;
+            printf("%-40s FALHOU\n", st.path.c_str());
+            return;
+        }
+        printFileStats(st);
+        pixels += (size_t)st.width * st.height;
+        inBytes += st.inBytes;
+        outBytes += st.outBytes;
+        readMs += st.readMs;
+        filterMs += st.filterMs;
+        writeMs += st.writeMs;
+    };
+
+    auto t0 = chrono::steady_clock::now();
+    unsigned int jobs = 0;
+    StageStats stages[3] = {{"leitura", limit(opt.readers)},
+                            {"filtros", limit(useGpu ? 1 : max(opt.jobs, 1u))},
+                            {"gravação", limit(opt.writers)}};
+    if (opt.bandRows > 0) {
+        jobs = limit(opt.jobs ? opt.jobs : thread::hardware_concurrency());
+        ThreadPool files(jobs);
+        files.run(count, [&](size_t i) { report(processFile(opt, chain, opt.inputs[i], 1)); });
+    } else {
+        runPipeline(opt, chain, useGpu ? &gpu : nullptr, stages, report);
+    }
+
+    double wall = msSince(t0);
+    size_t done = count - failures;
+    printf("Total: %zu arquivo(s), %zu falha(s), %.2f s, %.1f arquivos/s, %.1f MP/s, %.1f MB/s lidos, %.1f MB/s gravados\n",
+           done, failures, wall * 1e-3, done / (wall * 1e-3), pixels / 1e6 / (wall * 1e-3),
+           inBytes / 1e6 / (wall * 1e-3), outBytes / 1e6 / (wall * 1e-3));
+    if (opt.bandRows > 0) {
+        printf("Tempo somado: %.0f ms em faixas (%u arquivo(s) em paralelo)\n", filterMs, jobs);
+        return failures;
+    }
+    printf("Tempo somado por etapa: leitura %.0f ms, filtros %.0f ms (%s), gravação %.0f ms\n", readMs, filterMs,
+           useGpu ? "GPU" : "CPU", writeMs);
+    printStageStats(stages, 3, wall);
+    printf("Buffers: %zu alocado(s), %zu reaproveitado(s)\n", ImagePool::shared().allocations(),
+           ImagePool::shared().reuses());
+    return failures;
+}
+
+inline void batchUsage(const char *prog) {
+    cout << "Uso: " << prog << " -f \"cadeia\" -o pasta_saida [-j N] [--stages L,F,G] [--queue N] [--transform T] [--resize LxA[,filtro]] [--colors N[,método]] [--dither D] [--p3] [--mask] [--band linhas] [--gpu] [-l lista.txt] arquivos..." << endl
+         << "  -f     cadeia de filtros (pode faltar com --colors), ex.: \"grayscale | colorize(40,0,80) | negative\", \"blur(2) | lut3d(filme.cube)\"" << endl
+         << "         ou \"huesat(30,1.2) | tint(200,0.5)\"" << endl
+         << "  -o     pasta onde as imagens filtradas são gravadas" << endl
+         << "  -j     arquivos filtrados ao mesmo tempo (padrão: 1, com todas as threads; com --band, arquivos" << endl
+         << "         processados ao mesmo tempo, padrão: número de threads)" << endl
+         << "  --stages threads de leitura, filtros e gravação, ex.: 2,1,2 (padrão: 1,1,1; F é o mesmo que -j)" << endl
+         << "  --queue  imagens que podem esperar entre duas etapas (padrão: 2)" << endl
+         << "  --transform gira ou espelha depois dos filtros: rot90, rot180, rot270, transpose, transverse," << endl
+         << "         fliph ou flipv" << endl
+         << "  --resize redimensiona depois dos filtros, ex.: 320x180 ou 320x0 (mantém a proporção);" << endl
+         << "         filtro box, bilinear ou lanczos3 (padrão), ex.: 1280x720,bilinear" << endl
+         << "  --colors reduz a N cores (2..256) por último, com paleta por mediancut (padrão) ou kmeans," << endl
+         << "         ex.: 16 ou 16,kmeans" << endl
+         << "  --dither difusão de erro do --colors: fs (Floyd-Steinberg, padrão), atkinson ou none" << endl
+         << "  --p3   grava P3 em texto em vez de P6" << endl
+         << "  --mask grava também a máscara do chroma-key (<nome>_mask.pgm)" << endl
+         << "  --band processa em faixas de N linhas, sem carregar a imagem inteira (só PPM; sem autolevels/equalize/blur/--transform/--resize/--colors)" << endl
+         << "  --gpu  filtra na GPU (shader num framebuffer fora da tela); não combina com --band" << endl
+         << "  -l     arquivo com um caminho por linha" << endl
+         << "  arquivos (PPM, PNG, JPEG, TGA ou BMP) podem ser caminhos, pastas ou padrões como quadros/*.png" << endl;
+}
+
+// "LxA" ou "LxA,filtro"; um dos lados pode ser 0 (segue a proporção).
+inline bool parseResizeArg(const string &arg, BatchOptions &opt) {
+    size_t comma = arg.find(',');
+    if (comma != string::npos && !parseResizeFilter(arg.substr(comma + 1), opt.resizeFilter)) return false;
+    int w = -1, h = -1;
+    char extra;
+    if (sscanf(arg.substr(0, comma).c_str(), "%dx%d%c", &w, &h, &extra) != 2) return false;
+    if (w < 0 || h < 0 || (w == 0 && h == 0) || w > 65535 || h > 65535) return false;
+    opt.resizeWidth = w;
+    opt.resizeHeight = h;
+    return true;
+}
+
+// "N" ou "N,método" (mediancut ou kmeans), N de 2 a 256.
+inline bool parseColorsArg(const string &arg, BatchOptions &opt) {
+    size_t comma = arg.find(',');
+    if (comma != string::npos && !parsePaletteMethod(arg.substr(comma + 1), opt.paletteMethod)) return false;
+    int n = -1;
+    char extra;
+    if (sscanf(arg.substr(0, comma).c_str(), "%d%c", &n, &extra) != 1 || n < 2 || n > 256) return false;
+    opt.colors = n;
+    return true;
+}
+
+// Interpreta a linha de comando; false se estiver incompleta ou inválida.
+inline bool parseBatchArgs(int argc, char **argv, BatchOptions &opt) {
+    for (int i = 1; i < argc; i++) {
+        string a = argv[i];
+        bool hasValue = i + 1 < argc;
+        if (a == "-f" && hasValue) {
+            opt.spec = argv[++i];
+        } else if (a == "-o" && hasValue) {
+            opt.outDir = argv[++i];
+        } else if (a == "-j" && hasValue) {
+            int j = atoi(argv[++i]);
+            if (j <= 0) return false;
+            opt.jobs = (unsigned int)j;
+        } else if (a == "--stages" && hasValue) {
+            int r = 0, f = 0, w = 0;
+            if (sscanf(argv[++i], "%d,%d,%d", &r, &f, &w) != 3 || r <= 0 || f <= 0 || w <= 0) return false;
+            opt.readers = (unsigned int)r;
+            opt.jobs = (unsigned int)f;
+            opt.writers = (unsigned int)w;
+        } else if (a == "--queue" && hasValue) {
+            int q = atoi(argv[++i]);
+            if (q <= 0) return false;
+            opt.queueDepth = (size_t)q;
+        } else if (a == "-l" && hasValue) {
+            if (!readInputList(argv[++i], opt.inputs)) {
+                cerr << "Não foi possível ler a lista " << argv[i] << endl;
+                return false;
+            }
+        } else if (a == "--band" && hasValue) {
+            opt.bandRows = atoi(argv[++i]);
+            if (opt.bandRows <= 0) return false;
+        } else if (a == "--transform" && hasValue) {
+            if (!parseImageTransform(argv[++i], opt.transformKind)) return false;
+            opt.transform = true;
+        } else if (a == "--resize" && hasValue) {
+            if (!parseResizeArg(argv[++i], opt)) return false;
+        } else if (a == "--colors" && hasValue) {
+            if (!parseColorsArg(argv[++i], opt)) return false;
+        } else if (a == "--dither" && hasValue) {
+            if (!parseDitherMethod(argv[++i], opt.dither)) return false;
+        } else if (a == "--p3") {
+            opt.binary = false;
+        } else if (a == "--mask") {
+            opt.saveMask = true;
+        } else if (a == "--gpu") {
+            opt.gpu = true;
+        } else if (!a.empty() && a[0] == '-') {
+            return false;
+        } else {
+            expandInput(a, opt.inputs);
+        }
+    }
+    if (opt.bandRows > 0 && (opt.gpu || opt.transform || opt.resizeWidth > 0 || opt.resizeHeight > 0 || opt.colors > 0)) {
+        return false;
+    }
+    return (!opt.spec.empty() || opt.colors > 0) && !opt.outDir.empty() && !opt.inputs.empty() &&
+           checkOutputPaths(opt);
+}
+
+inline int batchMain(int argc, char **argv) {
+    BatchOptions opt;
+    if (!parseBatchArgs(argc, argv, opt)) {
+        batchUsage(argv[0]);
+        return EXIT_FAILURE;
+    }
+    FilterChain chain;
+    string error;
+    // só --colors: cadeia vazia
+    if (!opt.spec.empty() && !chain.parse(opt.spec, error)) {
+        cerr << "Cadeia inválida: " << error << endl;
+        return EXIT_FAILURE;
+    }
+    return runBatch(opt, chain) == 0 ? EXIT_SUCCESS : EXIT_FAILURE;
+}
+
+#endif /* Batch_h */
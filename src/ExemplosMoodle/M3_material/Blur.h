@@ -0,0 +1,269 @@
+//
+//  Blur.h
+//  Desfoque gaussiano e de caixa separáveis, com raio arbitrário.
+//
+//  O filtro 2D vira duas convoluções 1D com os mesmos 2r+1 pesos: uma
+//  horizontal, linha a linha, e uma vertical. As duas usam o mesmo kernel,
+//  out[i] = soma de w[k] * taps[k][i]: na vertical taps[k] é a linha y+k-r;
+//  na horizontal é a própria linha deslocada de k-r pixels (numa cópia com
+//  as bordas replicadas), e os canais intercalados são tratados juntos,
+//  sem separar R, G e B.
+//
+//  Pesos em Q14 com soma exata 1 << 14: cada par de taps vira um madd_epi16
+//  (dois produtos de 16 bits somados em 32), e o resultado é o mesmo em
+//  todos os níveis SIMD e na versão escalar.
+//
+//  O custo da convolução cresce com o raio. O desfoque de caixa com raio a
+//  partir de BOX_SUMMED_RADIUS usa a média por tabela de somas
+//  (SummedArea.h), de custo fixo por pixel.
+//
+
+#ifndef Blur_h
+#define Blur_h
+
+#include <algorithm>
+#include <math.h>
+#include <stddef.h>
+#include <stdint.h>
+#include <string.h>
+#include <vector>
+
+#include "CpuFeatures.h"
+#include "ThreadPool.h"
+#include "ImageBuffer.h"
+#include "SummedArea.h"
+
+using namespace std;
+
+static const int BLUR_SHIFT = 14;
+
+struct BlurWeights {
+    int radius = 0;
+    // 2r+1 pesos em Q14 somando 1 << BLUR_SHIFT, mais um peso zero se preciso
+    // para o total ser par (os kernels consomem os taps de dois em dois)
+    vector<int16_t> w;
+    bool box = false; // pesos iguais (boxWeights): pode usar a tabela de somas
+
+    size_t taps() const { return w.size(); }
+};
+
+// Pesos reais (a soma precisa ser positiva; Resize.h usa pesos negativos)
+// -> Q14 com soma exata: arredonda para baixo e distribui o que falta pelos
+// maiores restos.
+inline BlurWeights quantizeWeights(const vector<double> &real) {
+    BlurWeights q;
+    q.radius = (int)(real.size() / 2);
+    double sum = 0;
+    for (double v : real) sum += v;
+    size_t n = real.size();
+    vector<double> rest(n);
+    q.w.assign(n + (n & 1), 0);
+    int total = 0;
+    for (size_t i = 0; i < n; i++) {
+        double v = real[i] / sum * (1 << BLUR_SHIFT);
+        q.w[i] = (int16_t)floor(v);
+        rest[i] = v - q.w[i];
+        total += q.w[i];
+    }
+    vector<size_t> order(n);
+    for (size_t i = 0; i < n; i++) order[i] = i;
+    stable_sort(order.begin(), order.end(), [&](size_t a, size_t b) { return rest[a] > rest[b]; });
+    for (size_t i = 0; total < (1 << BLUR_SHIFT); i = (i + 1) % n, total++) q.w[order[i]]++;
+    return q;
+}
+
+// Gaussiana truncada em 3 sigma; sigma <= 0 dá a identidade.
+inline BlurWeights gaussianWeights(double sigma) {
+    int r = sigma > 0 ? (int)ceil(3 * sigma) : 0;
+    vector<double> real(2 * r + 1);
+    for (int i = -r; i <= r; i++) real[i + r] = r ? exp(-(double)i * i / (2 * sigma * sigma)) : 1.0;
+    return quantizeWeights(real);
+}
+
+// Média simples de 2r+1 pixels. Com raios grandes os pesos em Q14 perdem
+// precisão (r = 1000 dá pesos 8 ou 9).
+inline BlurWeights boxWeights(int radius) {
+    if (radius < 0) radius = 0;
+    BlurWeights bw = quantizeWeights(vector<double>(2 * radius + 1, 1.0));
+    bw.box = true;
+    return bw;
+}
+
+// out[i] = (soma de w[k] * taps[k][i] + meio) >> BLUR_SHIFT, i em [begin, end),
+// saturado em 0..255 como o packus das versões SIMD.
+inline void convolveTapsScalar(const unsigned char *const *taps, const int16_t *w, size_t n, size_t begin,
+                               size_t end, unsigned char *out) {
+    for (size_t i = begin; i < end; i++) {
+        int32_t acc = 1 << (BLUR_SHIFT - 1);
+        for (size_t k = 0; k < n; k++) acc += w[k] * taps[k][i];
+        acc >>= BLUR_SHIFT;
+        out[i] = (unsigned char)(acc < 0 ? 0 : (acc > 255 ? 255 : acc));
+    }
+}
+
+inline void convolveScalar(const unsigned char *const *taps, const int16_t *w, size_t n, size_t count,
+                           unsigned char *out) {
+    convolveTapsScalar(taps, w, n, 0, count, out);
+}
+
+#if PG_SIMD_X86
+
+// Dois taps por vez: os bytes de p e q são intercalados (p0 q0 p1 q1 ...),
+// estendidos para 16 bits e multiplicados por (w[k], w[k+1]) com madd, que
+// já soma os dois produtos em 32 bits. unpack e pack trabalham por faixa de
+// 128 bits nos dois sentidos, então a ordem dos bytes volta certa em AVX2 e
+// AVX-512.
+#define PG_CONVOLVE_BODY(SUF, VEC, SI, STEP)                                                   \
+    const VEC zero = SUF##_setzero_##SI();                                                     \
+    const VEC half = SUF##_set1_epi32(1 << (BLUR_SHIFT - 1));                                  \
+    size_t i = 0;                                                                              \
+    for (; i + STEP <= count; i += STEP) {                                                     \
+        VEC a0 = half, a1 = half, a2 = half, a3 = half;                                        \
+        for (size_t k = 0; k < n; k += 2) {                                                    \
+            const VEC wk = SUF##_set1_epi32((int32_t)((uint32_t)(uint16_t)w[k]                 \
+                                                       | ((uint32_t)(uint16_t)w[k + 1] << 16))); \
+            VEC p = SUF##_loadu_##SI((const VEC *)(taps[k] + i));                              \
+            VEC q = SUF##_loadu_##SI((const VEC *)(taps[k + 1] + i));                          \
+            VEC lo = SUF##_unpacklo_epi8(p, q), hi = SUF##_unpackhi_epi8(p, q);                \
+            a0 = SUF##_add_epi32(a0, SUF##_madd_epi16(SUF##_unpacklo_epi8(lo, zero), wk));     \
+            a1 = SUF##_add_epi32(a1, SUF##_madd_epi16(SUF##_unpackhi_epi8(lo, zero), wk));     \
+            a2 = SUF##_add_epi32(a2, SUF##_madd_epi16(SUF##_unpacklo_epi8(hi, zero), wk));     \
+            a3 = SUF##_add_epi32(a3, SUF##_madd_epi16(SUF##_unpackhi_epi8(hi, zero), wk));     \
+        }                                                                                      \
+        a0 = SUF##_srai_epi32(a0, BLUR_SHIFT);                                                 \
+        a1 = SUF##_srai_epi32(a1, BLUR_SHIFT);                                                 \
+        a2 = SUF##_srai_epi32(a2, BLUR_SHIFT);                                                 \
+        a3 = SUF##_srai_epi32(a3, BLUR_SHIFT);                                                 \
+        VEC v = SUF##_packus_epi16(SUF##_packs_epi32(a0, a1), SUF##_packs_epi32(a2, a3));      \
+        SUF##_storeu_##SI((VEC *)(out + i), v);                                                \
+    }                                                                                          \
+    convolveTapsScalar(taps, w, n, i, count, out);
+
+PG_TARGET("ssse3")
+inline void convolveSSSE3(const unsigned char *const *taps, const int16_t *w, size_t n, size_t count,
+                          unsigned char *out) {
+    PG_CONVOLVE_BODY(_mm, __m128i, si128, 16)
+}
+
+PG_TARGET("avx2")
+inline void convolveAVX2(const unsigned char *const *taps, const int16_t *w, size_t n, size_t count,
+                         unsigned char *out) {
+    PG_CONVOLVE_BODY(_mm256, __m256i, si256, 32)
+}
+
+PG_TARGET("avx512f,avx512bw")
+inline void convolveAVX512(const unsigned char *const *taps, const int16_t *w, size_t n, size_t count,
+                           unsigned char *out) {
+    PG_CONVOLVE_BODY(_mm512, __m512i, si512, 64)
+}
+
+#undef PG_CONVOLVE_BODY
+
+#endif /* PG_SIMD_X86 */
+
+// n (número de taps) é sempre par; ver BlurWeights.
+typedef void (*ConvolveKernel)(const unsigned char *const *taps, const int16_t *w, size_t n, size_t count,
+                               unsigned char *out);
+
+inline ConvolveKernel convolveKernelFor(SimdLevel level) {
+#if PG_SIMD_X86
+    switch (level) {
+        case SIMD_AVX512: return convolveAVX512;
+        case SIMD_AVX2:   return convolveAVX2;
+        case SIMD_SSSE3:  return convolveSSSE3;
+        default:          break;
+    }
+#else
+    (void)level;
+#endif
+    return convolveScalar;
+}
+
+// Passada horizontal das linhas [y0, y1): src -> dst (podem ser a mesma
+// imagem; cada linha é copiada antes, com as bordas replicadas).
+inline void blurRows(const unsigned char *src, unsigned char *dst, int width, int channels, int y0, int y1,
+                     const BlurWeights &bw, ConvolveKernel conv) {
+    size_t n = bw.taps();
+    int r = bw.radius;
+    size_t rowBytes = (size_t)width * channels;
+    vector<unsigned char> padded(rowBytes + (size_t)2 * r * channels);
+    vector<const unsigned char *> taps(n);
+    for (size_t k = 0; k < n; k++) taps[k] = padded.data() + min(k, (size_t)2 * r) * channels;
+    for (int y = y0; y < y1; y++) {
+        const unsigned char *row = src + (size_t)y * rowBytes;
+        unsigned char *p = padded.data();
+        for (int k = 0; k < r; k++, p += channels) memcpy(p, row, channels);
+        memcpy(p, row, rowBytes);
+        p += rowBytes;
+        for (int k = 0; k < r; k++, p += channels) memcpy(p, row + rowBytes - channels, channels);
+        conv(taps.data(), bw.w.data(), n, rowBytes, dst + (size_t)y * rowBytes);
+    }
+}
+
+// Passada vertical das linhas [y0, y1): src -> dst (imagens diferentes).
+// A linha é percorrida em faixas de colunas para que as 2r+1 linhas lidas
+// por linha de saída fiquem no L2 até a linha seguinte reaproveitá-las.
+inline void blurColumns(const unsigned char *src, unsigned char *dst, size_t rowBytes, int height, int y0,
+                        int y1, const BlurWeights &bw, ConvolveKernel conv) {
+    size_t n = bw.taps();
+    int r = bw.radius;
+    size_t strip = (256 * 1024 / n) / 64 * 64;
+    if (strip < 64) strip = 64;
+    vector<const unsigned char *> taps(n);
+    for (size_t x0 = 0; x0 < rowBytes; x0 += strip) {
+        size_t count = min(strip, rowBytes - x0);
+        for (int y = y0; y < y1; y++) {
+            for (size_t k = 0; k < n; k++) {
+                int sy = y + (int)min(k, (size_t)2 * r) - r;
+                sy = sy < 0 ? 0 : (sy >= height ? height - 1 : sy);
+                taps[k] = src + (size_t)sy * rowBytes + x0;
+            }
+            conv(taps.data(), bw.w.data(), n, count, dst + (size_t)y * rowBytes + x0);
+        }
+    }
+}
+
+// Desfoque in-place de uma imagem com channels canais intercalados (1 para
+// um plano de PlanarImage). As duas passadas rodam em faixas de linhas no
+// pool; a horizontal escreve numa imagem temporária que a vertical lê.
+inline void separableBlur(unsigned char *data, int w, int h, int channels, const BlurWeights &bw,
+                          ConvolveKernel conv, ThreadPool &pool = ThreadPool::shared()) {
+    if (bw.radius == 0 || w <= 0 || h <= 0) return;
+    size_t rowBytes = (size_t)w * channels;
+    ImageBuffer tmp = ImagePool::shared().acquire(w, h, channels);
+    parallelRows(w, h, channels, [&](int y0, int y1) {
+        blurRows(data, tmp.data(), w, channels, y0, y1, bw, conv);
+    }, pool);
+    parallelRows(w, h, channels, [&](int y0, int y1) {
+        blurColumns(tmp.data(), data, rowBytes, h, y0, y1, bw, conv);
+    }, pool);
+}
+
+inline void separableBlur(unsigned char *data, int w, int h, int channels, const BlurWeights &bw) {
+    static const ConvolveKernel kernel = convolveKernelFor(activeSimdLevel());
+    separableBlur(data, w, h, channels, bw, kernel);
+}
+
+// A partir deste raio a média por tabela de somas fica mais rápida que as
+// 2r+1 leituras por pixel de cada passada (em 1920x1080 RGB as duas empatam
+// perto de r = 22; ver "boxblur r=32" no exemplo_03_bench).
+static const int BOX_SUMMED_RADIUS = 24;
+
+// Desfoque com os pesos de bw, pelo caminho mais rápido para eles.
+inline void blurImage(unsigned char *data, int w, int h, int channels, const BlurWeights &bw) {
+    if (bw.box && bw.radius >= BOX_SUMMED_RADIUS) {
+        boxMean(data, w, h, channels, bw.radius);
+    } else {
+        separableBlur(data, w, h, channels, bw);
+    }
+}
+
+inline void gaussianBlur(unsigned char *data, int w, int h, double sigma, int channels = 3) {
+    blurImage(data, w, h, channels, gaussianWeights(sigma));
+}
+
+inline void boxBlur(unsigned char *data, int w, int h, int radius, int channels = 3) {
+    blurImage(data, w, h, channels, boxWeights(radius));
+}
+
+#endif /* Blur_h */
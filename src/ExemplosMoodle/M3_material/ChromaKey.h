@@ -0,0 +1,233 @@
+//
+//  ChromaKey.h
+//  Chroma-key com distância ao quadrado em inteiros: sem sqrt e sem double
+//  por pixel. O pixel é chaveado (vira preto) quando
+//      (r-kr)^2 + (g-kg)^2 + (b-kb)^2 < limiar2
+//  e a máscara da chave (255 = chaveado) pode ser gravada na mesma passada.
+//
+//  As versões SIMD processam 16/32/64 pixels por iteração e dão o mesmo
+//  resultado da escalar. As versões *Planar trabalham sobre planos R, G e B
+//  separados (PlanarImage.h).
+//
+
+#ifndef ChromaKey_h
+#define ChromaKey_h
+
+#include <stddef.h>
+#include <math.h>
+
+#include "SimdRgb.h"
+
+struct ChromaKeyColor {
+    int r, g, b;
+    int threshold2; // limiar da distância ao quadrado (exclusivo)
+};
+
+// Converte a tolerância relativa do exemplo (d / dmax < t, dmax = distância
+// do preto ao branco) para o limiar inteiro equivalente de d^2.
+inline ChromaKeyColor chromaKeyColor(int r, int g, int b, double tolerance) {
+    const int dmax2 = 3 * 255 * 255;
+    ChromaKeyColor k;
+    k.r = r < 0 ? 0 : (r > 255 ? 255 : r);
+    k.g = g < 0 ? 0 : (g > 255 ? 255 : g);
+    k.b = b < 0 ? 0 : (b > 255 ? 255 : b);
+    if (tolerance <= 0) {
+        k.threshold2 = 0;
+    } else if (tolerance >= 1) {
+        k.threshold2 = dmax2 + 1;
+    } else {
+        // d^2 é inteiro: d^2 < x  <=>  d^2 < ceil(x)
+        k.threshold2 = (int)ceil(tolerance * tolerance * dmax2);
+    }
+    return k;
+}
+
+inline void chromaKeyScalar(unsigned char *data, size_t pixels, ChromaKeyColor k, unsigned char *mask) {
+    for (size_t p = 0; p < pixels; p++) {
+        unsigned char *px = data + p * 3;
+        int dr = px[0] - k.r;
+        int dg = px[1] - k.g;
+        int db = px[2] - k.b;
+        bool keyed = dr * dr + dg * dg + db * db < k.threshold2;
+        if (keyed) {
+            px[0] = px[1] = px[2] = 0;
+        }
+        if (mask) mask[p] = keyed ? 255 : 0;
+    }
+}
+
+inline void chromaKeyPlanarScalar(unsigned char *r, unsigned char *g, unsigned char *b, size_t pixels,
+                                  ChromaKeyColor k, unsigned char *mask) {
+    for (size_t p = 0; p < pixels; p++) {
+        int dr = r[p] - k.r;
+        int dg = g[p] - k.g;
+        int db = b[p] - k.b;
+        bool keyed = dr * dr + dg * dg + db * db < k.threshold2;
+        if (keyed) {
+            r[p] = g[p] = b[p] = 0;
+        }
+        if (mask) mask[p] = keyed ? 255 : 0;
+    }
+}
+
+#if PG_SIMD_X86
+
+// Comum às três larguras. Por pista de 128 bits: |diferença| em 8 bits,
+// quadrados somados com pmaddwd em 32 bits, comparação e empacotamento da
+// máscara de volta para 8 bits (-1/0 sobrevivem à saturação).
+#define PG_CHROMA_CONSTS(SUF, VEC, SI)                                                  \
+    const VEC kr = SUF##_set1_epi8((char)k.r);                                          \
+    const VEC kg = SUF##_set1_epi8((char)k.g);                                          \
+    const VEC kb = SUF##_set1_epi8((char)k.b);                                          \
+    const VEC thr = SUF##_set1_epi32(k.threshold2);                                     \
+    const VEC zero = SUF##_setzero_##SI();
+
+#define PG_CHROMA_KEYED(SUF, VEC, SI, CMPLT, r, g, b, keyed)                            \
+    VEC keyed;                                                                          \
+    {                                                                                   \
+        VEC dr = SUF##_or_##SI(SUF##_subs_epu8(r, kr), SUF##_subs_epu8(kr, r));         \
+        VEC dg = SUF##_or_##SI(SUF##_subs_epu8(g, kg), SUF##_subs_epu8(kg, g));         \
+        VEC db = SUF##_or_##SI(SUF##_subs_epu8(b, kb), SUF##_subs_epu8(kb, b));         \
+        VEC half[2];                                                                    \
+        for (int h = 0; h < 2; h++) {                                                   \
+            VEC r16 = h ? SUF##_unpackhi_epi8(dr, zero) : SUF##_unpacklo_epi8(dr, zero); \
+            VEC g16 = h ? SUF##_unpackhi_epi8(dg, zero) : SUF##_unpacklo_epi8(dg, zero); \
+            VEC b16 = h ? SUF##_unpackhi_epi8(db, zero) : SUF##_unpacklo_epi8(db, zero); \
+            VEC rgLo = SUF##_unpacklo_epi16(r16, g16), rgHi = SUF##_unpackhi_epi16(r16, g16); \
+            VEC bLo = SUF##_unpacklo_epi16(b16, zero), bHi = SUF##_unpackhi_epi16(b16, zero); \
+            VEC d2Lo = SUF##_add_epi32(SUF##_madd_epi16(rgLo, rgLo), SUF##_madd_epi16(bLo, bLo)); \
+            VEC d2Hi = SUF##_add_epi32(SUF##_madd_epi16(rgHi, rgHi), SUF##_madd_epi16(bHi, bHi)); \
+            half[h] = SUF##_packs_epi32(CMPLT(d2Lo, thr), CMPLT(d2Hi, thr));            \
+        }                                                                               \
+        keyed = SUF##_packs_epi16(half[0], half[1]);                                    \
+    }
+
+#define PG_CHROMA_BODY(SUF, VEC, SI, CMPLT, STEP)                                       \
+    PG_CHROMA_CONSTS(SUF, VEC, SI)                                                      \
+    size_t i = 0;                                                                       \
+    for (; i + STEP <= pixels; i += STEP) {                                             \
+        unsigned char *p = data + i * 3;                                                \
+        VEC v[3], r, g, b;                                                              \
+        loadRgb(p, v);                                                                  \
+        splitRgb(v, r, g, b);                                                           \
+        PG_CHROMA_KEYED(SUF, VEC, SI, CMPLT, r, g, b, keyed)                            \
+        VEC spread[3];                                                                  \
+        spreadRgb(keyed, spread);                                                       \
+        for (int c = 0; c < 3; c++) v[c] = SUF##_andnot_##SI(spread[c], v[c]);          \
+        storeRgb(p, v);                                                                 \
+        if (mask) SUF##_storeu_##SI((VEC *)(mask + i), keyed);                          \
+    }                                                                                   \
+    chromaKeyScalar(data + i * 3, pixels - i, k, mask ? mask + i : nullptr);
+
+// Planar: os planos já estão separados, a máscara zera cada um diretamente.
+#define PG_CHROMA_PLANAR_BODY(SUF, VEC, SI, CMPLT, STEP)                                \
+    PG_CHROMA_CONSTS(SUF, VEC, SI)                                                      \
+    size_t i = 0;                                                                       \
+    for (; i + STEP <= pixels; i += STEP) {                                             \
+        VEC rv = SUF##_loadu_##SI((const VEC *)(r + i));                                \
+        VEC gv = SUF##_loadu_##SI((const VEC *)(g + i));                                \
+        VEC bv = SUF##_loadu_##SI((const VEC *)(b + i));                                \
+        PG_CHROMA_KEYED(SUF, VEC, SI, CMPLT, rv, gv, bv, keyed)                         \
+        SUF##_storeu_##SI((VEC *)(r + i), SUF##_andnot_##SI(keyed, rv));                \
+        SUF##_storeu_##SI((VEC *)(g + i), SUF##_andnot_##SI(keyed, gv));                \
+        SUF##_storeu_##SI((VEC *)(b + i), SUF##_andnot_##SI(keyed, bv));                \
+        if (mask) SUF##_storeu_##SI((VEC *)(mask + i), keyed);                          \
+    }                                                                                   \
+    chromaKeyPlanarScalar(r + i, g + i, b + i, pixels - i, k, mask ? mask + i : nullptr);
+
+PG_TARGET("ssse3")
+inline void chromaKeySSSE3(unsigned char *data, size_t pixels, ChromaKeyColor k, unsigned char *mask) {
+    PG_CHROMA_BODY(_mm, __m128i, si128, _mm_cmplt_epi32, 16)
+}
+
+PG_TARGET("avx2")
+inline __m256i chromaCmpLt256(__m256i a, __m256i b) {
+    return _mm256_cmpgt_epi32(b, a);
+}
+
+PG_TARGET("avx2")
+inline void chromaKeyAVX2(unsigned char *data, size_t pixels, ChromaKeyColor k, unsigned char *mask) {
+    PG_CHROMA_BODY(_mm256, __m256i, si256, chromaCmpLt256, 32)
+}
+
+PG_TARGET("avx512f,avx512bw")
+inline __m512i chromaCmpLt512(__m512i a, __m512i b) {
+    return _mm512_maskz_mov_epi32(_mm512_cmplt_epi32_mask(a, b), _mm512_set1_epi32(-1));
+}
+
+PG_TARGET("avx512f,avx512bw")
+inline void chromaKeyAVX512(unsigned char *data, size_t pixels, ChromaKeyColor k, unsigned char *mask) {
+    PG_CHROMA_BODY(_mm512, __m512i, si512, chromaCmpLt512, 64)
+}
+
+PG_TARGET("ssse3")
+inline void chromaKeyPlanarSSSE3(unsigned char *r, unsigned char *g, unsigned char *b, size_t pixels,
+                                 ChromaKeyColor k, unsigned char *mask) {
+    PG_CHROMA_PLANAR_BODY(_mm, __m128i, si128, _mm_cmplt_epi32, 16)
+}
+
+PG_TARGET("avx2")
+inline void chromaKeyPlanarAVX2(unsigned char *r, unsigned char *g, unsigned char *b, size_t pixels,
+                                ChromaKeyColor k, unsigned char *mask) {
+    PG_CHROMA_PLANAR_BODY(_mm256, __m256i, si256, chromaCmpLt256, 32)
+}
+
+PG_TARGET("avx512f,avx512bw")
+inline void chromaKeyPlanarAVX512(unsigned char *r, unsigned char *g, unsigned char *b, size_t pixels,
+                                  ChromaKeyColor k, unsigned char *mask) {
+    PG_CHROMA_PLANAR_BODY(_mm512, __m512i, si512, chromaCmpLt512, 64)
+}
+
+#undef PG_CHROMA_PLANAR_BODY
+#undef PG_CHROMA_BODY
+#undef PG_CHROMA_KEYED
+#undef PG_CHROMA_CONSTS
+
+#endif /* PG_SIMD_X86 */
+
+typedef void (*ChromaKernel)(unsigned char *data, size_t pixels, ChromaKeyColor k, unsigned char *mask);
+
+inline ChromaKernel chromaKernelFor(SimdLevel level) {
+#if PG_SIMD_X86
+    switch (level) {
+        case SIMD_AVX512: return chromaKeyAVX512;
+        case SIMD_AVX2:   return chromaKeyAVX2;
+        case SIMD_SSSE3:  return chromaKeySSSE3;
+        default:          break;
+    }
+#else
+    (void)level;
+#endif
+    return chromaKeyScalar;
+}
+
+// mask (opcional): um byte por pixel, 255 onde o pixel foi chaveado.
+inline void chromaKeyFixed(unsigned char *data, size_t pixels, ChromaKeyColor k, unsigned char *mask = nullptr) {
+    static const ChromaKernel kernel = chromaKernelFor(activeSimdLevel());
+    kernel(data, pixels, k, mask);
+}
+
+typedef void (*ChromaPlanarKernel)(unsigned char *r, unsigned char *g, unsigned char *b, size_t pixels,
+                                   ChromaKeyColor k, unsigned char *mask);
+
+inline ChromaPlanarKernel chromaPlanarKernelFor(SimdLevel level) {
+#if PG_SIMD_X86
+    switch (level) {
+        case SIMD_AVX512: return chromaKeyPlanarAVX512;
+        case SIMD_AVX2:   return chromaKeyPlanarAVX2;
+        case SIMD_SSSE3:  return chromaKeyPlanarSSSE3;
+        default:          break;
+    }
+#else
+    (void)level;
+#endif
+    return chromaKeyPlanarScalar;
+}
+
+inline void chromaKeyPlanar(unsigned char *r, unsigned char *g, unsigned char *b, size_t pixels,
+                            ChromaKeyColor k, unsigned char *mask = nullptr) {
+    static const ChromaPlanarKernel kernel = chromaPlanarKernelFor(activeSimdLevel());
+    kernel(r, g, b, pixels, k, mask);
+}
+
+#endif /* ChromaKey_h */
@@ -0,0 +1,683 @@
+//
+//  ColorSpace.h
+//  Conversão RGB <-> HSV/HSL em lote e o filtro de matiz/saturação
+//  (huesat) e tingimento (tint) construídos sobre ela.
+//
+//  As conversões trabalham sobre planos (PlanarImage.h): r, g e b em bytes
+//  de um lado, h, s e v (ou l) em float de 0 a 1 do outro. As versões SIMD
+//  convertem 4 (SSE) ou 8 (AVX2) pixels por vez, sem desvios: os três
+//  candidatos a matiz são calculados e o certo é escolhido por máscara. A
+//  versão escalar faz as mesmas operações na mesma ordem, então todos os
+//  níveis dão o mesmo resultado. Não há versões AVX-512: lá as comparações
+//  dão máscaras em registradores k e os kernels de float ficam no AVX2.
+//
+//  huesat converte cada pixel para HSL, gira a matiz, escala a saturação (ou,
+//  no modo colorize, troca as duas) e volta para RGB, tudo em registradores.
+//
+//  tint é o colorize em ponto fixo: com matiz e saturação fixas, cada canal
+//  de saída só depende da luminosidade L2 = max + min (0..510):
+//      c = (L2 + k_c * min(L2, 510 - L2) + 1) >> 1
+//  com k_c em Q9 (pmulhrsw), sem divisões nem float. Difere do colorize em
+//  float por no máximo 1 nos canais.
+//
+
+#ifndef ColorSpace_h
+#define ColorSpace_h
+
+#include <algorithm>
+#include <math.h>
+#include <stddef.h>
+#include <string.h>
+
+#include "SimdRgb.h"
+#include "ThreadPool.h"
+#include "PlanarImage.h"
+
+using namespace std;
+
+// Parâmetros do huesat, em voltas (matiz) e fração (saturação).
+struct HueSat {
+    float hue;     // colorize: matiz final; senão, quanto girar, em [0, 1)
+    float sat;     // colorize: saturação final; senão, fator sobre a saturação
+    bool colorize;
+};
+
+// hue em graus; no modo normal sat multiplica a saturação, no colorize é a
+// saturação final (0..1).
+inline HueSat hueSat(double hueDegrees, double sat, bool colorize = false) {
+    double turns = fmod(hueDegrees / 360.0, 1.0);
+    if (turns < 0) turns += 1.0;
+    HueSat hs;
+    hs.hue = (float)turns;
+    if (hs.hue >= 1.0f) hs.hue = 0.0f;
+    hs.sat = (float)max(0.0, colorize ? min(sat, 1.0) : sat);
+    hs.colorize = colorize;
+    return hs;
+}
+
+// Tingimento em ponto fixo: k_c de cada canal em Q9.
+struct Tint {
+    short k[3];
+};
+
+// O mesmo que hueSat(hueDegrees, sat, true): c = l - a * t_c, com
+// a = s * min(l, 1 - l) e t_c em [-1, 1] dependendo só da matiz.
+inline Tint tint(double hueDegrees, double sat) {
+    HueSat hs = hueSat(hueDegrees, sat, true);
+    const int n[3] = {0, 8, 4};
+    Tint t;
+    for (int c = 0; c < 3; c++) {
+        double k = fmod(n[c] + hs.hue * 12.0, 12.0);
+        double tc = max(-1.0, min(min(k - 3, 9 - k), 1.0));
+        t.k[c] = (short)lround(-hs.sat * tc * 512);
+    }
+    return t;
+}
+
+// ---- escalar: a referência, operação por operação igual às versões SIMD ----
+
+// Matiz em [0, 1] de r, g, b (0..255), mais o maior e o menor canal.
+inline float hsxHue(float r, float g, float b, float &mx, float &mn) {
+    mx = max(r, max(g, b));
+    mn = min(r, min(g, b));
+    float d = mx - mn;
+    float dd = d == 0.0f ? 1.0f : d;
+    float hr = (g - b) / dd;
+    float hg = (b - r) / dd + 2.0f;
+    float hb = (r - g) / dd + 4.0f;
+    float h6 = mx == r ? hr : (mx == g ? hg : hb);
+    h6 = h6 < 0.0f ? h6 + 6.0f : h6;
+    return h6 * (1.0f / 6.0f);
+}
+
+inline unsigned char hsxByte(float c) {
+    c = c * 255.0f;
+    c = max(c, 0.0f);
+    return (unsigned char)lrintf(min(c, 255.0f));
+}
+
+// Um canal de HSV -> RGB: v - v*s * clamp(min(k, 4 - k), 0, 1).
+inline unsigned char hsvChannel(float n, float h6, float v, float vs) {
+    float k = n + h6;
+    k = k >= 6.0f ? k - 6.0f : k;
+    float t = min(k, 4.0f - k);
+    t = max(0.0f, min(t, 1.0f));
+    return hsxByte(v - vs * t);
+}
+
+// Um canal de HSL -> RGB: l - a * clamp(min(k - 3, 9 - k), -1, 1).
+inline unsigned char hslChannel(float n, float h12, float l, float a) {
+    float k = n + h12;
+    k = k >= 12.0f ? k - 12.0f : k;
+    float t = min(k - 3.0f, 9.0f - k);
+    t = max(-1.0f, min(t, 1.0f));
+    return hsxByte(l - a * t);
+}
+
+inline void hslToRgbPixel(float h, float s, float l, unsigned char &r, unsigned char &g, unsigned char &b) {
+    float h12 = h * 12.0f;
+    float a = s * min(l, 1.0f - l);
+    r = hslChannel(0.0f, h12, l, a);
+    g = hslChannel(8.0f, h12, l, a);
+    b = hslChannel(4.0f, h12, l, a);
+}
+
+inline void rgbToHsvScalar(const unsigned char *r, const unsigned char *g, const unsigned char *b, size_t pixels,
+                           float *h, float *s, float *v) {
+    for (size_t i = 0; i < pixels; i++) {
+        float mx, mn;
+        h[i] = hsxHue(r[i], g[i], b[i], mx, mn);
+        s[i] = (mx - mn) / max(mx, 1.0f);
+        v[i] = mx * (1.0f / 255.0f);
+    }
+}
+
+inline void rgbToHslScalar(const unsigned char *r, const unsigned char *g, const unsigned char *b, size_t pixels,
+                           float *h, float *s, float *l) {
+    for (size_t i = 0; i < pixels; i++) {
+        float mx, mn;
+        h[i] = hsxHue(r[i], g[i], b[i], mx, mn);
+        float sum = mx + mn;
+        s[i] = (mx - mn) / max(min(sum, 510.0f - sum), 1.0f);
+        l[i] = sum * (1.0f / 510.0f);
+    }
+}
+
+inline void hsvToRgbScalar(const float *h, const float *s, const float *v, size_t pixels, unsigned char *r,
+                           unsigned char *g, unsigned char *b) {
+    for (size_t i = 0; i < pixels; i++) {
+        float h6 = h[i] * 6.0f;
+        float vs = v[i] * s[i];
+        r[i] = hsvChannel(5.0f, h6, v[i], vs);
+        g[i] = hsvChannel(3.0f, h6, v[i], vs);
+        b[i] = hsvChannel(1.0f, h6, v[i], vs);
+    }
+}
+
+inline void hslToRgbScalar(const float *h, const float *s, const float *l, size_t pixels, unsigned char *r,
+                           unsigned char *g, unsigned char *b) {
+    for (size_t i = 0; i < pixels; i++) hslToRgbPixel(h[i], s[i], l[i], r[i], g[i], b[i]);
+}
+
+inline void hueSatScalar(unsigned char *r, unsigned char *g, unsigned char *b, size_t pixels, const HueSat &hs) {
+    for (size_t i = 0; i < pixels; i++) {
+        float mx, mn;
+        float h = hsxHue(r[i], g[i], b[i], mx, mn);
+        float sum = mx + mn;
+        float s = (mx - mn) / max(min(sum, 510.0f - sum), 1.0f);
+        float l = sum * (1.0f / 510.0f);
+        if (hs.colorize) {
+            h = hs.hue;
+            s = hs.sat;
+        } else {
+            h = h + hs.hue;
+            h = h >= 1.0f ? h - 1.0f : h;
+            s = min(s * hs.sat, 1.0f);
+        }
+        hslToRgbPixel(h, s, l, r[i], g[i], b[i]);
+    }
+}
+
+inline void tintScalar(unsigned char *r, unsigned char *g, unsigned char *b, size_t pixels, const Tint &t) {
+    unsigned char *planes[3] = {r, g, b};
+    for (size_t i = 0; i < pixels; i++) {
+        int l2 = max(r[i], max(g[i], b[i])) + min(r[i], min(g[i], b[i]));
+        int m64 = min(l2, 510 - l2) << 6;
+        for (int c = 0; c < 3; c++) {
+            int delta = (m64 * t.k[c] + 16384) >> 15; // pmulhrsw
+            int v = (l2 + delta + 1) >> 1;
+            planes[c][i] = (unsigned char)(v < 0 ? 0 : (v > 255 ? 255 : v));
+        }
+    }
+}
+
+#if PG_SIMD_X86
+
+// Operações que mudam de nome entre SSE e AVX, sobrecarregadas pelo tipo.
+PG_TARGET("ssse3")
+inline void hsxLoad(const unsigned char *p, __m128 &v) {
+    int bytes;
+    memcpy(&bytes, p, 4);
+    __m128i zero = _mm_setzero_si128();
+    __m128i x = _mm_unpacklo_epi16(_mm_unpacklo_epi8(_mm_cvtsi32_si128(bytes), zero), zero);
+    v = _mm_cvtepi32_ps(x);
+}
+
+PG_TARGET("ssse3")
+inline void hsxStore(unsigned char *p, __m128 v) {
+    __m128i x = _mm_cvtps_epi32(v);
+    x = _mm_packus_epi16(_mm_packs_epi32(x, x), x);
+    int bytes = _mm_cvtsi128_si32(x);
+    memcpy(p, &bytes, 4);
+}
+
+PG_TARGET("ssse3")
+inline __m128 hsxSelect(__m128 mask, __m128 a, __m128 b) {
+    return _mm_or_ps(_mm_and_ps(mask, a), _mm_andnot_ps(mask, b));
+}
+
+PG_TARGET("ssse3") inline __m128 hsxEq(__m128 a, __m128 b) { return _mm_cmpeq_ps(a, b); }
+PG_TARGET("ssse3") inline __m128 hsxLt(__m128 a, __m128 b) { return _mm_cmplt_ps(a, b); }
+PG_TARGET("ssse3") inline __m128 hsxGe(__m128 a, __m128 b) { return _mm_cmpge_ps(a, b); }
+
+PG_TARGET("avx2")
+inline void hsxLoad(const unsigned char *p, __m256 &v) {
+    v = _mm256_cvtepi32_ps(_mm256_cvtepu8_epi32(_mm_loadl_epi64((const __m128i *)p)));
+}
+
+PG_TARGET("avx2")
+inline void hsxStore(unsigned char *p, __m256 v) {
+    __m256i x = _mm256_cvtps_epi32(v);
+    __m128i w = _mm_packs_epi32(_mm256_castsi256_si128(x), _mm256_extracti128_si256(x, 1));
+    _mm_storel_epi64((__m128i *)p, _mm_packus_epi16(w, w));
+}
+
+PG_TARGET("avx2") inline __m256 hsxSelect(__m256 mask, __m256 a, __m256 b) { return _mm256_blendv_ps(b, a, mask); }
+PG_TARGET("avx2") inline __m256 hsxEq(__m256 a, __m256 b) { return _mm256_cmp_ps(a, b, _CMP_EQ_OQ); }
+PG_TARGET("avx2") inline __m256 hsxLt(__m256 a, __m256 b) { return _mm256_cmp_ps(a, b, _CMP_LT_OQ); }
+PG_TARGET("avx2") inline __m256 hsxGe(__m256 a, __m256 b) { return _mm256_cmp_ps(a, b, _CMP_GE_OQ); }
+
+#define PG_HSX_CONSTS(SUF, PS)                                                                   \
+    const PS zero = SUF##_setzero_ps(), one = SUF##_set1_ps(1.0f), minusOne = SUF##_set1_ps(-1.0f); \
+    const PS two = SUF##_set1_ps(2.0f), three = SUF##_set1_ps(3.0f), four = SUF##_set1_ps(4.0f); \
+    const PS six = SUF##_set1_ps(6.0f), nine = SUF##_set1_ps(9.0f), twelve = SUF##_set1_ps(12.0f); \
+    const PS sixth = SUF##_set1_ps(1.0f / 6.0f), c255 = SUF##_set1_ps(255.0f);                   \
+    const PS c510 = SUF##_set1_ps(510.0f), inv255 = SUF##_set1_ps(1.0f / 255.0f);                \
+    const PS inv510 = SUF##_set1_ps(1.0f / 510.0f);                                              \
+    (void)minusOne; (void)two; (void)three; (void)four; (void)six; (void)nine; (void)twelve;     \
+    (void)sixth; (void)c255; (void)c510; (void)inv255; (void)inv510;
+
+// hsxHue: r, g, b (0..255) -> mx, mn e a matiz hue em [0, 1].
+#define PG_HSX_HUE(SUF, PS, r, g, b, mx, mn, hue)                                                \
+    PS mx = SUF##_max_ps(r, SUF##_max_ps(g, b));                                                 \
+    PS mn = SUF##_min_ps(r, SUF##_min_ps(g, b));                                                 \
+    PS hue;                                                                                      \
+    {                                                                                            \
+        PS d = SUF##_sub_ps(mx, mn);                                                             \
+        PS dd = hsxSelect(hsxEq(d, zero), one, d);                                               \
+        PS hr = SUF##_div_ps(SUF##_sub_ps(g, b), dd);                                            \
+        PS hg = SUF##_add_ps(SUF##_div_ps(SUF##_sub_ps(b, r), dd), two);                         \
+        PS hb = SUF##_add_ps(SUF##_div_ps(SUF##_sub_ps(r, g), dd), four);                        \
+        PS h6 = hsxSelect(hsxEq(mx, r), hr, hsxSelect(hsxEq(mx, g), hg, hb));                    \
+        h6 = hsxSelect(hsxLt(h6, zero), SUF##_add_ps(h6, six), h6);                              \
+        hue = SUF##_mul_ps(h6, sixth);                                                           \
+    }
+
+// hsxByte + gravação: c (0..1) -> byte em p.
+#define PG_HSX_STORE(SUF, p, c)                                                                  \
+    hsxStore(p, SUF##_min_ps(SUF##_max_ps(SUF##_mul_ps(c, c255), zero), c255))
+
+#define PG_HSV_CHANNEL(SUF, PS, N, h6, v, vs, p)                                                 \
+    {                                                                                            \
+        PS k = SUF##_add_ps(SUF##_set1_ps(N), h6);                                               \
+        k = hsxSelect(hsxGe(k, six), SUF##_sub_ps(k, six), k);                                   \
+        PS t = SUF##_min_ps(k, SUF##_sub_ps(four, k));                                           \
+        t = SUF##_max_ps(zero, SUF##_min_ps(t, one));                                            \
+        PG_HSX_STORE(SUF, p, SUF##_sub_ps(v, SUF##_mul_ps(vs, t)));                              \
+    }
+
+#define PG_HSL_CHANNEL(SUF, PS, N, h12, l, a, p)                                                 \
+    {                                                                                            \
+        PS k = SUF##_add_ps(SUF##_set1_ps(N), h12);                                              \
+        k = hsxSelect(hsxGe(k, twelve), SUF##_sub_ps(k, twelve), k);                             \
+        PS t = SUF##_min_ps(SUF##_sub_ps(k, three), SUF##_sub_ps(nine, k));                      \
+        t = SUF##_max_ps(minusOne, SUF##_min_ps(t, one));                                        \
+        PG_HSX_STORE(SUF, p, SUF##_sub_ps(l, SUF##_mul_ps(a, t)));                               \
+    }
+
+#define PG_HSL_TO_RGB(SUF, PS, h, s, l, pr, pg, pb)                                              \
+    {                                                                                            \
+        PS h12 = SUF##_mul_ps(h, twelve);                                                        \
+        PS a = SUF##_mul_ps(s, SUF##_min_ps(l, SUF##_sub_ps(one, l)));                           \
+        PG_HSL_CHANNEL(SUF, PS, 0.0f, h12, l, a, pr)                                             \
+        PG_HSL_CHANNEL(SUF, PS, 8.0f, h12, l, a, pg)                                             \
+        PG_HSL_CHANNEL(SUF, PS, 4.0f, h12, l, a, pb)                                             \
+    }
+
+// Saturação e luminosidade do HSL a partir de mx e mn.
+#define PG_HSL_SL(SUF, PS, mx, mn, s, l)                                                         \
+    PS s, l;                                                                                     \
+    {                                                                                            \
+        PS sum = SUF##_add_ps(mx, mn);                                                           \
+        PS den = SUF##_max_ps(SUF##_min_ps(sum, SUF##_sub_ps(c510, sum)), one);                  \
+        s = SUF##_div_ps(SUF##_sub_ps(mx, mn), den);                                             \
+        l = SUF##_mul_ps(sum, inv510);                                                           \
+    }
+
+#define PG_RGB_TO_HSV_BODY(SUF, PS, STEP)                                                        \
+    PG_HSX_CONSTS(SUF, PS)                                                                       \
+    size_t i = 0;                                                                                \
+    for (; i + STEP <= pixels; i += STEP) {                                                      \
+        PS rv, gv, bv;                                                                           \
+        hsxLoad(r + i, rv);                                                                      \
+        hsxLoad(g + i, gv);                                                                      \
+        hsxLoad(b + i, bv);                                                                      \
+        PG_HSX_HUE(SUF, PS, rv, gv, bv, mx, mn, hue)                                             \
+        SUF##_storeu_ps(h + i, hue);                                                             \
+        SUF##_storeu_ps(s + i, SUF##_div_ps(SUF##_sub_ps(mx, mn), SUF##_max_ps(mx, one)));       \
+        SUF##_storeu_ps(v + i, SUF##_mul_ps(mx, inv255));                                        \
+    }                                                                                            \
+    rgbToHsvScalar(r + i, g + i, b + i, pixels - i, h + i, s + i, v + i);
+
+#define PG_RGB_TO_HSL_BODY(SUF, PS, STEP)                                                        \
+    PG_HSX_CONSTS(SUF, PS)                                                                       \
+    size_t i = 0;                                                                                \
+    for (; i + STEP <= pixels; i += STEP) {                                                      \
+        PS rv, gv, bv;                                                                           \
+        hsxLoad(r + i, rv);                                                                      \
+        hsxLoad(g + i, gv);                                                                      \
+        hsxLoad(b + i, bv);                                                                      \
+        PG_HSX_HUE(SUF, PS, rv, gv, bv, mx, mn, hue)                                             \
+        PG_HSL_SL(SUF, PS, mx, mn, sat, lum)                                                     \
+        SUF##_storeu_ps(h + i, hue);                                                             \
+        SUF##_storeu_ps(s + i, sat);                                                             \
+        SUF##_storeu_ps(l + i, lum);                                                             \
+    }                                                                                            \
+    rgbToHslScalar(r + i, g + i, b + i, pixels - i, h + i, s + i, l + i);
+
+#define PG_HSV_TO_RGB_BODY(SUF, PS, STEP)                                                        \
+    PG_HSX_CONSTS(SUF, PS)                                                                       \
+    size_t i = 0;                                                                                \
+    for (; i + STEP <= pixels; i += STEP) {                                                      \
+        PS vv = SUF##_loadu_ps(v + i);                                                           \
+        PS h6 = SUF##_mul_ps(SUF##_loadu_ps(h + i), six);                                        \
+        PS vs = SUF##_mul_ps(vv, SUF##_loadu_ps(s + i));                                         \
+        PG_HSV_CHANNEL(SUF, PS, 5.0f, h6, vv, vs, r + i)                                         \
+        PG_HSV_CHANNEL(SUF, PS, 3.0f, h6, vv, vs, g + i)                                         \
+        PG_HSV_CHANNEL(SUF, PS, 1.0f, h6, vv, vs, b + i)                                         \
+    }                                                                                            \
+    hsvToRgbScalar(h + i, s + i, v + i, pixels - i, r + i, g + i, b + i);
+
+#define PG_HSL_TO_RGB_BODY(SUF, PS, STEP)                                                        \
+    PG_HSX_CONSTS(SUF, PS)                                                                       \
+    size_t i = 0;                                                                                \
+    for (; i + STEP <= pixels; i += STEP) {                                                      \
+        PS hv = SUF##_loadu_ps(h + i), sv = SUF##_loadu_ps(s + i), lv = SUF##_loadu_ps(l + i);   \
+        PG_HSL_TO_RGB(SUF, PS, hv, sv, lv, r + i, g + i, b + i)                                  \
+    }                                                                                            \
+    hslToRgbScalar(h + i, s + i, l + i, pixels - i, r + i, g + i, b + i);
+
+// RGB -> HSL, ajuste e HSL -> RGB sem sair dos registradores.
+#define PG_HUESAT_BODY(SUF, PS, STEP)                                                            \
+    PG_HSX_CONSTS(SUF, PS)                                                                       \
+    const PS hueArg = SUF##_set1_ps(hs.hue), satArg = SUF##_set1_ps(hs.sat);                     \
+    size_t i = 0;                                                                                \
+    for (; i + STEP <= pixels; i += STEP) {                                                      \
+        PS rv, gv, bv;                                                                           \
+        hsxLoad(r + i, rv);                                                                      \
+        hsxLoad(g + i, gv);                                                                      \
+        hsxLoad(b + i, bv);                                                                      \
+        PG_HSX_HUE(SUF, PS, rv, gv, bv, mx, mn, hue)                                             \
+        PG_HSL_SL(SUF, PS, mx, mn, sat, lum)                                                     \
+        if (hs.colorize) {                                                                       \
+            hue = hueArg;                                                                        \
+            sat = satArg;                                                                        \
+        } else {                                                                                 \
+            hue = SUF##_add_ps(hue, hueArg);                                                     \
+            hue = hsxSelect(hsxGe(hue, one), SUF##_sub_ps(hue, one), hue);                       \
+            sat = SUF##_min_ps(SUF##_mul_ps(sat, satArg), one);                                  \
+        }                                                                                        \
+        PG_HSL_TO_RGB(SUF, PS, hue, sat, lum, r + i, g + i, b + i)                               \
+    }                                                                                            \
+    hueSatScalar(r + i, g + i, b + i, pixels - i, hs);
+
+PG_TARGET("ssse3")
+inline void rgbToHsvSSSE3(const unsigned char *r, const unsigned char *g, const unsigned char *b, size_t pixels,
+                          float *h, float *s, float *v) {
+    PG_RGB_TO_HSV_BODY(_mm, __m128, 4)
+}
+
+PG_TARGET("avx2")
+inline void rgbToHsvAVX2(const unsigned char *r, const unsigned char *g, const unsigned char *b, size_t pixels,
+                         float *h, float *s, float *v) {
+    PG_RGB_TO_HSV_BODY(_mm256, __m256, 8)
+}
+
+PG_TARGET("ssse3")
+inline void rgbToHslSSSE3(const unsigned char *r, const unsigned char *g, const unsigned char *b, size_t pixels,
+                          float *h, float *s, float *l) {
+    PG_RGB_TO_HSL_BODY(_mm, __m128, 4)
+}
+
+PG_TARGET("avx2")
+inline void rgbToHslAVX2(const unsigned char *r, const unsigned char *g, const unsigned char *b, size_t pixels,
+                         float *h, float *s, float *l) {
+    PG_RGB_TO_HSL_BODY(_mm256, __m256, 8)
+}
+
+PG_TARGET("ssse3")
+inline void hsvToRgbSSSE3(const float *h, const float *s, const float *v, size_t pixels, unsigned char *r,
+                          unsigned char *g, unsigned char *b) {
+    PG_HSV_TO_RGB_BODY(_mm, __m128, 4)
+}
+
+PG_TARGET("avx2")
+inline void hsvToRgbAVX2(const float *h, const float *s, const float *v, size_t pixels, unsigned char *r,
+                         unsigned char *g, unsigned char *b) {
+    PG_HSV_TO_RGB_BODY(_mm256, __m256, 8)
+}
+
+PG_TARGET("ssse3")
+inline void hslToRgbSSSE3(const float *h, const float *s, const float *l, size_t pixels, unsigned char *r,
+                          unsigned char *g, unsigned char *b) {
+    PG_HSL_TO_RGB_BODY(_mm, __m128, 4)
+}
+
+PG_TARGET("avx2")
+inline void hslToRgbAVX2(const float *h, const float *s, const float *l, size_t pixels, unsigned char *r,
+                         unsigned char *g, unsigned char *b) {
+    PG_HSL_TO_RGB_BODY(_mm256, __m256, 8)
+}
+
+PG_TARGET("ssse3")
+inline void hueSatSSSE3(unsigned char *r, unsigned char *g, unsigned char *b, size_t pixels, const HueSat &hs) {
+    PG_HUESAT_BODY(_mm, __m128, 4)
+}
+
+PG_TARGET("avx2")
+inline void hueSatAVX2(unsigned char *r, unsigned char *g, unsigned char *b, size_t pixels, const HueSat &hs) {
+    PG_HUESAT_BODY(_mm256, __m256, 8)
+}
+
+#undef PG_HSX_CONSTS
+#undef PG_HSX_HUE
+#undef PG_HSX_STORE
+#undef PG_HSV_CHANNEL
+#undef PG_HSL_CHANNEL
+#undef PG_HSL_TO_RGB
+#undef PG_HSL_SL
+#undef PG_RGB_TO_HSV_BODY
+#undef PG_RGB_TO_HSL_BODY
+#undef PG_HSV_TO_RGB_BODY
+#undef PG_HSL_TO_RGB_BODY
+#undef PG_HUESAT_BODY
+
+// Tint em 16 bits: cada pista de 128 bits faz 16 pixels em duas metades de
+// 8, com pmulhrsw fazendo o (m64 * k + 2^14) >> 15 do escalar.
+#define PG_TINT_BODY(SUF, VEC, SI, STEP)                                                         \
+    const VEC zero = SUF##_setzero_##SI();                                                       \
+    const VEC c510 = SUF##_set1_epi16(510), one = SUF##_set1_epi16(1);                           \
+    const VEC k[3] = {SUF##_set1_epi16(t.k[0]), SUF##_set1_epi16(t.k[1]), SUF##_set1_epi16(t.k[2])}; \
+    unsigned char *planes[3] = {r, g, b};                                                        \
+    size_t i = 0;                                                                                \
+    for (; i + STEP <= pixels; i += STEP) {                                                      \
+        VEC rv = SUF##_loadu_##SI((const VEC *)(r + i));                                         \
+        VEC gv = SUF##_loadu_##SI((const VEC *)(g + i));                                         \
+        VEC bv = SUF##_loadu_##SI((const VEC *)(b + i));                                         \
+        VEC mx = SUF##_max_epu8(rv, SUF##_max_epu8(gv, bv));                                     \
+        VEC mn = SUF##_min_epu8(rv, SUF##_min_epu8(gv, bv));                                     \
+        VEC l2[2] = {SUF##_add_epi16(SUF##_unpacklo_epi8(mx, zero), SUF##_unpacklo_epi8(mn, zero)), \
+                     SUF##_add_epi16(SUF##_unpackhi_epi8(mx, zero), SUF##_unpackhi_epi8(mn, zero))}; \
+        VEC m64[2];                                                                              \
+        for (int hh = 0; hh < 2; hh++) {                                                         \
+            m64[hh] = SUF##_slli_epi16(SUF##_min_epi16(l2[hh], SUF##_sub_epi16(c510, l2[hh])), 6); \
+        }                                                                                        \
+        for (int c = 0; c < 3; c++) {                                                            \
+            VEC o[2];                                                                            \
+            for (int hh = 0; hh < 2; hh++) {                                                     \
+                VEC delta = SUF##_mulhrs_epi16(m64[hh], k[c]);                                   \
+                o[hh] = SUF##_srai_epi16(SUF##_add_epi16(SUF##_add_epi16(l2[hh], delta), one), 1); \
+            }                                                                                    \
+            SUF##_storeu_##SI((VEC *)(planes[c] + i), SUF##_packus_epi16(o[0], o[1]));           \
+        }                                                                                        \
+    }                                                                                            \
+    tintScalar(r + i, g + i, b + i, pixels - i, t);
+
+PG_TARGET("ssse3")
+inline void tintSSSE3(unsigned char *r, unsigned char *g, unsigned char *b, size_t pixels, const Tint &t) {
+    PG_TINT_BODY(_mm, __m128i, si128, 16)
+}
+
+PG_TARGET("avx2")
+inline void tintAVX2(unsigned char *r, unsigned char *g, unsigned char *b, size_t pixels, const Tint &t) {
+    PG_TINT_BODY(_mm256, __m256i, si256, 32)
+}
+
+PG_TARGET("avx512f,avx512bw")
+inline void tintAVX512(unsigned char *r, unsigned char *g, unsigned char *b, size_t pixels, const Tint &t) {
+    PG_TINT_BODY(_mm512, __m512i, si512, 64)
+}
+
+#undef PG_TINT_BODY
+
+#endif /* PG_SIMD_X86 */
+
+typedef void (*RgbToHsxKernel)(const unsigned char *r, const unsigned char *g, const unsigned char *b,
+                               size_t pixels, float *h, float *s, float *x);
+typedef void (*HsxToRgbKernel)(const float *h, const float *s, const float *x, size_t pixels, unsigned char *r,
+                               unsigned char *g, unsigned char *b);
+typedef void (*HueSatKernel)(unsigned char *r, unsigned char *g, unsigned char *b, size_t pixels,
+                             const HueSat &hs);
+typedef void (*TintKernel)(unsigned char *r, unsigned char *g, unsigned char *b, size_t pixels, const Tint &t);
+
+inline RgbToHsxKernel rgbToHsvKernelFor(SimdLevel level) {
+#if PG_SIMD_X86
+    switch (level) {
+        case SIMD_AVX512:
+        case SIMD_AVX2:   return rgbToHsvAVX2;
+        case SIMD_SSSE3:  return rgbToHsvSSSE3;
+        default:          break;
+    }
+#else
+    (void)level;
+#endif
+    return rgbToHsvScalar;
+}
+
+inline RgbToHsxKernel rgbToHslKernelFor(SimdLevel level) {
+#if PG_SIMD_X86
+    switch (level) {
+        case SIMD_AVX512:
+        case SIMD_AVX2:   return rgbToHslAVX2;
+        case SIMD_SSSE3:  return rgbToHslSSSE3;
+        default:          break;
+    }
+#else
+    (void)level;
+#endif
+    return rgbToHslScalar;
+}
+
+inline HsxToRgbKernel hsvToRgbKernelFor(SimdLevel level) {
+#if PG_SIMD_X86
+    switch (level) {
+        case SIMD_AVX512:
+        case SIMD_AVX2:   return hsvToRgbAVX2;
+        case SIMD_SSSE3:  return hsvToRgbSSSE3;
+        default:          break;
+    }
+#else
+    (void)level;
+#endif
+    return hsvToRgbScalar;
+}
+
+inline HsxToRgbKernel hslToRgbKernelFor(SimdLevel level) {
+#if PG_SIMD_X86
+    switch (level) {
+        case SIMD_AVX512:
+        case SIMD_AVX2:   return hslToRgbAVX2;
+        case SIMD_SSSE3:  return hslToRgbSSSE3;
+        default:          break;
+    }
+#else
+    (void)level;
+#endif
+    return hslToRgbScalar;
+}
+
+inline HueSatKernel hueSatKernelFor(SimdLevel level) {
+#if PG_SIMD_X86
+    switch (level) {
+        case SIMD_AVX512:
+        case SIMD_AVX2:   return hueSatAVX2;
+        case SIMD_SSSE3:  return hueSatSSSE3;
+        default:          break;
+    }
+#else
+    (void)level;
+#endif
+    return hueSatScalar;
+}
+
+inline TintKernel tintKernelFor(SimdLevel level) {
+#if PG_SIMD_X86
+    switch (level) {
+        case SIMD_AVX512: return tintAVX512;
+        case SIMD_AVX2:   return tintAVX2;
+        case SIMD_SSSE3:  return tintSSSE3;
+        default:          break;
+    }
+#else
+    (void)level;
+#endif
+    return tintScalar;
+}
+
+// ---- RGB intercalado: blocos separados em planos no L1, como cubeLutRgb ----
+
+static const size_t HSX_BLOCK = 4096;
+
+// rgb -> h, s, v (float, 0..1).
+inline void rgbToHsv(const unsigned char *rgb, size_t pixels, float *h, float *s, float *v) {
+    static const RgbToHsxKernel kernel = rgbToHsvKernelFor(activeSimdLevel());
+    alignas(64) unsigned char planes[3][HSX_BLOCK];
+    for (size_t i = 0; i < pixels; i += HSX_BLOCK) {
+        size_t n = min(pixels - i, HSX_BLOCK);
+        deinterleaveRgb(rgb + i * 3, n, planes[0], planes[1], planes[2]);
+        kernel(planes[0], planes[1], planes[2], n, h + i, s + i, v + i);
+    }
+}
+
+inline void rgbToHsl(const unsigned char *rgb, size_t pixels, float *h, float *s, float *l) {
+    static const RgbToHsxKernel kernel = rgbToHslKernelFor(activeSimdLevel());
+    alignas(64) unsigned char planes[3][HSX_BLOCK];
+    for (size_t i = 0; i < pixels; i += HSX_BLOCK) {
+        size_t n = min(pixels - i, HSX_BLOCK);
+        deinterleaveRgb(rgb + i * 3, n, planes[0], planes[1], planes[2]);
+        kernel(planes[0], planes[1], planes[2], n, h + i, s + i, l + i);
+    }
+}
+
+// h, s, v (h em [0, 1]) -> rgb.
+inline void hsvToRgb(const float *h, const float *s, const float *v, size_t pixels, unsigned char *rgb) {
+    static const HsxToRgbKernel kernel = hsvToRgbKernelFor(activeSimdLevel());
+    alignas(64) unsigned char planes[3][HSX_BLOCK];
+    for (size_t i = 0; i < pixels; i += HSX_BLOCK) {
+        size_t n = min(pixels - i, HSX_BLOCK);
+        kernel(h + i, s + i, v + i, n, planes[0], planes[1], planes[2]);
+        interleaveRgb(planes[0], planes[1], planes[2], n, rgb + i * 3);
+    }
+}
+
+inline void hslToRgb(const float *h, const float *s, const float *l, size_t pixels, unsigned char *rgb) {
+    static const HsxToRgbKernel kernel = hslToRgbKernelFor(activeSimdLevel());
+    alignas(64) unsigned char planes[3][HSX_BLOCK];
+    for (size_t i = 0; i < pixels; i += HSX_BLOCK) {
+        size_t n = min(pixels - i, HSX_BLOCK);
+        kernel(h + i, s + i, l + i, n, planes[0], planes[1], planes[2]);
+        interleaveRgb(planes[0], planes[1], planes[2], n, rgb + i * 3);
+    }
+}
+
+inline void hueSatPlanes(unsigned char *r, unsigned char *g, unsigned char *b, size_t pixels, const HueSat &hs) {
+    static const HueSatKernel kernel = hueSatKernelFor(activeSimdLevel());
+    kernel(r, g, b, pixels, hs);
+}
+
+inline void tintPlanes(unsigned char *r, unsigned char *g, unsigned char *b, size_t pixels, const Tint &t) {
+    static const TintKernel kernel = tintKernelFor(activeSimdLevel());
+    kernel(r, g, b, pixels, t);
+}
+
+inline void hueSatRgb(unsigned char *data, size_t pixels, const HueSat &hs) {
+    alignas(64) unsigned char planes[3][HSX_BLOCK];
+    for (size_t i = 0; i < pixels; i += HSX_BLOCK) {
+        size_t n = min(pixels - i, HSX_BLOCK);
+        unsigned char *p = data + i * 3;
+        deinterleaveRgb(p, n, planes[0], planes[1], planes[2]);
+        hueSatPlanes(planes[0], planes[1], planes[2], n, hs);
+        interleaveRgb(planes[0], planes[1], planes[2], n, p);
+    }
+}
+
+inline void tintRgb(unsigned char *data, size_t pixels, const Tint &t) {
+    alignas(64) unsigned char planes[3][HSX_BLOCK];
+    for (size_t i = 0; i < pixels; i += HSX_BLOCK) {
+        size_t n = min(pixels - i, HSX_BLOCK);
+        unsigned char *p = data + i * 3;
+        deinterleaveRgb(p, n, planes[0], planes[1], planes[2]);
+        tintPlanes(planes[0], planes[1], planes[2], n, t);
+        interleaveRgb(planes[0], planes[1], planes[2], n, p);
+    }
+}
+
+inline void applyHueSat(unsigned char *data, int w, int h, const HueSat &hs) {
+    parallelPixels(data, w, h, [&](unsigned char *band, size_t pixels, size_t) { hueSatRgb(band, pixels, hs); });
+}
+
+inline void applyTint(unsigned char *data, int w, int h, const Tint &t) {
+    parallelPixels(data, w, h, [&](unsigned char *band, size_t pixels, size_t) { tintRgb(band, pixels, t); });
+}
+
+#endif /* ColorSpace_h */
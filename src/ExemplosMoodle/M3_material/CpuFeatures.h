@@ -0,0 +1,79 @@
+//
+//  CpuFeatures.h
+//  Detecção, em tempo de execução, do conjunto de instruções SIMD disponível.
+//
+//  Os kernels vetoriais são compilados com __attribute__((target(...))), então
+//  o executável roda em qualquer x86-64 e escolhe a versão na primeira chamada.
+//  Fora de x86 (ou fora de GCC/Clang) só a versão escalar existe.
+//
+
+#ifndef CpuFeatures_h
+#define CpuFeatures_h
+
+#include <stdlib.h>
+#include <string.h>
+
+#if (defined(__GNUC__) || defined(__clang__)) && (defined(__x86_64__) || defined(__i386__))
+#define PG_SIMD_X86 1
+// GCC 12 avisa sobre os _mm512_undefined_* dos próprios cabeçalhos
+// (-Wmaybe-uninitialized, falso positivo); silenciado só dentro deles
+#if defined(__GNUC__) && !defined(__clang__)
+#pragma GCC diagnostic push
+#pragma GCC diagnostic ignored "-Wmaybe-uninitialized"
+#include <immintrin.h>
+#pragma GCC diagnostic pop
+#else
+#include <immintrin.h>
+#endif
+#define PG_TARGET(isa) __attribute__((target(isa)))
+#else
+#define PG_SIMD_X86 0
+#endif
+
+enum SimdLevel {
+    SIMD_SCALAR = 0,
+    SIMD_SSSE3,
+    SIMD_AVX2,
+    SIMD_AVX512,
+    SIMD_LEVEL_COUNT
+};
+
+inline const char *simdLevelName(SimdLevel level) {
+    switch (level) {
+        case SIMD_SSSE3:  return "ssse3";
+        case SIMD_AVX2:   return "avx2";
+        case SIMD_AVX512: return "avx512";
+        default:          return "scalar";
+    }
+}
+
+// Maior nível suportado pela CPU (e pelo sistema operacional, no caso de AVX).
+inline SimdLevel cpuSimdLevel() {
+#if PG_SIMD_X86
+    __builtin_cpu_init();
+    if (__builtin_cpu_supports("avx512bw")) return SIMD_AVX512;
+    if (__builtin_cpu_supports("avx2")) return SIMD_AVX2;
+    if (__builtin_cpu_supports("ssse3")) return SIMD_SSSE3;
+#endif
+    return SIMD_SCALAR;
+}
+
+// Nível usado pelos filtros: o da CPU, limitado pela variável de ambiente
+// PG_SIMD (scalar, ssse3, avx2 ou avx512), útil para comparar as versões.
+inline SimdLevel activeSimdLevel() {
+    static const SimdLevel level = []() {
+        SimdLevel cpu = cpuSimdLevel();
+        const char *env = getenv("PG_SIMD");
+        if (env) {
+            for (int l = SIMD_SCALAR; l < SIMD_LEVEL_COUNT; l++) {
+                if (strcmp(env, simdLevelName((SimdLevel)l)) == 0 && l < cpu) {
+                    return (SimdLevel)l;
+                }
+            }
+        }
+        return cpu;
+    }();
+    return level;
+}
+
+#endif /* CpuFeatures_h */
@@ -0,0 +1,367 @@
+//
+//  CubeLut.h
+//  LUT 3D de cor (.cube, o formato da Adobe/Resolve) com interpolação
+//  tetraédrica.
+//
+//  A tabela tem N^3 nós (17, 33 e 65 são os tamanhos comuns); cada pixel
+//  cai num cubo da grade, que é cortado em 6 tetraedros pela diagonal
+//  preta-branca. Ordenando as frações dos três eixos, o tetraedro sai direto
+//  e o resultado é a soma de 4 nós com pesos (1 - max, max - meio,
+//  meio - min, min).
+//
+//  Tudo em inteiros: frações em 1/255, nós com 10 bits por canal (1/4 de
+//  nível de 8 bits) empacotados num uint32, de modo que um nó custa uma
+//  única leitura (um gather nos kernels AVX2/AVX-512). O kernel trabalha
+//  sobre planos; a versão para RGB intercalado separa os canais por bloco.
+//
+
+#ifndef CubeLut_h
+#define CubeLut_h
+
+#include <algorithm>
+#include <ctype.h>
+#include <fstream>
+#include <math.h>
+#include <stdint.h>
+#include <stdlib.h>
+#include <string>
+#include <vector>
+
+#include "CpuFeatures.h"
+#include "PlanarImage.h"
+#include "ThreadPool.h"
+
+using namespace std;
+
+class CubeLut {
+public:
+    static const int MIN_SIZE = 2;
+    static const int MAX_SIZE = 256; // v * (N - 1) precisa caber em 16 bits
+
+    // Lê um arquivo .cube. Só LUT_3D_SIZE com DOMAIN 0..1 (o padrão).
+    bool load(const string &path, string &error) {
+        ifstream in(path);
+        if (!in) {
+            error = "não foi possível abrir " + path;
+            return false;
+        }
+        n = 0;
+        nodes.clear();
+        title.clear();
+        size_t count = 0;
+        string line;
+        int lineNo = 0;
+        while (getline(in, line)) {
+            lineNo++;
+            size_t a = line.find_first_not_of(" \t\r");
+            if (a == string::npos || line[a] == '#') continue;
+            const char *s = line.c_str() + a;
+            if (isalpha((unsigned char)*s)) {
+                if (!keyword(s, error)) {
+                    error = path + ":" + to_string(lineNo) + ": " + error;
+                    return false;
+                }
+                continue;
+            }
+            double v[3];
+            char *end;
+            for (int c = 0; c < 3; c++) {
+                v[c] = strtod(s, &end);
+                if (end == s) {
+                    error = path + ":" + to_string(lineNo) + ": esperava três números";
+                    return false;
+                }
+                s = end;
+            }
+            if (n == 0 || count >= nodes.size()) {
+                error = path + ":" + to_string(lineNo) + (n ? ": nós demais" : ": nós antes de LUT_3D_SIZE");
+                return false;
+            }
+            // R varia mais rápido, depois G, depois B: o mesmo índice da tabela
+            nodes[count++] = pack(v[0], v[1], v[2]);
+        }
+        if (n == 0 || count != nodes.size()) {
+            error = path + ": esperava " + to_string((size_t)n * n * n) + " nós, encontrou " + to_string(count);
+            return false;
+        }
+        return true;
+    }
+
+    // Tabela de n^3 nós com f(r, g, b) -> (R, G, B), tudo em 0..1.
+    template <typename F>
+    void generate(int size, F f) {
+        n = size;
+        nodes.resize((size_t)n * n * n);
+        size_t i = 0;
+        for (int b = 0; b < n; b++) {
+            for (int g = 0; g < n; g++) {
+                for (int r = 0; r < n; r++) {
+                    double out[3];
+                    f((double)r / (n - 1), (double)g / (n - 1), (double)b / (n - 1), out);
+                    nodes[i++] = pack(out[0], out[1], out[2]);
+                }
+            }
+        }
+    }
+
+    int size() const { return n; }
+    const string &getTitle() const { return title; }
+    // nó (r, g, b) em nodes[r + g * N + b * N^2]: R | G << 10 | B << 20, 0..1020
+    const uint32_t *data() const { return nodes.data(); }
+
+    static uint32_t pack(double r, double g, double b) {
+        return quantize(r) | quantize(g) << 10 | quantize(b) << 20;
+    }
+
+private:
+    static uint32_t quantize(double v) {
+        if (!(v > 0)) return 0;
+        if (v >= 1) return 1020;
+        return (uint32_t)lround(v * 1020);
+    }
+
+    bool keyword(const char *s, string &error) {
+        string key;
+        while (*s && !isspace((unsigned char)*s)) key += *s++;
+        if (key == "TITLE") {
+            title = s;
+            return true;
+        }
+        if (key == "LUT_3D_SIZE") {
+            long size = strtol(s, nullptr, 10);
+            if (size < MIN_SIZE || size > MAX_SIZE) {
+                error = "LUT_3D_SIZE fora de " + to_string(MIN_SIZE) + ".." + to_string(MAX_SIZE);
+                return false;
+            }
+            n = (int)size;
+            nodes.assign((size_t)n * n * n, 0);
+            return true;
+        }
+        if (key == "DOMAIN_MIN" || key == "DOMAIN_MAX") {
+            double expect = key == "DOMAIN_MIN" ? 0.0 : 1.0;
+            for (int c = 0; c < 3; c++) {
+                char *end;
+                double v = strtod(s, &end);
+                if (end == s || v != expect) {
+                    error = key + " diferente de " + (expect ? "1 1 1" : "0 0 0") + " não é suportado";
+                    return false;
+                }
+                s = end;
+            }
+            return true;
+        }
+        if (key == "LUT_1D_SIZE") {
+            error = "LUT 1D não é suportada (só LUT_3D_SIZE)";
+            return false;
+        }
+        error = "palavra-chave desconhecida: " + key;
+        return false;
+    }
+
+    int n = 0;
+    vector<uint32_t> nodes;
+    string title;
+};
+
+// Posição do valor v (0..255) num eixo de n nós: índice da célula e fração
+// em 1/255. p / 255 = (p * 32897) >> 23, exato para p <= 65535.
+inline void cubeAxis(int v, int n, int &index, int &frac) {
+    int p = v * (n - 1);
+    index = (int)(((uint32_t)p * 32897u) >> 23);
+    if (index > n - 2) index = n - 2;
+    frac = p - index * 255;
+}
+
+// Soma ponderada de um canal (deslocamento shift) nos 4 nós, de volta para
+// 0..255: nós em quartos de nível, pesos somando 255, / 1020 arredondado.
+inline int cubeBlend(uint32_t c0, uint32_t c1, uint32_t c2, uint32_t c3, int w0, int w1, int w2, int w3,
+                     int shift) {
+    int s = w0 * (int)((c0 >> shift) & 1023) + w1 * (int)((c1 >> shift) & 1023)
+          + w2 * (int)((c2 >> shift) & 1023) + w3 * (int)((c3 >> shift) & 1023);
+    return (s * 257 + (1 << 17)) >> 18;
+}
+
+inline void cubeLutPixel(const uint32_t *nodes, int n, unsigned char &r, unsigned char &g, unsigned char &b) {
+    int ir, ig, ib, fr, fg, fb;
+    cubeAxis(r, n, ir, fr);
+    cubeAxis(g, n, ig, fg);
+    cubeAxis(b, n, ib, fb);
+    int n2 = n * n, all = 1 + n + n2;
+    int mx = max(fr, max(fg, fb));
+    int mn = min(fr, min(fg, fb));
+    int md = fr + fg + fb - mx - mn;
+    // eixo do maior (empate: R, depois G) e do menor (empate: B, depois G)
+    int sMax = fr == mx ? 1 : (fg == mx ? n : n2);
+    int sMin = fb == mn ? n2 : (fg == mn ? n : 1);
+    size_t base = (size_t)ir + (size_t)ig * n + (size_t)ib * n2;
+    uint32_t c0 = nodes[base], c1 = nodes[base + sMax], c2 = nodes[base + all - sMin], c3 = nodes[base + all];
+    int w0 = 255 - mx, w1 = mx - md, w2 = md - mn, w3 = mn;
+    r = (unsigned char)cubeBlend(c0, c1, c2, c3, w0, w1, w2, w3, 0);
+    g = (unsigned char)cubeBlend(c0, c1, c2, c3, w0, w1, w2, w3, 10);
+    b = (unsigned char)cubeBlend(c0, c1, c2, c3, w0, w1, w2, w3, 20);
+}
+
+// Planos R, G e B in-place.
+inline void cubeLutScalar(unsigned char *r, unsigned char *g, unsigned char *b, size_t pixels, const CubeLut &lut) {
+    const uint32_t *nodes = lut.data();
+    int n = lut.size();
+    for (size_t i = 0; i < pixels; i++) cubeLutPixel(nodes, n, r[i], g[i], b[i]);
+}
+
+#if PG_SIMD_X86
+
+// Diferenças entre AVX2 e AVX-512 que o corpo comum não enxerga: carga e
+// gravação de bytes, seleção por igualdade e gather.
+PG_TARGET("avx2")
+inline void cubeLoadBytes(const unsigned char *p, __m256i &v) { v = _mm256_cvtepu8_epi32(_mm_loadl_epi64((const __m128i *)p)); }
+
+PG_TARGET("avx2")
+inline void cubeStoreBytes(unsigned char *p, __m256i v) {
+    __m256i x = _mm256_packus_epi16(_mm256_packus_epi32(v, v), _mm256_setzero_si256());
+    x = _mm256_permutevar8x32_epi32(x, _mm256_setr_epi32(0, 4, 1, 1, 1, 1, 1, 1));
+    _mm_storel_epi64((__m128i *)p, _mm256_castsi256_si128(x));
+}
+
+// a == b ? y : x
+PG_TARGET("avx2")
+inline __m256i cubePick(__m256i a, __m256i b, __m256i x, __m256i y) {
+    return _mm256_blendv_epi8(x, y, _mm256_cmpeq_epi32(a, b));
+}
+
+PG_TARGET("avx2")
+inline __m256i cubeGather(const uint32_t *nodes, __m256i idx) {
+    return _mm256_i32gather_epi32((const int *)nodes, idx, 4);
+}
+
+PG_TARGET("avx512f,avx512bw")
+inline void cubeLoadBytes(const unsigned char *p, __m512i &v) { v = _mm512_cvtepu8_epi32(_mm_loadu_si128((const __m128i *)p)); }
+
+PG_TARGET("avx512f,avx512bw")
+inline void cubeStoreBytes(unsigned char *p, __m512i v) { _mm_storeu_si128((__m128i *)p, _mm512_cvtepi32_epi8(v)); }
+
+PG_TARGET("avx512f,avx512bw")
+inline __m512i cubePick(__m512i a, __m512i b, __m512i x, __m512i y) {
+    return _mm512_mask_blend_epi32(_mm512_cmpeq_epi32_mask(a, b), x, y);
+}
+
+PG_TARGET("avx512f,avx512bw")
+inline __m512i cubeGather(const uint32_t *nodes, __m512i idx) {
+    return _mm512_i32gather_epi32(idx, (const int *)nodes, 4);
+}
+
+// Um pixel por pista de 32 bits. v * (n - 1) e ig + ib * n cabem em 16 bits
+// e saem de madd; p / 255 vem de mulhi_epu16. Os pares de nós (c0, c1) e
+// (c2, c3) de cada canal são juntados em 16 + 16 bits para que madd faça
+// dois produtos e a soma de uma vez.
+#define PG_CUBE_AXIS(SUF, VEC, v, idx, frac)                                                  \
+    {                                                                                    \
+        VEC p_ = SUF##_madd_epi16(v, nm1);                                               \
+        idx = SUF##_min_epi32(SUF##_srli_epi32(SUF##_mulhi_epu16(p_, div255), 7), nm2);  \
+        frac = SUF##_sub_epi32(p_, SUF##_sub_epi32(SUF##_slli_epi32(idx, 8), idx));      \
+    }
+
+#define PG_CUBE_BODY(SUF, VEC, SI, STEP)                                                             \
+    const uint32_t *nodes = lut.data();                                                              \
+    const int n = lut.size();                                                                        \
+    const VEC nm1 = SUF##_set1_epi32(n - 1), nm2 = SUF##_set1_epi32(n - 2);                          \
+    const VEC div255 = SUF##_set1_epi32(32897);                                                      \
+    const VEC vn = SUF##_set1_epi32(n), vn2 = SUF##_set1_epi32(n * n), one = SUF##_set1_epi32(1);    \
+    const VEC all = SUF##_set1_epi32(1 + n + n * n), full = SUF##_set1_epi32(255);                   \
+    const VEC low10 = SUF##_set1_epi32(1023), high10 = SUF##_set1_epi32(1023 << 16);                 \
+    const VEC half = SUF##_set1_epi32(1 << 17);                                                      \
+    size_t i = 0;                                                                                    \
+    for (; i + STEP <= pixels; i += STEP) {                                                          \
+        VEC vr, vg, vb, ir, ig, ib, fr, fg, fb;                                                      \
+        cubeLoadBytes(r + i, vr);                                                                    \
+        cubeLoadBytes(g + i, vg);                                                                    \
+        cubeLoadBytes(b + i, vb);                                                                    \
+        PG_CUBE_AXIS(SUF, VEC, vr, ir, fr)                                                                \
+        PG_CUBE_AXIS(SUF, VEC, vg, ig, fg)                                                                \
+        PG_CUBE_AXIS(SUF, VEC, vb, ib, fb)                                                                \
+        VEC base = SUF##_add_epi32(ir, SUF##_mullo_epi32(                                            \
+                       SUF##_add_epi32(SUF##_madd_epi16(ib, vn), ig), vn));                          \
+        VEC mx = SUF##_max_epi32(fr, SUF##_max_epi32(fg, fb));                                       \
+        VEC mn = SUF##_min_epi32(fr, SUF##_min_epi32(fg, fb));                                       \
+        VEC md = SUF##_sub_epi32(SUF##_add_epi32(fr, SUF##_add_epi32(fg, fb)), SUF##_add_epi32(mx, mn)); \
+        VEC sMax = cubePick(fr, mx, cubePick(fg, mx, vn2, vn), one);                                 \
+        VEC sMin = cubePick(fb, mn, cubePick(fg, mn, one, vn), vn2);                                 \
+        VEC c0 = cubeGather(nodes, base);                                                            \
+        VEC c1 = cubeGather(nodes, SUF##_add_epi32(base, sMax));                                     \
+        VEC c2 = cubeGather(nodes, SUF##_sub_epi32(SUF##_add_epi32(base, all), sMin));               \
+        VEC c3 = cubeGather(nodes, SUF##_add_epi32(base, all));                                      \
+        /* pesos em pares de 16 bits: (w0, w1) e (w2, w3) */                                         \
+        VEC w01 = SUF##_or_##SI(SUF##_sub_epi32(full, mx), SUF##_slli_epi32(SUF##_sub_epi32(mx, md), 16)); \
+        VEC w23 = SUF##_or_##SI(SUF##_sub_epi32(md, mn), SUF##_slli_epi32(mn, 16));                  \
+        VEC out[3];                                                                                  \
+        for (int ch = 0; ch < 3; ch++) {                                                             \
+            int sh = 10 * ch;                                                                        \
+            VEC p01 = SUF##_or_##SI(SUF##_and_##SI(SUF##_srli_epi32(c0, sh), low10),                 \
+                                    SUF##_and_##SI(SUF##_slli_epi32(SUF##_srli_epi32(c1, sh), 16), high10)); \
+            VEC p23 = SUF##_or_##SI(SUF##_and_##SI(SUF##_srli_epi32(c2, sh), low10),                 \
+                                    SUF##_and_##SI(SUF##_slli_epi32(SUF##_srli_epi32(c3, sh), 16), high10)); \
+            VEC s = SUF##_add_epi32(SUF##_madd_epi16(p01, w01), SUF##_madd_epi16(p23, w23));         \
+            /* (s * 257 + 2^17) >> 18 */                                                             \
+            out[ch] = SUF##_srli_epi32(SUF##_add_epi32(SUF##_add_epi32(SUF##_slli_epi32(s, 8), s), half), 18); \
+        }                                                                                            \
+        cubeStoreBytes(r + i, out[0]);                                                               \
+        cubeStoreBytes(g + i, out[1]);                                                               \
+        cubeStoreBytes(b + i, out[2]);                                                               \
+    }                                                                                                \
+    cubeLutScalar(r + i, g + i, b + i, pixels - i, lut);
+
+PG_TARGET("avx2")
+inline void cubeLutAVX2(unsigned char *r, unsigned char *g, unsigned char *b, size_t pixels, const CubeLut &lut) {
+    PG_CUBE_BODY(_mm256, __m256i, si256, 8)
+}
+
+PG_TARGET("avx512f,avx512bw")
+inline void cubeLutAVX512(unsigned char *r, unsigned char *g, unsigned char *b, size_t pixels, const CubeLut &lut) {
+    PG_CUBE_BODY(_mm512, __m512i, si512, 16)
+}
+
+#undef PG_CUBE_AXIS
+#undef PG_CUBE_BODY
+
+#endif /* PG_SIMD_X86 */
+
+typedef void (*CubeLutKernel)(unsigned char *r, unsigned char *g, unsigned char *b, size_t pixels,
+                              const CubeLut &lut);
+
+// Sem gather no SSSE3: abaixo de AVX2 fica a versão escalar.
+inline CubeLutKernel cubeLutKernelFor(SimdLevel level) {
+#if PG_SIMD_X86
+    switch (level) {
+        case SIMD_AVX512: return cubeLutAVX512;
+        case SIMD_AVX2:   return cubeLutAVX2;
+        default:          break;
+    }
+#else
+    (void)level;
+#endif
+    return cubeLutScalar;
+}
+
+inline void cubeLutPlanes(unsigned char *r, unsigned char *g, unsigned char *b, size_t pixels, const CubeLut &lut) {
+    static const CubeLutKernel kernel = cubeLutKernelFor(activeSimdLevel());
+    kernel(r, g, b, pixels, lut);
+}
+
+// RGB intercalado: cada bloco é separado em planos (no L1), passa pela LUT
+// e é juntado de volta.
+inline void cubeLutRgb(unsigned char *data, size_t pixels, const CubeLut &lut) {
+    const size_t BLOCK = 4096;
+    alignas(64) unsigned char planes[3][BLOCK];
+    for (size_t i = 0; i < pixels; i += BLOCK) {
+        size_t n = pixels - i < BLOCK ? pixels - i : BLOCK;
+        unsigned char *p = data + i * 3;
+        deinterleaveRgb(p, n, planes[0], planes[1], planes[2]);
+        cubeLutPlanes(planes[0], planes[1], planes[2], n, lut);
+        interleaveRgb(planes[0], planes[1], planes[2], n, p);
+    }
+}
+
+inline void applyCubeLut(unsigned char *data, int w, int h, const CubeLut &lut) {
+    parallelPixels(data, w, h, [&](unsigned char *band, size_t pixels, size_t) { cubeLutRgb(band, pixels, lut); });
+}
+
+#endif /* CubeLut_h */
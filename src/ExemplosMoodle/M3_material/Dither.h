@@ -0,0 +1,374 @@
+//
+//  Dither.h
+//  Redução de cores: paleta por median-cut (refinada ou não por k-means) e
+//  difusão de erro Floyd–Steinberg ou Atkinson, com threads.
+//
+//  Paleta: as cores da imagem são contadas num histograma de 15 bits (5 por
+//  canal), cada thread num histograma próprio que guarda também a soma das
+//  cores exatas de cada célula. O median-cut divide as caixas de células
+//  pela mediana do canal mais longo; o k-means parte dessa paleta e move
+//  cada cor para a média das células mais próximas dela, com as células
+//  repartidas entre as threads.
+//
+//  Difusão de erro: o pixel (x, y) recebe erro de (x-1, y), de (x-1..x+1,
+//  y-1) e, no Atkinson, de (x-2, y) e (x, y-2). A linha y pode então
+//  processar a coluna x assim que a linha y-1 passou da coluna x+1: as
+//  linhas andam em frente de onda diagonal, cada thread com uma linha,
+//  esperando a de cima em trechos de DITHER_CHUNK colunas. O erro
+//  espalhado para baixo fica em DITHER_SLOTS linhas de acumuladores
+//  reaproveitadas em anel; o da própria linha fica em registradores. As
+//  contas são inteiras (1/16), então o resultado é o mesmo com qualquer
+//  número de threads.
+//
+//  A cor mais próxima vem de um mapa inverso de 32x32x32 células calculado
+//  para a paleta (a cor da paleta mais próxima do centro da célula).
+//
+
+#ifndef Dither_h
+#define Dither_h
+
+#include <algorithm>
+#include <atomic>
+#include <stdint.h>
+#include <string.h>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include "ThreadPool.h"
+
+using namespace std;
+
+struct Palette {
+    int size = 0;
+    unsigned char colors[256][3];
+};
+
+enum PaletteMethod {
+    PALETTE_MEDIAN_CUT,
+    PALETTE_KMEANS,
+};
+
+enum DitherMethod {
+    DITHER_NONE,
+    DITHER_FLOYD_STEINBERG,
+    DITHER_ATKINSON,
+};
+
+inline bool parsePaletteMethod(const string &name, PaletteMethod &m) {
+    if (name == "mediancut" || name == "median") {
+        m = PALETTE_MEDIAN_CUT;
+    } else if (name == "kmeans") {
+        m = PALETTE_KMEANS;
+    } else {
+        return false;
+    }
+    return true;
+}
+
+inline bool parseDitherMethod(const string &name, DitherMethod &m) {
+    if (name == "none" || name == "nenhum") {
+        m = DITHER_NONE;
+    } else if (name == "fs" || name == "floyd") {
+        m = DITHER_FLOYD_STEINBERG;
+    } else if (name == "atkinson") {
+        m = DITHER_ATKINSON;
+    } else {
+        return false;
+    }
+    return true;
+}
+
+static const int COLOR_CELLS = 32 * 32 * 32;
+
+inline int colorCell(int r, int g, int b) { return ((r >> 3) << 10) | ((g >> 3) << 5) | (b >> 3); }
+
+// Histograma de 15 bits com a soma das cores exatas de cada célula.
+struct ColorHistogram {
+    vector<uint32_t> count;
+    vector<uint64_t> sum; // r, g, b por célula
+
+    ColorHistogram() : count(COLOR_CELLS), sum((size_t)COLOR_CELLS * 3) {}
+
+    void add(const ColorHistogram &o) {
+        for (int i = 0; i < COLOR_CELLS; i++) count[i] += o.count[i];
+        for (size_t i = 0; i < sum.size(); i++) sum[i] += o.sum[i];
+    }
+
+    // Média das cores da célula i (que precisa ter count > 0).
+    void mean(int i, double rgb[3]) const {
+        for (int c = 0; c < 3; c++) rgb[c] = (double)sum[(size_t)i * 3 + c] / count[i];
+    }
+};
+
+// Uma tarefa por thread sobre trechos contíguos de pixels.
+inline void colorHistogram(const unsigned char *rgb, size_t pixels, ColorHistogram &hist,
+                           ThreadPool &pool = ThreadPool::shared()) {
+    size_t tasks = pool.size();
+    vector<ColorHistogram> parts(tasks);
+    pool.run(tasks, [&](size_t t) {
+        ColorHistogram &h = parts[t];
+        const unsigned char *p = rgb + pixels * t / tasks * 3;
+        const unsigned char *end = rgb + pixels * (t + 1) / tasks * 3;
+        for (; p < end; p += 3) {
+            int i = colorCell(p[0], p[1], p[2]);
+            h.count[i]++;
+            h.sum[(size_t)i * 3] += p[0];
+            h.sum[(size_t)i * 3 + 1] += p[1];
+            h.sum[(size_t)i * 3 + 2] += p[2];
+        }
+    });
+    hist = ColorHistogram();
+    for (const ColorHistogram &h : parts) hist.add(h);
+}
+
+// Median-cut sobre as células ocupadas: a caixa com maior (pixels x lado
+// mais longo) é dividida na mediana, pesada pelos pixels, do canal mais
+// longo. Cada caixa vira a média das cores dos seus pixels.
+inline void medianCut(const ColorHistogram &hist, int colors, Palette &pal) {
+    struct Box {
+        vector<int> cells;
+        uint64_t pixels = 0;
+        int axis = 0, range = 0;
+    };
+    auto measure = [&](Box &box) {
+        int lo[3] = {31, 31, 31}, hi[3] = {0, 0, 0};
+        box.pixels = 0;
+        for (int i : box.cells) {
+            int v[3] = {i >> 10, (i >> 5) & 31, i & 31};
+            for (int c = 0; c < 3; c++) {
+                lo[c] = min(lo[c], v[c]);
+                hi[c] = max(hi[c], v[c]);
+            }
+            box.pixels += hist.count[i];
+        }
+        box.axis = 0;
+        for (int c = 1; c < 3; c++) {
+            if (hi[c] - lo[c] > hi[box.axis] - lo[box.axis]) box.axis = c;
+        }
+        box.range = hi[box.axis] - lo[box.axis];
+    };
+    vector<Box> boxes(1);
+    for (int i = 0; i < COLOR_CELLS; i++) {
+        if (hist.count[i]) boxes[0].cells.push_back(i);
+    }
+    measure(boxes[0]);
+    while ((int)boxes.size() < colors) {
+        int pick = -1;
+        uint64_t best = 0;
+        for (size_t b = 0; b < boxes.size(); b++) {
+            uint64_t score = boxes[b].pixels * (uint64_t)boxes[b].range;
+            if (boxes[b].cells.size() > 1 && score > best) {
+                best = score;
+                pick = (int)b;
+            }
+        }
+        if (pick < 0) break; // cada caixa já é uma célula só
+        Box &box = boxes[pick];
+        int shift = box.axis == 0 ? 10 : (box.axis == 1 ? 5 : 0);
+        sort(box.cells.begin(), box.cells.end(), [&](int a, int b) {
+            return ((a >> shift) & 31) < ((b >> shift) & 31);
+        });
+        // primeira célula que passa da metade dos pixels, sem esvaziar um lado
+        uint64_t acc = 0;
+        size_t cut = 1;
+        for (; cut < box.cells.size(); cut++) {
+            acc += hist.count[box.cells[cut - 1]];
+            if (acc * 2 >= box.pixels) break;
+        }
+        cut = min(cut, box.cells.size() - 1);
+        Box other;
+        other.cells.assign(box.cells.begin() + cut, box.cells.end());
+        box.cells.resize(cut);
+        measure(box);
+        measure(other);
+        boxes.push_back(std::move(other));
+    }
+    pal.size = (int)boxes.size();
+    for (int b = 0; b < pal.size; b++) {
+        double s[3] = {0, 0, 0};
+        for (int i : boxes[b].cells) {
+            for (int c = 0; c < 3; c++) s[c] += (double)hist.sum[(size_t)i * 3 + c];
+        }
+        for (int c = 0; c < 3; c++) {
+            pal.colors[b][c] = (unsigned char)min(255.0, s[c] / max<uint64_t>(boxes[b].pixels, 1) + 0.5);
+        }
+    }
+}
+
+inline int nearestColor(const Palette &pal, double r, double g, double b) {
+    int best = 0;
+    double bestD = 1e30;
+    for (int k = 0; k < pal.size; k++) {
+        double dr = r - pal.colors[k][0], dg = g - pal.colors[k][1], db = b - pal.colors[k][2];
+        double d = dr * dr + dg * dg + db * db;
+        if (d < bestD) {
+            bestD = d;
+            best = k;
+        }
+    }
+    return best;
+}
+
+// Lloyd sobre as células ocupadas (cada uma com a média e o número dos seus
+// pixels); para quando nenhuma cor se move.
+inline void kmeansRefine(const ColorHistogram &hist, Palette &pal, int iterations,
+                         ThreadPool &pool = ThreadPool::shared()) {
+    vector<int> cells;
+    for (int i = 0; i < COLOR_CELLS; i++) {
+        if (hist.count[i]) cells.push_back(i);
+    }
+    size_t tasks = pool.size();
+    for (int it = 0; it < iterations; it++) {
+        vector<vector<double>> sums(tasks, vector<double>(pal.size * 4, 0.0));
+        pool.run(tasks, [&](size_t t) {
+            vector<double> &s = sums[t];
+            for (size_t j = cells.size() * t / tasks; j < cells.size() * (t + 1) / tasks; j++) {
+                double m[3];
+                hist.mean(cells[j], m);
+                int k = nearestColor(pal, m[0], m[1], m[2]);
+                for (int c = 0; c < 3; c++) s[k * 4 + c] += (double)hist.sum[(size_t)cells[j] * 3 + c];
+                s[k * 4 + 3] += hist.count[cells[j]];
+            }
+        });
+        bool moved = false;
+        for (int k = 0; k < pal.size; k++) {
+            double s[4] = {0, 0, 0, 0};
+            for (size_t t = 0; t < tasks; t++) {
+                for (int c = 0; c < 4; c++) s[c] += sums[t][k * 4 + c];
+            }
+            if (s[3] == 0) continue; // cor sem células: fica onde está
+            for (int c = 0; c < 3; c++) {
+                unsigned char v = (unsigned char)min(255.0, s[c] / s[3] + 0.5);
+                if (v != pal.colors[k][c]) moved = true;
+                pal.colors[k][c] = v;
+            }
+        }
+        if (!moved) break;
+    }
+}
+
+// Paleta de até colors (2..256) cores para a imagem.
+inline Palette buildPalette(const unsigned char *rgb, size_t pixels, int colors, PaletteMethod method,
+                            ThreadPool &pool = ThreadPool::shared()) {
+    colors = max(2, min(colors, 256));
+    ColorHistogram hist;
+    colorHistogram(rgb, pixels, hist, pool);
+    Palette pal;
+    medianCut(hist, colors, pal);
+    if (method == PALETTE_KMEANS) kmeansRefine(hist, pal, 16, pool);
+    return pal;
+}
+
+// Índice da cor mais próxima do centro de cada célula de 15 bits.
+struct InverseColorMap {
+    vector<unsigned char> index;
+
+    void build(const Palette &pal, ThreadPool &pool = ThreadPool::shared()) {
+        index.resize(COLOR_CELLS);
+        pool.run(32, [&](size_t r) {
+            for (int g = 0; g < 32; g++) {
+                for (int b = 0; b < 32; b++) {
+                    index[(r << 10) | (g << 5) | b] =
+                        (unsigned char)nearestColor(pal, (double)(r * 8 + 4), g * 8 + 4, b * 8 + 4);
+                }
+            }
+        });
+    }
+
+    int lookup(int r, int g, int b) const { return index[colorCell(r, g, b)]; }
+};
+
+// Linhas de acumuladores de erro no anel: a linha y só é reaproveitada
+// (para y + DITHER_SLOTS) depois de lida, porque a linha y + 3 só chega à
+// coluna x quando a linha y já passou dela.
+static const int DITHER_SLOTS = 4;
+// Colunas processadas entre duas publicações do progresso de uma linha.
+static const int DITHER_CHUNK = 64;
+
+// Linha y, colunas [x0, x1): cur guarda o erro que chegou a esta linha
+// (lido e zerado aqui), next e next2 o das duas seguintes. carry é o erro
+// que anda para a direita na própria linha (Atkinson usa dois).
+inline void ditherSpan(unsigned char *row, int x0, int x1, const Palette &pal, const InverseColorMap &map,
+                       DitherMethod method, int *cur, int *next, int *next2, int carry[2][3]) {
+    for (int x = x0; x < x1; x++) {
+        unsigned char *p = row + (size_t)x * 3;
+        int *e = cur + (x + 2) * 3;
+        int v[3];
+        for (int c = 0; c < 3; c++) {
+            int t = p[c] + ((e[c] + carry[0][c] + 8) >> 4);
+            v[c] = t < 0 ? 0 : (t > 255 ? 255 : t);
+            e[c] = 0;
+        }
+        const unsigned char *q = pal.colors[map.lookup(v[0], v[1], v[2])];
+        for (int c = 0; c < 3; c++) {
+            int err = v[c] - q[c];
+            p[c] = q[c];
+            int *n = next + (x + 2) * 3 + c;
+            if (method == DITHER_FLOYD_STEINBERG) {
+                carry[0][c] = err * 7;
+                n[-3] += err * 3;
+                n[0] += err * 5;
+                n[3] += err;
+            } else {
+                // 1/8 para seis vizinhos: 2/16 cada
+                carry[0][c] = carry[1][c] + err * 2;
+                carry[1][c] = err * 2;
+                n[-3] += err * 2;
+                n[0] += err * 2;
+                n[3] += err * 2;
+                next2[(x + 2) * 3 + c] += err * 2;
+            }
+        }
+    }
+}
+
+// Reduz rgb (w x h) às cores de pal, no lugar.
+inline void ditherImage(unsigned char *rgb, int w, int h, const Palette &pal, DitherMethod method,
+                        ThreadPool &pool = ThreadPool::shared()) {
+    if (w <= 0 || h <= 0 || pal.size == 0) return;
+    InverseColorMap map;
+    map.build(pal, pool);
+    size_t rowBytes = (size_t)w * 3;
+    if (method == DITHER_NONE) {
+        parallelPixels(rgb, w, h, [&](unsigned char *band, size_t pixels, size_t) {
+            for (size_t i = 0; i < pixels * 3; i += 3) {
+                const unsigned char *q = pal.colors[map.lookup(band[i], band[i + 1], band[i + 2])];
+                memcpy(band + i, q, 3);
+            }
+        }, pool);
+        return;
+    }
+    // acumuladores com duas colunas de folga em cada lado (erro que sai da imagem)
+    size_t slotLen = (size_t)(w + 4) * 3;
+    vector<int> slots(slotLen * DITHER_SLOTS, 0);
+    vector<atomic<int>> progress(h);
+    for (atomic<int> &p : progress) p.store(0, memory_order_relaxed);
+    atomic<int> nextRow{0};
+    pool.run(pool.size(), [&](size_t) {
+        for (int y = nextRow.fetch_add(1); y < h; y = nextRow.fetch_add(1)) {
+            int *cur = slots.data() + slotLen * (y % DITHER_SLOTS);
+            int *next = slots.data() + slotLen * ((y + 1) % DITHER_SLOTS);
+            int *next2 = slots.data() + slotLen * ((y + 2) % DITHER_SLOTS);
+            int carry[2][3] = {{0, 0, 0}, {0, 0, 0}};
+            for (int x0 = 0; x0 < w; x0 += DITHER_CHUNK) {
+                int x1 = min(x0 + DITHER_CHUNK, w);
+                if (y > 0) {
+                    // a linha de cima precisa ter passado da coluna x1
+                    int need = min(x1 + 1, w);
+                    while (progress[y - 1].load(memory_order_acquire) < need) this_thread::yield();
+                }
+                ditherSpan(rgb + y * rowBytes, x0, x1, pal, map, method, cur, next, next2, carry);
+                // folgas: o erro que saiu pelas bordas é descartado; cada lado
+                // é zerado antes de publicar o trecho, quando quem escreveu
+                // nele (a linha de cima) já passou e quem vai reusá-lo
+                // (a linha y + 3) ainda não chegou
+                if (x0 == 0) memset(cur, 0, sizeof(int) * 6);
+                if (x1 == w) memset(cur + slotLen - 6, 0, sizeof(int) * 6);
+                progress[y].store(x1, memory_order_release);
+            }
+        }
+    });
+}
+
+#endif /* Dither_h */
@@ -0,0 +1,614 @@
+//
+//  FilterChain.h
+//  Cadeia de filtros pontuais aplicada numa única passada pela memória.
+//
+//  Uma especificação como "grayscale | colorize(32,0,64) | negative" vira
+//  uma lista de estágios. Estágios seguidos que só mapeiam cada canal
+//  byte -> byte (colorize, negative) são compostos numa tabela de 256
+//  entradas por canal. A imagem é percorrida uma vez, em blocos que cabem no
+//  L1, e todos os estágios rodam sobre o bloco enquanto ele está no cache:
+//  o tráfego de memória não cresce com o tamanho da cadeia.
+//
+//  Cada estágio declara o layout que prefere (PlanarImage.h). Quando a cadeia
+//  tem estágios vetoriais, cada bloco é separado em planos uma vez, todos os
+//  estágios rodam na largura inteira do registrador e o bloco é juntado de
+//  volta no fim.
+//
+//  autolevels e equalize dependem do histograma da imagem no ponto em que
+//  aparecem: a cadeia é cortada ali, a primeira parte roda junto com a
+//  contagem (Histogram.h) e a tabela obtida vira um mapa por canal composto
+//  com o resto da cadeia.
+//
+//  blur e boxblur olham a vizinhança de cada pixel: a cadeia também é
+//  cortada ali, e o desfoque (Blur.h; boxblur com raio grande por
+//  SummedArea.h) roda sobre a imagem inteira entre a parte anterior e a
+//  seguinte.
+//
+//  lut3d(arquivo.cube) aplica uma LUT 3D (CubeLut.h) e roda sobre planos,
+//  fundida com os outros estágios pontuais.
+//
+//  huesat(graus, saturação) gira a matiz e escala a saturação em HSL;
+//  tint(graus, saturação) tinge mantendo a luminosidade, em ponto fixo
+//  (ColorSpace.h). Os dois rodam sobre planos.
+//
+
+#ifndef FilterChain_h
+#define FilterChain_h
+
+#include <ctype.h>
+#include <math.h>
+#include <memory>
+#include <stdlib.h>
+#include <string.h>
+#include <string>
+#include <vector>
+
+#include "GrayScale.h"
+#include "ChromaKey.h"
+#include "ThreadPool.h"
+#include "PlanarImage.h"
+#include "Histogram.h"
+#include "Blur.h"
+#include "CubeLut.h"
+#include "ColorSpace.h"
+
+using namespace std;
+
+struct FilterStage {
+    enum Kind { CHANNEL_MAP, GRAY, CHROMA, AUTO_LEVELS, EQUALIZE, BLUR, CUBE, HUE_SAT, TINT };
+    Kind kind = CHANNEL_MAP;
+    unsigned char lut[3][256] = {}; // CHANNEL_MAP: saída de cada canal para cada entrada
+    LumaWeights luma{};        // GRAY
+    ChromaKeyColor key{};      // CHROMA
+    double clip = 0;           // AUTO_LEVELS: fração descartada em cada ponta
+    BlurWeights blur;          // BLUR: pesos da convolução separável
+    shared_ptr<const CubeLut> cube; // CUBE: a tabela, compartilhada entre cópias da cadeia
+    HueSat hs{};               // HUE_SAT
+    Tint tintK{};              // TINT
+    // CHANNEL_MAP que é (v & andMask) ^ xorMask por canal: vetorizável em planos
+    bool bitwise = false;
+    unsigned char andMask[3] = {}, xorMask[3] = {};
+
+    PixelLayout preferredLayout() const {
+        if (kind == CHANNEL_MAP && !bitwise) return LAYOUT_ANY; // tabela: escalar nos dois
+        if (kind == AUTO_LEVELS || kind == EQUALIZE || kind == BLUR) return LAYOUT_ANY;
+        return LAYOUT_PLANAR; // evita separar e juntar canais dentro do kernel
+    }
+};
+
+class FilterChain {
+public:
+    // Pixels por bloco: 4096 * 3 bytes = 12 KiB, folgado dentro do L1.
+    static const size_t BLOCK_PIXELS = 4096;
+
+    // Lê a especificação; em caso de erro devolve false e descreve em error.
+    bool parse(const string &spec, string &error) {
+        stages.clear();
+        size_t start = 0;
+        while (start <= spec.size()) {
+            size_t bar = spec.find('|', start);
+            if (bar == string::npos) bar = spec.size();
+            if (!addStage(spec.substr(start, bar - start), error)) {
+                stages.clear();
+                return false;
+            }
+            start = bar + 1;
+        }
+        return true;
+    }
+
+    void addChannelMap(const unsigned char lut[3][256]) {
+        if (!stages.empty() && stages.back().kind == FilterStage::CHANNEL_MAP) {
+            // composição: primeiro o mapa anterior, depois o novo
+            FilterStage &last = stages.back();
+            for (int c = 0; c < 3; c++) {
+                for (int v = 0; v < 256; v++) last.lut[c][v] = lut[c][last.lut[c][v]];
+            }
+            if (isIdentity(last)) stages.pop_back();
+            else classifyBitwise(last);
+            return;
+        }
+        FilterStage s;
+        s.kind = FilterStage::CHANNEL_MAP;
+        memcpy(s.lut, lut, sizeof(s.lut));
+        classifyBitwise(s);
+        if (!isIdentity(s)) stages.push_back(s);
+    }
+
+    void addGrayScale(LumaWeights w) {
+        FilterStage s;
+        s.kind = FilterStage::GRAY;
+        s.luma = w;
+        stages.push_back(s);
+    }
+
+    void addChromaKey(ChromaKeyColor k) {
+        FilterStage s;
+        s.kind = FilterStage::CHROMA;
+        s.key = k;
+        stages.push_back(s);
+    }
+
+    void addHistogramStage(FilterStage::Kind kind, double clip = 0) {
+        FilterStage s;
+        s.kind = kind;
+        s.clip = clip;
+        stages.push_back(s);
+    }
+
+    void addBlur(const BlurWeights &weights) {
+        FilterStage s;
+        s.kind = FilterStage::BLUR;
+        s.blur = weights;
+        if (weights.radius > 0) stages.push_back(s);
+    }
+
+    void addCubeLut(shared_ptr<const CubeLut> lut) {
+        FilterStage s;
+        s.kind = FilterStage::CUBE;
+        s.cube = lut;
+        stages.push_back(s);
+    }
+
+    void addHueSat(const HueSat &hs) {
+        FilterStage s;
+        s.kind = FilterStage::HUE_SAT;
+        s.hs = hs;
+        stages.push_back(s);
+    }
+
+    void addTint(const Tint &t) {
+        FilterStage s;
+        s.kind = FilterStage::TINT;
+        s.tintK = t;
+        stages.push_back(s);
+    }
+
+    size_t size() const { return stages.size(); }
+    const vector<FilterStage> &stageList() const { return stages; }
+
+    // Há auto-levels/equalização ou desfoque: a imagem inteira precisa estar
+    // disponível (não serve para o processamento em faixas nem para a GPU).
+    bool needsWholeImage() const { return barrierStage() < stages.size(); }
+
+    // Layout em que applyPixels processa os blocos: planar se algum estágio
+    // prefere planos. Separar e juntar um bloco no L1 custa menos que um
+    // único estágio escalar, então um estágio vetorial já paga a conversão.
+    PixelLayout preferredLayout() const { return layoutFor(0, stages.size()); }
+
+    // Fixa o layout dos blocos (LAYOUT_ANY volta à escolha automática).
+    void setLayout(PixelLayout layout) { forcedLayout = layout; }
+
+    // Aplica a cadeia a um trecho contíguo de pixels, nesta thread. mask
+    // (opcional) recebe 255 nos pixels chaveados por qualquer chroma-key.
+    // Sem as dimensões da imagem não há desfoque: estágios blur são ignorados
+    // aqui (use apply).
+    void applyPixels(unsigned char *data, size_t pixels, unsigned char *mask = nullptr) const {
+        size_t k = barrierStage();
+        if (k < stages.size() && stages[k].kind == FilterStage::BLUR) {
+            runStages(0, k, data, pixels, mask, nullptr);
+            after(k, nullptr).applyPixels(data, pixels, mask);
+            return;
+        }
+        if (k == stages.size()) {
+            runStages(0, k, data, pixels, mask, nullptr);
+            return;
+        }
+        Histogram hist;
+        {
+            HistogramAccumulator acc(hist);
+            runStages(0, k, data, pixels, mask, &acc);
+        }
+        unsigned char lut[3][256];
+        histogramLut(stages[k], hist, lut);
+        after(k, lut).applyPixels(data, pixels, mask);
+    }
+
+    // Imagem inteira, em faixas de linhas no pool de threads. Um estágio de
+    // histograma custa uma passada a mais: os estágios anteriores e a
+    // contagem rodam juntos, e a tabela resultante é composta com os
+    // estágios seguintes na passada final. Um desfoque custa as suas duas
+    // passadas; os estágios pontuais antes e depois dele continuam fundidos.
+    void apply(unsigned char *data, int w, int h, unsigned char *mask = nullptr) const {
+        size_t k = barrierStage();
+        if (k == stages.size() || stages[k].kind == FilterStage::BLUR) {
+            if (k > 0) {
+                parallelPixels(data, w, h, [&](unsigned char *band, size_t pixels, size_t first) {
+                    runStages(0, k, band, pixels, mask ? mask + first : nullptr, nullptr);
+                });
+            } else if (mask && !keepMask) {
+                memset(mask, 0, (size_t)w * h);
+            }
+            if (k == stages.size()) return;
+            blurImage(data, w, h, 3, stages[k].blur);
+            after(k, nullptr).apply(data, w, h, mask);
+            return;
+        }
+        Histogram hist = privatePass((size_t)w * h, [&](size_t a, size_t b, HistogramAccumulator &acc) {
+            runStages(0, k, data + a * 3, b - a, mask ? mask + a : nullptr, &acc);
+        });
+        unsigned char lut[3][256];
+        histogramLut(stages[k], hist, lut);
+        after(k, lut).apply(data, w, h, mask);
+    }
+
+    // Imagem já em planos (RGB ou RGBA; o alfa não é tocado).
+    void applyPlanar(PlanarImage &img, unsigned char *mask = nullptr) const {
+        int w = img.getWidth(), h = img.getHeight();
+        unsigned char *r = img.plane(0), *g = img.plane(1), *b = img.plane(2);
+        size_t k = barrierStage();
+        if (k == stages.size() || stages[k].kind == FilterStage::BLUR) {
+            if (k > 0) {
+                parallelRows(w, h, 3, [&](int y0, int y1) {
+                    size_t first = (size_t)y0 * w;
+                    runPlanarStages(0, k, r + first, g + first, b + first, (size_t)(y1 - y0) * w,
+                                    mask ? mask + first : nullptr, nullptr);
+                });
+            } else if (mask && !keepMask) {
+                memset(mask, 0, img.pixels());
+            }
+            if (k == stages.size()) return;
+            for (int c = 0; c < 3; c++) blurImage(img.plane(c), w, h, 1, stages[k].blur);
+            after(k, nullptr).applyPlanar(img, mask);
+            return;
+        }
+        Histogram hist = privatePass(img.pixels(), [&](size_t i0, size_t i1, HistogramAccumulator &acc) {
+            runPlanarStages(0, k, r + i0, g + i0, b + i0, i1 - i0, mask ? mask + i0 : nullptr, &acc);
+        });
+        unsigned char lut[3][256];
+        histogramLut(stages[k], hist, lut);
+        after(k, lut).applyPlanar(img, mask);
+    }
+
+private:
+    // Primeiro estágio que precisa da imagem inteira (histograma ou
+    // desfoque); stages.size() se não houver.
+    size_t barrierStage() const {
+        for (size_t i = 0; i < stages.size(); i++) {
+            FilterStage::Kind kind = stages[i].kind;
+            if (kind == FilterStage::AUTO_LEVELS || kind == FilterStage::EQUALIZE || kind == FilterStage::BLUR) {
+                return i;
+            }
+        }
+        return stages.size();
+    }
+
+    PixelLayout layoutFor(size_t first, size_t last) const {
+        if (forcedLayout != LAYOUT_ANY) return forcedLayout;
+        for (size_t i = first; i < last; i++) {
+            if (stages[i].preferredLayout() == LAYOUT_PLANAR) return LAYOUT_PLANAR;
+        }
+        return LAYOUT_INTERLEAVED;
+    }
+
+    // Uma tarefa por thread sobre trechos contíguos [a, b) de pixels, cada
+    // uma contando num histograma próprio; os histogramas são somados no fim.
+    template <typename F>
+    static Histogram privatePass(size_t pixels, F f) {
+        ThreadPool &pool = ThreadPool::shared();
+        size_t tasks = pool.size();
+        vector<Histogram> parts(tasks);
+        pool.run(tasks, [&](size_t t) {
+            HistogramAccumulator acc(parts[t]);
+            f(pixels * t / tasks, pixels * (t + 1) / tasks, acc);
+        });
+        Histogram h;
+        for (const Histogram &p : parts) h.add(p);
+        return h;
+    }
+
+    static void histogramLut(const FilterStage &s, const Histogram &hist, unsigned char lut[3][256]) {
+        if (s.kind == FilterStage::AUTO_LEVELS) {
+            autoLevelsLut(hist, s.clip, lut);
+        } else {
+            equalizeLut(hist, lut);
+        }
+    }
+
+    // O que falta depois do estágio k: lut (a tabela de um estágio de
+    // histograma, ou nullptr) composta com os mapas seguintes, e o resto da
+    // cadeia. A máscara já escrita é preservada.
+    FilterChain after(size_t k, const unsigned char (*lut)[256]) const {
+        FilterChain rest;
+        rest.forcedLayout = forcedLayout;
+        rest.keepMask = true;
+        if (lut) rest.addChannelMap(lut);
+        for (size_t i = k + 1; i < stages.size(); i++) {
+            if (stages[i].kind == FilterStage::CHANNEL_MAP) {
+                rest.addChannelMap(stages[i].lut);
+            } else {
+                rest.stages.push_back(stages[i]);
+            }
+        }
+        return rest;
+    }
+
+    // Estágios [first, last) sobre pixels RGB intercalados, em blocos que
+    // cabem no L1; acc (opcional) conta o resultado de cada bloco.
+    void runStages(size_t first, size_t last, unsigned char *data, size_t pixels, unsigned char *mask,
+                   HistogramAccumulator *acc) const {
+        unsigned char keyed[BLOCK_PIXELS];
+        bool planar = first < last && layoutFor(first, last) == LAYOUT_PLANAR;
+        for (size_t b = 0; b < pixels; b += BLOCK_PIXELS) {
+            size_t n = pixels - b < BLOCK_PIXELS ? pixels - b : BLOCK_PIXELS;
+            unsigned char *p = data + b * 3;
+            unsigned char *m = mask ? mask + b : nullptr;
+            if (planar) {
+                alignas(64) unsigned char planes[3][BLOCK_PIXELS];
+                deinterleaveRgb(p, n, planes[0], planes[1], planes[2]);
+                runPlanarBlock(first, last, planes[0], planes[1], planes[2], n, m, keyed);
+                if (acc) acc->addPlanes(planes[0], planes[1], planes[2], n);
+                interleaveRgb(planes[0], planes[1], planes[2], n, p);
+                continue;
+            }
+            if (m && !keepMask) memset(m, 0, n);
+            for (size_t i = first; i < last; i++) {
+                const FilterStage &s = stages[i];
+                switch (s.kind) {
+                    case FilterStage::CHANNEL_MAP:
+                        applyLut(s, p, n);
+                        break;
+                    case FilterStage::GRAY:
+                        grayScaleFixed(p, n, s.luma);
+                        break;
+                    case FilterStage::CHROMA:
+                        chromaKeyFixed(p, n, s.key, m ? keyed : nullptr);
+                        if (m) {
+                            for (size_t j = 0; j < n; j++) m[j] |= keyed[j];
+                        }
+                        break;
+                    case FilterStage::CUBE:
+                        cubeLutRgb(p, n, *s.cube);
+                        break;
+                    case FilterStage::HUE_SAT:
+                        hueSatRgb(p, n, s.hs);
+                        break;
+                    case FilterStage::TINT:
+                        tintRgb(p, n, s.tintK);
+                        break;
+                    case FilterStage::AUTO_LEVELS:
+                    case FilterStage::EQUALIZE:
+                    case FilterStage::BLUR:
+                        break; // resolvidos por apply() e after()
+                }
+            }
+            if (acc) acc->add(p, n);
+        }
+    }
+
+    void runPlanarStages(size_t first, size_t last, unsigned char *r, unsigned char *g, unsigned char *b,
+                         size_t pixels, unsigned char *mask, HistogramAccumulator *acc) const {
+        unsigned char keyed[BLOCK_PIXELS];
+        for (size_t i = 0; i < pixels; i += BLOCK_PIXELS) {
+            size_t n = pixels - i < BLOCK_PIXELS ? pixels - i : BLOCK_PIXELS;
+            runPlanarBlock(first, last, r + i, g + i, b + i, n, mask ? mask + i : nullptr, keyed);
+            if (acc) acc->addPlanes(r + i, g + i, b + i, n);
+        }
+    }
+
+    // Estágios [first, last) sobre n <= BLOCK_PIXELS pixels em planos.
+    void runPlanarBlock(size_t first, size_t last, unsigned char *r, unsigned char *g, unsigned char *b,
+                        size_t n, unsigned char *m, unsigned char *keyed) const {
+        unsigned char *planes[3] = {r, g, b};
+        if (m && !keepMask) memset(m, 0, n);
+        for (size_t i = first; i < last; i++) {
+            const FilterStage &s = stages[i];
+            switch (s.kind) {
+                case FilterStage::CHANNEL_MAP:
+                    for (int c = 0; c < 3; c++) {
+                        if (s.bitwise) {
+                            bitwisePlane(planes[c], n, s.andMask[c], s.xorMask[c]);
+                        } else {
+                            const unsigned char *lut = s.lut[c];
+                            unsigned char *p = planes[c];
+                            for (size_t j = 0; j < n; j++) p[j] = lut[p[j]];
+                        }
+                    }
+                    break;
+                case FilterStage::GRAY:
+                    grayScalePlanar(r, g, b, n, s.luma);
+                    break;
+                case FilterStage::CHROMA:
+                    chromaKeyPlanar(r, g, b, n, s.key, m ? keyed : nullptr);
+                    if (m) {
+                        for (size_t j = 0; j < n; j++) m[j] |= keyed[j];
+                    }
+                    break;
+                case FilterStage::CUBE:
+                    cubeLutPlanes(r, g, b, n, *s.cube);
+                    break;
+                case FilterStage::HUE_SAT:
+                    hueSatPlanes(r, g, b, n, s.hs);
+                    break;
+                case FilterStage::TINT:
+                    tintPlanes(r, g, b, n, s.tintK);
+                    break;
+                case FilterStage::AUTO_LEVELS:
+                case FilterStage::EQUALIZE:
+                case FilterStage::BLUR:
+                    break;
+            }
+        }
+    }
+
+    // lut[v] == (v & a) ^ x para todo v? a e x saem de lut[0] e lut[255].
+    static void classifyBitwise(FilterStage &s) {
+        s.bitwise = true;
+        for (int c = 0; c < 3; c++) {
+            unsigned char x = s.lut[c][0];
+            unsigned char a = (unsigned char)(s.lut[c][255] ^ x);
+            s.andMask[c] = a;
+            s.xorMask[c] = x;
+            for (int v = 0; v < 256 && s.bitwise; v++) {
+                if (s.lut[c][v] != ((v & a) ^ x)) s.bitwise = false;
+            }
+        }
+    }
+
+    static bool isIdentity(const FilterStage &s) {
+        for (int c = 0; c < 3; c++) {
+            for (int v = 0; v < 256; v++) {
+                if (s.lut[c][v] != v) return false;
+            }
+        }
+        return true;
+    }
+
+    static void applyLut(const FilterStage &s, unsigned char *p, size_t pixels) {
+        const unsigned char *lr = s.lut[0], *lg = s.lut[1], *lb = s.lut[2];
+        for (size_t i = 0; i < pixels * 3; i += 3) {
+            p[i]   = lr[p[i]];
+            p[i+1] = lg[p[i+1]];
+            p[i+2] = lb[p[i+2]];
+        }
+    }
+
+    static string lower(string s) {
+        for (char &c : s) c = (char)tolower((unsigned char)c);
+        return s;
+    }
+
+    static string trim(const string &s) {
+        size_t a = s.find_first_not_of(" \t\r\n");
+        if (a == string::npos) return "";
+        size_t b = s.find_last_not_of(" \t\r\n");
+        return s.substr(a, b - a + 1);
+    }
+
+    // "nome(a, b, c)" -> nome e lista de argumentos (texto).
+    static bool splitCall(const string &text, string &name, vector<string> &args) {
+        args.clear();
+        size_t open = text.find('(');
+        if (open == string::npos) {
+            name = lower(trim(text));
+            return !name.empty();
+        }
+        size_t close = text.rfind(')');
+        if (close == string::npos || close < open || !trim(text.substr(close + 1)).empty()) return false;
+        name = lower(trim(text.substr(0, open)));
+        string inner = text.substr(open + 1, close - open - 1);
+        size_t start = 0;
+        while (!trim(inner).empty() && start <= inner.size()) {
+            size_t comma = inner.find(',', start);
+            if (comma == string::npos) comma = inner.size();
+            args.push_back(trim(inner.substr(start, comma - start)));
+            start = comma + 1;
+        }
+        return !name.empty();
+    }
+
+    static bool toNumber(const string &s, double &v) {
+        if (s.empty()) return false;
+        char *end;
+        v = strtod(s.c_str(), &end);
+        // strtod aceita "nan" e "inf", que passariam por todas as faixas
+        return *end == '\0' && isfinite(v);
+    }
+
+    static bool toByte(const string &s, int &v) {
+        double d;
+        if (!toNumber(s, d) || d < 0 || d > 255 || d != (int)d) return false;
+        v = (int)d;
+        return true;
+    }
+
+    bool addStage(const string &text, string &error) {
+        string name;
+        vector<string> args;
+        if (!splitCall(text, name, args)) {
+            error = "estágio inválido: '" + trim(text) + "'";
+            return false;
+        }
+        if (name == "negative") {
+            if (!args.empty()) return fail(error, name, "não recebe parâmetros");
+            unsigned char lut[3][256];
+            for (int c = 0; c < 3; c++) {
+                for (int v = 0; v < 256; v++) lut[c][v] = (unsigned char)(v ^ 255);
+            }
+            addChannelMap(lut);
+        } else if (name == "colorize") {
+            int rgb[3];
+            if (args.size() != 3 || !toByte(args[0], rgb[0]) || !toByte(args[1], rgb[1]) || !toByte(args[2], rgb[2])) {
+                return fail(error, name, "espera colorize(r,g,b) com valores 0..255");
+            }
+            unsigned char lut[3][256];
+            for (int c = 0; c < 3; c++) {
+                for (int v = 0; v < 256; v++) lut[c][v] = (unsigned char)(v | rgb[c]);
+            }
+            addChannelMap(lut);
+        } else if (name == "grayscale" || name == "gray") {
+            if (args.empty() || (args.size() == 1 && lower(args[0]) == "p")) {
+                addGrayScale(lumaWeights(0.2125, 0.7154, 0.0721));
+            } else if (args.size() == 1 && lower(args[0]) == "s") {
+                addGrayScale(lumaWeights(1.0, 1.0, 1.0));
+            } else {
+                return fail(error, name, "espera grayscale, grayscale(s) ou grayscale(p)");
+            }
+        } else if (name == "chromakey" || name == "chroma") {
+            int rgb[3];
+            double t;
+            if (args.size() != 4 || !toByte(args[0], rgb[0]) || !toByte(args[1], rgb[1]) || !toByte(args[2], rgb[2])
+                || !toNumber(args[3], t)) {
+                return fail(error, name, "espera chromakey(r,g,b,tolerância)");
+            }
+            addChromaKey(chromaKeyColor(rgb[0], rgb[1], rgb[2], t));
+        } else if (name == "autolevels") {
+            double clip = 0.005;
+            if (args.size() > 1 || (args.size() == 1 && (!toNumber(args[0], clip) || clip < 0 || clip >= 0.5))) {
+                return fail(error, name, "espera autolevels ou autolevels(fração descartada, 0..0.5)");
+            }
+            addHistogramStage(FilterStage::AUTO_LEVELS, clip);
+        } else if (name == "equalize") {
+            if (!args.empty()) return fail(error, name, "não recebe parâmetros");
+            addHistogramStage(FilterStage::EQUALIZE);
+        } else if (name == "blur") {
+            double sigma;
+            if (args.size() != 1 || !toNumber(args[0], sigma) || sigma <= 0 || sigma > 300) {
+                return fail(error, name, "espera blur(sigma), com sigma em (0, 300]");
+            }
+            addBlur(gaussianWeights(sigma));
+        } else if (name == "boxblur") {
+            double r;
+            if (args.size() != 1 || !toNumber(args[0], r) || r < 0 || r > 1000 || r != (int)r) {
+                return fail(error, name, "espera boxblur(raio), com raio inteiro 0..1000");
+            }
+            addBlur(boxWeights((int)r));
+        } else if (name == "huesat" || name == "tint") {
+            double hue, sat;
+            if (args.size() != 2 || !toNumber(args[0], hue) || !toNumber(args[1], sat) || sat < 0
+                || (name == "tint" && sat > 1)) {
+                return fail(error, name, name == "tint" ? "espera tint(matiz em graus, saturação 0..1)"
+                                                        : "espera huesat(graus, fator de saturação)");
+            }
+            if (name == "tint") addTint(tint(hue, sat));
+            else addHueSat(hueSat(hue, sat));
+        } else if (name == "lut3d") {
+            // o caminho pode ter vírgulas: junta de volta o que splitCall separou
+            string path;
+            for (size_t i = 0; i < args.size(); i++) path += (i ? "," : "") + args[i];
+            if (path.size() >= 2 && (path[0] == '"' || path[0] == '\'') && path.back() == path[0]) {
+                path = path.substr(1, path.size() - 2);
+            }
+            if (path.empty()) return fail(error, name, "espera lut3d(arquivo.cube)");
+            shared_ptr<CubeLut> lut = make_shared<CubeLut>();
+            string why;
+            if (!lut->load(path, why)) return fail(error, name, why);
+            addCubeLut(lut);
+        } else {
+            error = "filtro desconhecido: '" + name + "'";
+            return false;
+        }
+        return true;
+    }
+
+    static bool fail(string &error, const string &name, const string &what) {
+        error = name + ": " + what;
+        return false;
+    }
+
+    vector<FilterStage> stages;
+    PixelLayout forcedLayout = LAYOUT_ANY;
+    bool keepMask = false; // a máscara já tem o resultado de uma passada anterior
+};
+
+#endif /* FilterChain_h */
@@ -0,0 +1,418 @@
+//
+//  GpuFilters.h
+//  Backend de GPU para a FilterChain: a imagem vai para uma textura, a
+//  cadeia inteira vira um único fragment shader que desenha num framebuffer
+//  fora da tela, e o resultado volta por pixel buffer objects (PBO).
+//
+//  Texturas e framebuffer são inteiros (RGB8UI / RGBA8UI) e o shader repete
+//  as contas inteiras da CPU (Q15 no cinza, distância ao quadrado na chave),
+//  então a saída é idêntica byte a byte à de FilterChain::apply. O canal
+//  alfa da saída traz a máscara do chroma-key.
+//
+//  A imagem é processada em blocos (tiles): enquanto a GPU desenha um bloco,
+//  o anterior é copiado do PBO de volta para a memória (dois PBOs alternados
+//  com fences), então leitura e desenho se sobrepõem.
+//
+//  O contexto é de uma janela GLFW invisível. Sem servidor gráfico (nós de
+//  build sem GPU) ou com PG_GPU_HEADLESS definido, usa a plataforma nula do
+//  GLFW com contexto OSMesa (GL em software do Mesa). O contexto fica preso
+//  à thread que o criou: use GpuFilter sempre da mesma thread.
+//
+
+#ifndef GpuFilters_h
+#define GpuFilters_h
+
+#include <glad/glad.h>
+#include <GLFW/glfw3.h>
+
+#include <iostream>
+#include <string>
+#include <vector>
+#include <stdlib.h>
+#include <string.h>
+
+#include "FilterChain.h"
+
+using namespace std;
+
+// Contexto GL compartilhado pelo processo, criado na primeira chamada.
+class GpuContext {
+public:
+    static bool ensure(string &error) {
+        GpuContext &c = instance();
+        if (c.window) return true;
+        if (c.failed) {
+            error = c.reason;
+            return false;
+        }
+        bool headless = getenv("PG_GPU_HEADLESS") != nullptr;
+        bool ok = !headless && c.create(false);
+#ifdef GLFW_PLATFORM_NULL
+        if (!ok) ok = c.create(true);
+#endif
+        if (ok && !gladLoadGLLoader((GLADloadproc)glfwGetProcAddress)) {
+            c.destroy();
+            ok = false;
+        }
+        if (!ok) {
+            c.failed = true;
+            c.reason = "não foi possível criar um contexto OpenGL 3.3";
+            error = c.reason;
+            return false;
+        }
+        return true;
+    }
+
+    // Descrição do driver, ex.: "llvmpipe (LLVM 15.0.7, 256 bits)".
+    static string renderer() {
+        const GLubyte *r = instance().window ? glGetString(GL_RENDERER) : nullptr;
+        return r ? (const char *)r : "sem contexto";
+    }
+
+private:
+    static GpuContext &instance() {
+        static GpuContext c;
+        return c;
+    }
+
+    ~GpuContext() { destroy(); }
+
+    bool create(bool nullPlatform) {
+#ifdef GLFW_PLATFORM_NULL
+        glfwInitHint(GLFW_PLATFORM, nullPlatform ? GLFW_PLATFORM_NULL : GLFW_ANY_PLATFORM);
+#endif
+        if (!glfwInit()) return false;
+        glfwDefaultWindowHints();
+        glfwWindowHint(GLFW_CONTEXT_VERSION_MAJOR, 3);
+        glfwWindowHint(GLFW_CONTEXT_VERSION_MINOR, 3);
+        glfwWindowHint(GLFW_OPENGL_PROFILE, GLFW_OPENGL_CORE_PROFILE);
+        glfwWindowHint(GLFW_OPENGL_FORWARD_COMPAT, GL_TRUE);
+        glfwWindowHint(GLFW_VISIBLE, GLFW_FALSE);
+#ifdef GLFW_PLATFORM_NULL
+        if (nullPlatform) glfwWindowHint(GLFW_CONTEXT_CREATION_API, GLFW_OSMESA_CONTEXT_API);
+#endif
+        window = glfwCreateWindow(16, 16, "exemplo_03 gpu", NULL, NULL);
+        if (!window) {
+            glfwTerminate();
+            return false;
+        }
+        glfwMakeContextCurrent(window);
+        return true;
+    }
+
+    void destroy() {
+        if (!window) return;
+        glfwDestroyWindow(window);
+        glfwTerminate();
+        window = nullptr;
+    }
+
+    GLFWwindow *window = nullptr;
+    bool failed = false;
+    string reason;
+};
+
+class GpuFilter {
+public:
+    // Lado máximo de um bloco; blocos menores deixam a leitura se sobrepor
+    // ao desenho mais cedo. 2048^2 RGBA = 16 MiB por PBO.
+    static const int MAX_TILE = 2048;
+
+    GpuFilter() {}
+    ~GpuFilter() { release(); }
+
+    GpuFilter(const GpuFilter &) = delete;
+    GpuFilter &operator=(const GpuFilter &) = delete;
+
+    // Cria o contexto (se preciso) e compila o shader da cadeia.
+    bool init(const FilterChain &chain, string &error) {
+        release();
+        if (chain.needsWholeImage()) {
+            error = "autolevels, equalize e blur precisam da imagem inteira";
+            return false;
+        }
+        for (const FilterStage &st : chain.stageList()) {
+            if (st.kind == FilterStage::CUBE) {
+                error = "lut3d ainda não roda na GPU";
+                return false;
+            }
+            // float: o shader não garantiria o mesmo arredondamento da CPU
+            if (st.kind == FilterStage::HUE_SAT) {
+                error = "huesat ainda não roda na GPU";
+                return false;
+            }
+        }
+        if (!GpuContext::ensure(error)) return false;
+
+        GLint maxTex = 0;
+        glGetIntegerv(GL_MAX_TEXTURE_SIZE, &maxTex);
+        tile = maxTex < MAX_TILE ? maxTex : MAX_TILE;
+
+        vector<unsigned char> lutTexels;
+        string fs = fragmentSource(chain, lutTexels);
+        program = linkProgram(VERTEX_SOURCE, fs.c_str(), error);
+        if (!program) return false;
+        glUseProgram(program);
+        glUniform1i(glGetUniformLocation(program, "image"), 0);
+        glUniform1i(glGetUniformLocation(program, "luts"), 1);
+
+        glGenVertexArrays(1, &vao);
+        glGenTextures(1, &imageTex);
+        setupTexture(imageTex, GL_RGB8UI, tile, tile, GL_RGB_INTEGER, nullptr);
+        glGenTextures(1, &lutTex);
+        int lutRows = (int)(lutTexels.size() / (256 * 4));
+        setupTexture(lutTex, GL_RGBA8UI, 256, lutRows ? lutRows : 1, GL_RGBA_INTEGER,
+                     lutRows ? lutTexels.data() : nullptr);
+
+        glGenTextures(1, &targetTex);
+        setupTexture(targetTex, GL_RGBA8UI, tile, tile, GL_RGBA_INTEGER, nullptr);
+        glGenFramebuffers(1, &fbo);
+        glBindFramebuffer(GL_FRAMEBUFFER, fbo);
+        glFramebufferTexture2D(GL_FRAMEBUFFER, GL_COLOR_ATTACHMENT0, GL_TEXTURE_2D, targetTex, 0);
+        if (glCheckFramebufferStatus(GL_FRAMEBUFFER) != GL_FRAMEBUFFER_COMPLETE) {
+            error = "framebuffer RGBA8UI incompleto";
+            release();
+            return false;
+        }
+
+        glGenBuffers(2, pbo);
+        for (int i = 0; i < 2; i++) {
+            glBindBuffer(GL_PIXEL_PACK_BUFFER, pbo[i]);
+            glBufferData(GL_PIXEL_PACK_BUFFER, (GLsizeiptr)tile * tile * 4, nullptr, GL_STREAM_READ);
+        }
+        glBindBuffer(GL_PIXEL_PACK_BUFFER, 0);
+        return true;
+    }
+
+    // Mesmo contrato de FilterChain::apply: RGB intercalado in-place e,
+    // se mask não for nulo, 255 nos pixels chaveados.
+    bool apply(unsigned char *data, int w, int h, unsigned char *mask = nullptr) {
+        if (!program) return false;
+        glUseProgram(program);
+        glBindVertexArray(vao);
+        glBindFramebuffer(GL_FRAMEBUFFER, fbo);
+        glActiveTexture(GL_TEXTURE1);
+        glBindTexture(GL_TEXTURE_2D, lutTex);
+        glActiveTexture(GL_TEXTURE0);
+        glBindTexture(GL_TEXTURE_2D, imageTex);
+        glPixelStorei(GL_UNPACK_ALIGNMENT, 1);
+        glPixelStorei(GL_UNPACK_ROW_LENGTH, w);
+        glPixelStorei(GL_PACK_ALIGNMENT, 4);
+
+        Tile pending[2];
+        int slot = 0;
+        bool ok = true;
+        for (int y0 = 0; y0 < h; y0 += tile) {
+            for (int x0 = 0; x0 < w; x0 += tile) {
+                Tile &t = pending[slot];
+                t.x0 = x0;
+                t.y0 = y0;
+                t.w = w - x0 < tile ? w - x0 : tile;
+                t.h = h - y0 < tile ? h - y0 : tile;
+
+                glPixelStorei(GL_UNPACK_SKIP_PIXELS, x0);
+                glPixelStorei(GL_UNPACK_SKIP_ROWS, y0);
+                glTexSubImage2D(GL_TEXTURE_2D, 0, 0, 0, t.w, t.h, GL_RGB_INTEGER, GL_UNSIGNED_BYTE, data);
+                glViewport(0, 0, t.w, t.h);
+                glDrawArrays(GL_TRIANGLES, 0, 3);
+
+                glBindBuffer(GL_PIXEL_PACK_BUFFER, pbo[slot]);
+                glReadPixels(0, 0, t.w, t.h, GL_RGBA_INTEGER, GL_UNSIGNED_BYTE, nullptr);
+                t.fence = glFenceSync(GL_SYNC_GPU_COMMANDS_COMPLETE, 0);
+                glFlush();
+
+                // o bloco anterior já deve ter terminado enquanto este era enviado
+                slot = 1 - slot;
+                if (pending[slot].fence) ok = finish(pending[slot], pbo[slot], data, w, mask) && ok;
+            }
+        }
+        slot = 1 - slot;
+        if (pending[slot].fence) ok = finish(pending[slot], pbo[slot], data, w, mask) && ok;
+
+        glBindBuffer(GL_PIXEL_PACK_BUFFER, 0);
+        glPixelStorei(GL_UNPACK_ROW_LENGTH, 0);
+        glPixelStorei(GL_UNPACK_SKIP_PIXELS, 0);
+        glPixelStorei(GL_UNPACK_SKIP_ROWS, 0);
+        if (glGetError() != GL_NO_ERROR) ok = false;
+        if (!ok) cerr << "Erro de OpenGL ao filtrar na GPU" << endl;
+        return ok;
+    }
+
+    void release() {
+        if (!program) return;
+        glDeleteBuffers(2, pbo);
+        glDeleteFramebuffers(1, &fbo);
+        GLuint tex[3] = {imageTex, lutTex, targetTex};
+        glDeleteTextures(3, tex);
+        glDeleteVertexArrays(1, &vao);
+        glDeleteProgram(program);
+        program = 0;
+    }
+
+private:
+    struct Tile {
+        int x0 = 0, y0 = 0, w = 0, h = 0;
+        GLsync fence = nullptr;
+    };
+
+    // Triângulo que cobre a tela inteira, sem buffer de vértices.
+    static constexpr const char *VERTEX_SOURCE =
+        "#version 330 core\n"
+        "void main() {\n"
+        "    vec2 p = vec2((gl_VertexID << 1) & 2, gl_VertexID & 2);\n"
+        "    gl_Position = vec4(p * 2.0 - 1.0, 0.0, 1.0);\n"
+        "}\n";
+
+    // Um bloco de código por estágio, na ordem da cadeia. As tabelas dos
+    // estágios CHANNEL_MAP vão para lutTexels, uma linha RGBA por estágio.
+    static string fragmentSource(const FilterChain &chain, vector<unsigned char> &lutTexels) {
+        string s =
+            "#version 330 core\n"
+            "uniform usampler2D image;\n"
+            "uniform usampler2D luts;\n"
+            "out uvec4 color;\n"
+            "void main() {\n"
+            "    uvec3 c = texelFetch(image, ivec2(gl_FragCoord.xy), 0).rgb;\n"
+            "    uint keyed = 0u;\n";
+        int lutRow = 0;
+        for (const FilterStage &st : chain.stageList()) {
+            switch (st.kind) {
+                case FilterStage::CHANNEL_MAP: {
+                    for (int v = 0; v < 256; v++) {
+                        for (int ch = 0; ch < 3; ch++) lutTexels.push_back(st.lut[ch][v]);
+                        lutTexels.push_back(0);
+                    }
+                    string row = to_string(lutRow++);
+                    s += "    c = uvec3(texelFetch(luts, ivec2(int(c.r), " + row + "), 0).r,\n"
+                         "              texelFetch(luts, ivec2(int(c.g), " + row + "), 0).g,\n"
+                         "              texelFetch(luts, ivec2(int(c.b), " + row + "), 0).b);\n";
+                    break;
+                }
+                case FilterStage::GRAY:
+                    s += "    c = uvec3((c.r * " + to_string(st.luma.r) + "u + c.g * " + to_string(st.luma.g)
+                         + "u + c.b * " + to_string(st.luma.b) + "u + 16384u) >> 15);\n";
+                    break;
+                case FilterStage::CHROMA:
+                    s += "    {\n"
+                         "        ivec3 d = ivec3(c) - ivec3(" + to_string(st.key.r) + ", " + to_string(st.key.g)
+                         + ", " + to_string(st.key.b) + ");\n"
+                         "        if (d.r * d.r + d.g * d.g + d.b * d.b < " + to_string(st.key.threshold2) + ") {\n"
+                         "            c = uvec3(0u);\n"
+                         "            keyed = 255u;\n"
+                         "        }\n"
+                         "    }\n";
+                    break;
+                case FilterStage::TINT:
+                    s += "    {\n"
+                         "        int l2 = int(max(c.r, max(c.g, c.b)) + min(c.r, min(c.g, c.b)));\n"
+                         "        int m64 = min(l2, 510 - l2) << 6;\n"
+                         "        ivec3 d = (m64 * ivec3(" + to_string(st.tintK.k[0]) + ", " + to_string(st.tintK.k[1])
+                         + ", " + to_string(st.tintK.k[2]) + ") + 16384) >> 15;\n"
+                         "        c = uvec3(clamp((l2 + d + 1) >> 1, 0, 255));\n"
+                         "    }\n";
+                    break;
+                case FilterStage::AUTO_LEVELS:
+                case FilterStage::EQUALIZE:
+                case FilterStage::BLUR:
+                case FilterStage::CUBE:
+                case FilterStage::HUE_SAT:
+                    break; // recusados em init()
+            }
+        }
+        s += "    color = uvec4(c, keyed);\n"
+             "}\n";
+        return s;
+    }
+
+    static GLuint compileShader(GLenum type, const char *source, string &error) {
+        GLuint sh = glCreateShader(type);
+        glShaderSource(sh, 1, &source, NULL);
+        glCompileShader(sh);
+        GLint ok = 0;
+        glGetShaderiv(sh, GL_COMPILE_STATUS, &ok);
+        if (!ok) {
+            char log[1024];
+            glGetShaderInfoLog(sh, sizeof(log), NULL, log);
+            error = string("erro ao compilar shader: ") + log;
+            glDeleteShader(sh);
+            return 0;
+        }
+        return sh;
+    }
+
+    static GLuint linkProgram(const char *vs, const char *fs, string &error) {
+        GLuint v = compileShader(GL_VERTEX_SHADER, vs, error);
+        if (!v) return 0;
+        GLuint f = compileShader(GL_FRAGMENT_SHADER, fs, error);
+        if (!f) {
+            glDeleteShader(v);
+            return 0;
+        }
+        GLuint p = glCreateProgram();
+        glAttachShader(p, v);
+        glAttachShader(p, f);
+        glLinkProgram(p);
+        glDeleteShader(v);
+        glDeleteShader(f);
+        GLint ok = 0;
+        glGetProgramiv(p, GL_LINK_STATUS, &ok);
+        if (!ok) {
+            char log[1024];
+            glGetProgramInfoLog(p, sizeof(log), NULL, log);
+            error = string("erro ao ligar o programa: ") + log;
+            glDeleteProgram(p);
+            return 0;
+        }
+        return p;
+    }
+
+    // Texturas inteiras só podem ser amostradas com GL_NEAREST.
+    static void setupTexture(GLuint tex, GLint internalFormat, int w, int h, GLenum format, const void *pixels) {
+        glBindTexture(GL_TEXTURE_2D, tex);
+        glPixelStorei(GL_UNPACK_ALIGNMENT, 1);
+        glTexImage2D(GL_TEXTURE_2D, 0, internalFormat, w, h, 0, format, GL_UNSIGNED_BYTE, pixels);
+        glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_NEAREST);
+        glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_NEAREST);
+        glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, GL_CLAMP_TO_EDGE);
+        glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_T, GL_CLAMP_TO_EDGE);
+    }
+
+    // Espera o bloco ficar pronto e copia RGBA -> RGB (+ máscara).
+    static bool finish(Tile &t, GLuint buffer, unsigned char *data, int w, unsigned char *mask) {
+        GLenum r;
+        do {
+            r = glClientWaitSync(t.fence, GL_SYNC_FLUSH_COMMANDS_BIT, 1000000000);
+        } while (r == GL_TIMEOUT_EXPIRED);
+        glDeleteSync(t.fence);
+        t.fence = nullptr;
+        if (r == GL_WAIT_FAILED) return false;
+
+        glBindBuffer(GL_PIXEL_PACK_BUFFER, buffer);
+        const unsigned char *src = (const unsigned char *)glMapBufferRange(
+            GL_PIXEL_PACK_BUFFER, 0, (GLsizeiptr)t.w * t.h * 4, GL_MAP_READ_BIT);
+        if (!src) return false;
+        for (int y = 0; y < t.h; y++) {
+            const unsigned char *s = src + (size_t)y * t.w * 4;
+            size_t first = (size_t)(t.y0 + y) * w + t.x0;
+            unsigned char *d = data + first * 3;
+            for (int x = 0; x < t.w; x++) {
+                d[x * 3]     = s[x * 4];
+                d[x * 3 + 1] = s[x * 4 + 1];
+                d[x * 3 + 2] = s[x * 4 + 2];
+            }
+            if (mask) {
+                unsigned char *m = mask + first;
+                for (int x = 0; x < t.w; x++) m[x] = s[x * 4 + 3];
+            }
+        }
+        glUnmapBuffer(GL_PIXEL_PACK_BUFFER);
+        return true;
+    }
+
+    int tile = MAX_TILE;
+    GLuint program = 0, vao = 0, fbo = 0;
+    GLuint imageTex = 0, lutTex = 0, targetTex = 0;
+    GLuint pbo[2] = {0, 0};
+};
+
+#endif /* GpuFilters_h */
@@ -0,0 +1,219 @@
+//
+//  GrayScale.h
+//  Tons de cinza em ponto fixo: Y = (r*wr + g*wg + b*wb + 2^14) >> 15, com
+//  pesos de 15 bits somando 2^15 (branco continua 255).
+//
+//  A versão escalar é a referência; as versões SSSE3/AVX2/AVX-512 separam os
+//  canais com pshufb, fazem as somas com pmaddwd e dão o mesmo resultado,
+//  bit a bit. A escolha é feita em tempo de execução (CpuFeatures.h).
+//  As versões *Planar fazem a mesma conta sobre planos R, G e B separados
+//  (PlanarImage.h), sem os embaralhamentos de entrada e saída.
+//
+
+#ifndef GrayScale_h
+#define GrayScale_h
+
+#include <stddef.h>
+#include <math.h>
+
+#include "SimdRgb.h"
+
+struct LumaWeights {
+    int r, g, b; // Q15, r + g + b == 32768
+};
+
+// Converte pesos reais para Q15; o arredondamento que sobra vai para o maior peso.
+inline LumaWeights lumaWeights(double rw, double gw, double bw) {
+    double sum = rw + gw + bw;
+    LumaWeights w;
+    w.r = (int)lround(rw / sum * 32768.0);
+    w.g = (int)lround(gw / sum * 32768.0);
+    w.b = (int)lround(bw / sum * 32768.0);
+    int diff = 32768 - (w.r + w.g + w.b);
+    if (w.g >= w.r && w.g >= w.b) w.g += diff;
+    else if (w.r >= w.b) w.r += diff;
+    else w.b += diff;
+    return w;
+}
+
+inline void grayScaleScalar(unsigned char *data, size_t pixels, LumaWeights w) {
+    for (size_t i = 0; i < pixels * 3; i += 3) {
+        unsigned int y = (data[i] * w.r + data[i+1] * w.g + data[i+2] * w.b + 16384) >> 15;
+        data[i] = data[i+1] = data[i+2] = (unsigned char)y;
+    }
+}
+
+inline void grayScalePlanarScalar(unsigned char *r, unsigned char *g, unsigned char *b, size_t pixels,
+                                  LumaWeights w) {
+    for (size_t i = 0; i < pixels; i++) {
+        unsigned int y = (r[i] * w.r + g[i] * w.g + b[i] * w.b + 16384) >> 15;
+        r[i] = g[i] = b[i] = (unsigned char)y;
+    }
+}
+
+#if PG_SIMD_X86
+
+// Cada pista de 128 bits: 16 pixels -> 4 x pmaddwd de (r,g) e 4 de (b,1).
+#define PG_LUMA_LANES(SUF, VEC, ZERO, R, G, B, WRG, WB1, Y) do {                          \
+    VEC r0 = SUF##_unpacklo_epi8(R, ZERO), r1 = SUF##_unpackhi_epi8(R, ZERO);          \
+    VEC g0 = SUF##_unpacklo_epi8(G, ZERO), g1 = SUF##_unpackhi_epi8(G, ZERO);          \
+    VEC b0 = SUF##_unpacklo_epi8(B, ZERO), b1 = SUF##_unpackhi_epi8(B, ZERO);          \
+    VEC one = SUF##_set1_epi16(1);                                                      \
+    VEC s[4];                                                                           \
+    VEC rs[2] = {r0, r1}, gs[2] = {g0, g1}, bs[2] = {b0, b1};                           \
+    for (int h = 0; h < 2; h++) {                                                       \
+        VEC rgLo = SUF##_unpacklo_epi16(rs[h], gs[h]);                                  \
+        VEC rgHi = SUF##_unpackhi_epi16(rs[h], gs[h]);                                  \
+        VEC bLo = SUF##_unpacklo_epi16(bs[h], one);                                     \
+        VEC bHi = SUF##_unpackhi_epi16(bs[h], one);                                     \
+        s[2*h]   = SUF##_srli_epi32(SUF##_add_epi32(SUF##_madd_epi16(rgLo, WRG),        \
+                                                    SUF##_madd_epi16(bLo, WB1)), 15);   \
+        s[2*h+1] = SUF##_srli_epi32(SUF##_add_epi32(SUF##_madd_epi16(rgHi, WRG),        \
+                                                    SUF##_madd_epi16(bHi, WB1)), 15);   \
+    }                                                                                   \
+    Y = SUF##_packus_epi16(SUF##_packs_epi32(s[0], s[1]), SUF##_packs_epi32(s[2], s[3])); \
+} while (0)
+
+PG_TARGET("ssse3")
+inline void grayScaleSSSE3(unsigned char *data, size_t pixels, LumaWeights w) {
+    const __m128i wrg = _mm_set1_epi32((w.g << 16) | w.r);
+    const __m128i wb1 = _mm_set1_epi32((16384 << 16) | w.b);
+    const __m128i zero = _mm_setzero_si128();
+    size_t i = 0;
+    for (; i + 16 <= pixels; i += 16) {
+        unsigned char *p = data + i * 3;
+        __m128i r, g, b, y;
+        splitRgb(p, r, g, b);
+        PG_LUMA_LANES(_mm, __m128i, zero, r, g, b, wrg, wb1, y);
+        storeSpread(p, y);
+    }
+    grayScaleScalar(data + i * 3, pixels - i, w);
+}
+
+PG_TARGET("avx2")
+inline void grayScaleAVX2(unsigned char *data, size_t pixels, LumaWeights w) {
+    const __m256i wrg = _mm256_set1_epi32((w.g << 16) | w.r);
+    const __m256i wb1 = _mm256_set1_epi32((16384 << 16) | w.b);
+    const __m256i zero = _mm256_setzero_si256();
+    size_t i = 0;
+    for (; i + 32 <= pixels; i += 32) {
+        unsigned char *p = data + i * 3;
+        __m256i r, g, b, y;
+        splitRgb(p, r, g, b);
+        PG_LUMA_LANES(_mm256, __m256i, zero, r, g, b, wrg, wb1, y);
+        storeSpread(p, y);
+    }
+    grayScaleScalar(data + i * 3, pixels - i, w);
+}
+
+PG_TARGET("avx512f,avx512bw")
+inline void grayScaleAVX512(unsigned char *data, size_t pixels, LumaWeights w) {
+    const __m512i wrg = _mm512_set1_epi32((w.g << 16) | w.r);
+    const __m512i wb1 = _mm512_set1_epi32((16384 << 16) | w.b);
+    const __m512i zero = _mm512_setzero_si512();
+    size_t i = 0;
+    for (; i + 64 <= pixels; i += 64) {
+        unsigned char *p = data + i * 3;
+        __m512i r, g, b, y;
+        splitRgb(p, r, g, b);
+        PG_LUMA_LANES(_mm512, __m512i, zero, r, g, b, wrg, wb1, y);
+        storeSpread(p, y);
+    }
+    grayScaleScalar(data + i * 3, pixels - i, w);
+}
+
+// Planar: STEP pixels de cada plano por iteração, Y gravado nos três planos.
+#define PG_GRAY_PLANAR_BODY(SUF, VEC, SI, STEP)                                         \
+    const VEC wrg = SUF##_set1_epi32((w.g << 16) | w.r);                                \
+    const VEC wb1 = SUF##_set1_epi32((16384 << 16) | w.b);                              \
+    const VEC zero = SUF##_setzero_##SI();                                              \
+    size_t i = 0;                                                                       \
+    for (; i + STEP <= pixels; i += STEP) {                                             \
+        VEC rv = SUF##_loadu_##SI((const VEC *)(r + i));                                \
+        VEC gv = SUF##_loadu_##SI((const VEC *)(g + i));                                \
+        VEC bv = SUF##_loadu_##SI((const VEC *)(b + i));                                \
+        VEC y;                                                                          \
+        PG_LUMA_LANES(SUF, VEC, zero, rv, gv, bv, wrg, wb1, y);                         \
+        SUF##_storeu_##SI((VEC *)(r + i), y);                                           \
+        SUF##_storeu_##SI((VEC *)(g + i), y);                                           \
+        SUF##_storeu_##SI((VEC *)(b + i), y);                                           \
+    }                                                                                   \
+    grayScalePlanarScalar(r + i, g + i, b + i, pixels - i, w);
+
+PG_TARGET("ssse3")
+inline void grayScalePlanarSSSE3(unsigned char *r, unsigned char *g, unsigned char *b, size_t pixels,
+                                 LumaWeights w) {
+    PG_GRAY_PLANAR_BODY(_mm, __m128i, si128, 16)
+}
+
+PG_TARGET("avx2")
+inline void grayScalePlanarAVX2(unsigned char *r, unsigned char *g, unsigned char *b, size_t pixels,
+                                LumaWeights w) {
+    PG_GRAY_PLANAR_BODY(_mm256, __m256i, si256, 32)
+}
+
+PG_TARGET("avx512f,avx512bw")
+inline void grayScalePlanarAVX512(unsigned char *r, unsigned char *g, unsigned char *b, size_t pixels,
+                                  LumaWeights w) {
+    PG_GRAY_PLANAR_BODY(_mm512, __m512i, si512, 64)
+}
+
+#undef PG_GRAY_PLANAR_BODY
+#undef PG_LUMA_LANES
+
+#endif /* PG_SIMD_X86 */
+
+typedef void (*GrayKernel)(unsigned char *data, size_t pixels, LumaWeights w);
+
+// Kernel para um nível; cai para o nível abaixo quando não há versão própria.
+inline GrayKernel grayKernelFor(SimdLevel level) {
+#if PG_SIMD_X86
+    switch (level) {
+        case SIMD_AVX512: return grayScaleAVX512;
+        case SIMD_AVX2:   return grayScaleAVX2;
+        case SIMD_SSSE3:  return grayScaleSSSE3;
+        default:          break;
+    }
+#else
+    (void)level;
+#endif
+    return grayScaleScalar;
+}
+
+inline void grayScaleFixed(unsigned char *data, size_t pixels, LumaWeights w) {
+    static const GrayKernel kernel = grayKernelFor(activeSimdLevel());
+    // pmaddwd usa pesos com sinal: um peso de 32768 (canal único) fica no escalar
+    if (w.r > 32767 || w.g > 32767 || w.b > 32767) {
+        grayScaleScalar(data, pixels, w);
+        return;
+    }
+    kernel(data, pixels, w);
+}
+
+typedef void (*GrayPlanarKernel)(unsigned char *r, unsigned char *g, unsigned char *b, size_t pixels,
+                                 LumaWeights w);
+
+inline GrayPlanarKernel grayPlanarKernelFor(SimdLevel level) {
+#if PG_SIMD_X86
+    switch (level) {
+        case SIMD_AVX512: return grayScalePlanarAVX512;
+        case SIMD_AVX2:   return grayScalePlanarAVX2;
+        case SIMD_SSSE3:  return grayScalePlanarSSSE3;
+        default:          break;
+    }
+#else
+    (void)level;
+#endif
+    return grayScalePlanarScalar;
+}
+
+inline void grayScalePlanar(unsigned char *r, unsigned char *g, unsigned char *b, size_t pixels, LumaWeights w) {
+    static const GrayPlanarKernel kernel = grayPlanarKernelFor(activeSimdLevel());
+    if (w.r > 32767 || w.g > 32767 || w.b > 32767) {
+        grayScalePlanarScalar(r, g, b, pixels, w);
+        return;
+    }
+    kernel(r, g, b, pixels, w);
+}
+
+#endif /* GrayScale_h */
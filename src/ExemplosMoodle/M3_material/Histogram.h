@@ -0,0 +1,183 @@
+//
+//  Histogram.h
+//  Histogramas por canal e as tabelas de auto-levels e equalização que
+//  saem deles.
+//
+//  Cada thread conta em bins próprios (HistogramAccumulator) e as contagens
+//  só são somadas no fim: nenhuma escrita compartilhada nem atômica durante
+//  a passada. Dentro do acumulador, pixels seguidos vão para quatro cópias
+//  dos bins, para que valores repetidos (fundo liso) não formem uma cadeia
+//  de dependências sobre o mesmo contador.
+//
+
+#ifndef Histogram_h
+#define Histogram_h
+
+#include <stddef.h>
+#include <stdint.h>
+#include <string.h>
+#include <vector>
+
+#include "ThreadPool.h"
+
+using namespace std;
+
+struct Histogram {
+    uint64_t bins[3][256];
+
+    Histogram() { clear(); }
+    void clear() { memset(bins, 0, sizeof(bins)); }
+
+    uint64_t total() const {
+        uint64_t n = 0;
+        for (int v = 0; v < 256; v++) n += bins[0][v];
+        return n;
+    }
+
+    void add(const Histogram &o) {
+        for (int c = 0; c < 3; c++) {
+            for (int v = 0; v < 256; v++) bins[c][v] += o.bins[c][v];
+        }
+    }
+};
+
+// Contagem privada de uma thread, descarregada em target no fim (ou antes
+// de algum contador de 32 bits poder estourar). 12 KiB: cabe no L1.
+class HistogramAccumulator {
+public:
+    explicit HistogramAccumulator(Histogram &target) : target(target) { memset(sub, 0, sizeof(sub)); }
+    ~HistogramAccumulator() { flush(); }
+
+    HistogramAccumulator(const HistogramAccumulator &) = delete;
+    HistogramAccumulator &operator=(const HistogramAccumulator &) = delete;
+
+    // pixels por chamada: no máximo LIMIT
+    static constexpr uint32_t LIMIT = 1u << 30;
+
+    // __restrict: um ponteiro unsigned char pode apontar para os contadores,
+    // e sem isso o compilador relê a imagem depois de cada incremento.
+    void add(const unsigned char *__restrict rgb, size_t pixels) {
+        reserve(pixels);
+        uint32_t (*__restrict s)[3][256] = sub;
+        size_t i = 0;
+        for (; i + 4 <= pixels; i += 4) {
+            const unsigned char *p = rgb + i * 3;
+            for (int k = 0; k < 4; k++) {
+                s[k][0][p[k * 3]]++;
+                s[k][1][p[k * 3 + 1]]++;
+                s[k][2][p[k * 3 + 2]]++;
+            }
+        }
+        for (; i < pixels; i++) {
+            s[0][0][rgb[i * 3]]++;
+            s[0][1][rgb[i * 3 + 1]]++;
+            s[0][2][rgb[i * 3 + 2]]++;
+        }
+    }
+
+    void addPlanes(const unsigned char *r, const unsigned char *g, const unsigned char *b, size_t pixels) {
+        reserve(pixels);
+        uint32_t (*__restrict s)[3][256] = sub;
+        const unsigned char *planes[3] = {r, g, b};
+        for (int c = 0; c < 3; c++) {
+            const unsigned char *__restrict p = planes[c];
+            size_t i = 0;
+            for (; i + 4 <= pixels; i += 4) {
+                s[0][c][p[i]]++;
+                s[1][c][p[i + 1]]++;
+                s[2][c][p[i + 2]]++;
+                s[3][c][p[i + 3]]++;
+            }
+            for (; i < pixels; i++) s[0][c][p[i]]++;
+        }
+    }
+
+    void flush() {
+        for (int k = 0; k < 4; k++) {
+            for (int c = 0; c < 3; c++) {
+                for (int v = 0; v < 256; v++) target.bins[c][v] += sub[k][c][v];
+            }
+        }
+        memset(sub, 0, sizeof(sub));
+        counted = 0;
+    }
+
+private:
+    void reserve(size_t pixels) {
+        if (counted + pixels > 0xffffffffu) flush();
+        counted += pixels;
+    }
+
+    Histogram &target;
+    uint32_t sub[4][3][256];
+    uint64_t counted = 0;
+};
+
+// Histograma de uma imagem RGB intercalada: uma tarefa por thread, cada uma
+// com um trecho contíguo de pixels e bins próprios.
+inline Histogram computeHistogram(const unsigned char *data, size_t pixels,
+                                  ThreadPool &pool = ThreadPool::shared()) {
+    size_t tasks = pool.size();
+    vector<Histogram> parts(tasks);
+    pool.run(tasks, [&](size_t t) {
+        size_t a = pixels * t / tasks, b = pixels * (t + 1) / tasks;
+        HistogramAccumulator acc(parts[t]);
+        for (size_t i = a; i < b; i += HistogramAccumulator::LIMIT) {
+            acc.add(data + i * 3, b - i < HistogramAccumulator::LIMIT ? b - i : HistogramAccumulator::LIMIT);
+        }
+    });
+    Histogram h;
+    for (const Histogram &p : parts) h.add(p);
+    return h;
+}
+
+// Auto-levels por canal: descarta a fração clip dos pixels mais escuros e a
+// dos mais claros, e estica o intervalo restante linearmente para 0..255.
+inline void autoLevelsLut(const Histogram &h, double clip, unsigned char lut[3][256]) {
+    uint64_t n = h.total();
+    if (clip < 0) clip = 0;
+    if (clip > 0.49) clip = 0.49;
+    uint64_t cut = (uint64_t)(clip * (double)n);
+    for (int c = 0; c < 3; c++) {
+        int lo = 0, hi = 255;
+        uint64_t acc = 0;
+        while (lo < 255 && acc + h.bins[c][lo] <= cut) acc += h.bins[c][lo++];
+        acc = 0;
+        while (hi > 0 && acc + h.bins[c][hi] <= cut) acc += h.bins[c][hi--];
+        for (int v = 0; v < 256; v++) {
+            if (hi <= lo) {
+                lut[c][v] = (unsigned char)v; // canal constante: nada a esticar
+            } else if (v <= lo) {
+                lut[c][v] = 0;
+            } else if (v >= hi) {
+                lut[c][v] = 255;
+            } else {
+                lut[c][v] = (unsigned char)(((v - lo) * 255 + (hi - lo) / 2) / (hi - lo));
+            }
+        }
+    }
+}
+
+// Equalização por canal: v -> (cdf(v) - cdfMin) * 255 / (n - cdfMin), com
+// cdfMin = contagem do menor valor presente (ele vai para 0).
+inline void equalizeLut(const Histogram &h, unsigned char lut[3][256]) {
+    uint64_t n = h.total();
+    for (int c = 0; c < 3; c++) {
+        uint64_t cdfMin = 0;
+        for (int v = 0; v < 256 && cdfMin == 0; v++) cdfMin = h.bins[c][v];
+        uint64_t range = n - cdfMin;
+        uint64_t cdf = 0;
+        for (int v = 0; v < 256; v++) {
+            cdf += h.bins[c][v];
+            if (range == 0) {
+                lut[c][v] = (unsigned char)v;
+            } else if (cdf <= cdfMin) {
+                lut[c][v] = 0;
+            } else {
+                lut[c][v] = (unsigned char)(((cdf - cdfMin) * 255 + range / 2) / range);
+            }
+        }
+    }
+}
+
+#endif /* Histogram_h */
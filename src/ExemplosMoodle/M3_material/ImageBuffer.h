@@ -0,0 +1,235 @@
+//
+//  ImageBuffer.h
+//  Buffer de imagem alinhado e reaproveitável.
+//
+//  ImageBuffer começa num endereço múltiplo de 64 bytes, tem passo (stride)
+//  entre linhas e pelo menos um registrador AVX-512 de folga depois da
+//  última linha, para que um kernel possa ler o fim da imagem com uma carga
+//  vetorial inteira. Com rowAlign > 1 cada linha também começa alinhada.
+//  Os filtros do exemplo_03 percorrem a imagem como uma sequência contínua
+//  de pixels, então o programa usa linhas compactas (rowAlign = 1).
+//
+//  ImagePool guarda os blocos devolvidos e os entrega de novo ao próximo
+//  pedido de tamanho parecido: num lote de quadros do mesmo tamanho, depois
+//  do primeiro arquivo nada mais é alocado e as páginas já estão mapeadas
+//  (sem page fault a cada quadro).
+//
+
+#ifndef ImageBuffer_h
+#define ImageBuffer_h
+
+#include <mutex>
+#include <new>
+#include <stddef.h>
+#include <stdint.h>
+#include <vector>
+
+using namespace std;
+
+class ImagePool;
+
+class ImageBuffer {
+public:
+    static const size_t ALIGN = 64;
+
+    ImageBuffer() {}
+    ImageBuffer(int w, int h, int channels = 3, size_t rowAlign = 1) { allocate(w, h, channels, rowAlign); }
+    ~ImageBuffer() { release(); }
+
+    ImageBuffer(ImageBuffer &&o) noexcept { take(o); }
+    ImageBuffer &operator=(ImageBuffer &&o) noexcept {
+        if (this != &o) {
+            release();
+            take(o);
+        }
+        return *this;
+    }
+    ImageBuffer(const ImageBuffer &) = delete;
+    ImageBuffer &operator=(const ImageBuffer &) = delete;
+
+    // Redimensiona (o conteúdo anterior se perde). Com pool, o bloco vem
+    // dele e volta para ele em release(); sem pool, é alocado e liberado
+    // direto. O conteúdo novo não é inicializado.
+    inline void allocate(int w, int h, int channels = 3, size_t rowAlign = 1, ImagePool *pool = nullptr);
+    inline void release();
+
+    // Passa a ser dono de block, vindo de allocateBlock com pelo menos
+    // blockBytes(w * h * channels) bytes e com a imagem em linhas compactas.
+    // Em release() ele vai para pool como um bloco próprio (sem pool, é
+    // liberado).
+    inline void adopt(unsigned char *block, int w, int h, int channels = 3, ImagePool *pool = nullptr);
+
+    int getWidth() const { return width; }
+    int getHeight() const { return height; }
+    int getChannels() const { return channels; }
+    size_t getStride() const { return stride; }
+    size_t pixels() const { return (size_t)width * height; }
+    // bytes de [row(0), fim da última linha)
+    size_t bytes() const { return stride * height; }
+    size_t capacity() const { return cap; }
+    bool contiguous() const { return stride == (size_t)width * channels; }
+    bool empty() const { return ptr == nullptr; }
+
+    unsigned char *data() { return ptr; }
+    const unsigned char *data() const { return ptr; }
+    unsigned char *row(int y) { return ptr + stride * y; }
+    const unsigned char *row(int y) const { return ptr + stride * y; }
+
+    static unsigned char *allocateBlock(size_t bytes) {
+        return (unsigned char *)::operator new(bytes, align_val_t(ALIGN));
+    }
+    static void freeBlock(unsigned char *p) { ::operator delete(p, align_val_t(ALIGN)); }
+
+    // Tamanho do bloco para bytes de imagem: um registrador de folga no fim
+    // e o total em múltiplos de ALIGN.
+    static size_t blockBytes(size_t bytes) { return (bytes + ALIGN - 1) / ALIGN * ALIGN + ALIGN; }
+
+private:
+    void take(ImageBuffer &o) {
+        ptr = o.ptr;
+        cap = o.cap;
+        pool = o.pool;
+        width = o.width;
+        height = o.height;
+        channels = o.channels;
+        stride = o.stride;
+        o.ptr = nullptr;
+        o.cap = 0;
+        o.pool = nullptr;
+        o.width = o.height = 0;
+        o.stride = 0;
+    }
+
+    unsigned char *ptr = nullptr;
+    size_t cap = 0;
+    ImagePool *pool = nullptr;
+    int width = 0, height = 0, channels = 3;
+    size_t stride = 0;
+};
+
+class ImagePool {
+public:
+    // maxCached: limite de bytes guardados sem uso; o excedente é liberado.
+    explicit ImagePool(size_t maxCached = (size_t)1 << 30) : maxCached(maxCached) {}
+
+    ~ImagePool() {
+        for (const Block &b : freeList) ImageBuffer::freeBlock(b.ptr);
+    }
+
+    ImagePool(const ImagePool &) = delete;
+    ImagePool &operator=(const ImagePool &) = delete;
+
+    static ImagePool &shared() {
+        static ImagePool pool;
+        return pool;
+    }
+
+    ImageBuffer acquire(int w, int h, int channels = 3, size_t rowAlign = 1) {
+        ImageBuffer b;
+        b.allocate(w, h, channels, rowAlign, this);
+        return b;
+    }
+
+    // Blocos alocados de fato e pedidos atendidos com um bloco guardado.
+    size_t allocations() const {
+        lock_guard<mutex> lock(mtx);
+        return allocated;
+    }
+    size_t reuses() const {
+        lock_guard<mutex> lock(mtx);
+        return reused;
+    }
+
+    // Menor bloco guardado com pelo menos bytes (e no máximo o dobro, para
+    // uma imagem pequena não prender um bloco enorme); senão um novo.
+    unsigned char *get(size_t bytes, size_t &capacity) {
+        {
+            lock_guard<mutex> lock(mtx);
+            size_t best = freeList.size();
+            for (size_t i = 0; i < freeList.size(); i++) {
+                size_t c = freeList[i].capacity;
+                if (c >= bytes && c / 2 <= bytes && (best == freeList.size() || c < freeList[best].capacity)) best = i;
+            }
+            if (best < freeList.size()) {
+                Block b = freeList[best];
+                freeList[best] = freeList.back();
+                freeList.pop_back();
+                cached -= b.capacity;
+                reused++;
+                capacity = b.capacity;
+                return b.ptr;
+            }
+            allocated++;
+        }
+        capacity = bytes;
+        return ImageBuffer::allocateBlock(bytes);
+    }
+
+    void put(unsigned char *p, size_t capacity) {
+        {
+            lock_guard<mutex> lock(mtx);
+            if (cached + capacity <= maxCached) {
+                freeList.push_back({p, capacity});
+                cached += capacity;
+                return;
+            }
+        }
+        ImageBuffer::freeBlock(p);
+    }
+
+private:
+    struct Block {
+        unsigned char *ptr;
+        size_t capacity;
+    };
+
+    mutable mutex mtx;
+    vector<Block> freeList;
+    size_t cached = 0;
+    size_t maxCached;
+    size_t allocated = 0, reused = 0;
+};
+
+inline void ImageBuffer::allocate(int w, int h, int channels, size_t rowAlign, ImagePool *pool) {
+    if (rowAlign == 0) rowAlign = 1;
+    size_t rowBytes = (size_t)w * channels;
+    size_t newStride = (rowBytes + rowAlign - 1) / rowAlign * rowAlign;
+    size_t need = blockBytes(newStride * h);
+    if (!ptr || this->pool != pool || cap < need) {
+        release();
+        this->pool = pool;
+        ptr = pool ? pool->get(need, cap) : allocateBlock(need);
+        if (!pool) cap = need;
+    }
+    width = w;
+    height = h;
+    this->channels = channels;
+    stride = newStride;
+}
+
+inline void ImageBuffer::adopt(unsigned char *block, int w, int h, int channels, ImagePool *pool) {
+    release();
+    ptr = block;
+    cap = blockBytes((size_t)w * h * channels);
+    this->pool = pool;
+    width = w;
+    height = h;
+    this->channels = channels;
+    stride = (size_t)w * channels;
+}
+
+inline void ImageBuffer::release() {
+    if (!ptr) return;
+    if (pool) {
+        pool->put(ptr, cap);
+    } else {
+        freeBlock(ptr);
+    }
+    ptr = nullptr;
+    cap = 0;
+    pool = nullptr;
+    width = height = 0;
+    stride = 0;
+}
+
+#endif /* ImageBuffer_h */
@@ -0,0 +1,382 @@
+//
+//  ImageCompare.h
+//  Comparação de duas imagens RGB do mesmo tamanho: MSE/PSNR por canal,
+//  maior diferença, pixels diferentes, SSIM em janelas e mapa de diferença.
+//
+//  MSE e diferença máxima: por bloco de 4096 pixels as duas imagens são
+//  separadas em planos (PlanarImage.h) e um kernel SIMD acumula, por canal,
+//  |a - b| com subs saturado e o quadrado com madd, em 32 bits por bloco.
+//
+//  SSIM: sobre a luma, em janelas quadradas (8x8 por padrão) em todas as
+//  posições em que cabem inteiras na imagem. As somas de x, y, x², y² e xy
+//  de cada janela saem de tabelas de soma acumulada (integral images) com 4
+//  leituras por tabela, então o custo não depende do tamanho da janela. As
+//  tabelas são de 32 bits e podem dar a volta: a soma de uma janela é uma
+//  diferença módulo 2^32 e sai exata enquanto couber em 32 bits, o que vale
+//  para x² em janelas de até SSIM_MAX_WINDOW (256² x 255² < 2^32; com 257
+//  já não cabe), o limite do lado. Com janelas de até 11x11 as contas de
+//  cada janela também cabem em int32 e a versão AVX2 faz 8 janelas por vez.
+//
+
+#ifndef ImageCompare_h
+#define ImageCompare_h
+
+#include <algorithm>
+#include <math.h>
+#include <mutex>
+#include <stddef.h>
+#include <stdint.h>
+#include <string.h>
+#include <vector>
+
+#include "CpuFeatures.h"
+#include "ThreadPool.h"
+#include "PlanarImage.h"
+#include "SummedArea.h"
+
+using namespace std;
+
+struct DiffStats {
+    uint64_t sse[3] = {0, 0, 0}; // soma dos quadrados das diferenças, por canal
+    size_t differing = 0;        // pixels com algum canal diferente
+    int maxDiff = 0;             // maior |a - b| em qualquer canal
+
+    void add(const DiffStats &o) {
+        for (int c = 0; c < 3; c++) sse[c] += o.sse[c];
+        differing += o.differing;
+        maxDiff = max(maxDiff, o.maxDiff);
+    }
+};
+
+inline void diffPlanesRange(const unsigned char *const a[3], const unsigned char *const b[3], size_t begin,
+                            size_t end, DiffStats &st) {
+    for (size_t i = begin; i < end; i++) {
+        int any = 0;
+        for (int c = 0; c < 3; c++) {
+            int d = abs((int)a[c][i] - (int)b[c][i]);
+            st.sse[c] += (uint64_t)(d * d);
+            st.maxDiff = max(st.maxDiff, d);
+            any |= d;
+        }
+        if (any) st.differing++;
+    }
+}
+
+// a e b: planos R, G e B de n <= 4096 pixels (o limite mantém as somas de
+// cada faixa do registrador em 32 bits).
+inline void diffPlanesScalar(const unsigned char *const a[3], const unsigned char *const b[3], size_t n,
+                             DiffStats &st) {
+    diffPlanesRange(a, b, 0, n, st);
+}
+
+#if PG_SIMD_X86
+
+// ZEROS: quantos bytes de any são zero (pixels iguais nos três canais).
+#define PG_DIFF_BODY(SUF, VEC, SI, STEP, ZEROS)                                                  \
+    const VEC zero = SUF##_setzero_##SI();                                                       \
+    VEC sse[3] = {zero, zero, zero};                                                             \
+    VEC mx = zero;                                                                               \
+    size_t same = 0;                                                                             \
+    size_t i = 0;                                                                                \
+    for (; i + STEP <= n; i += STEP) {                                                           \
+        VEC any = zero;                                                                          \
+        for (int c = 0; c < 3; c++) {                                                            \
+            VEC va = SUF##_loadu_##SI((const VEC *)(a[c] + i));                                  \
+            VEC vb = SUF##_loadu_##SI((const VEC *)(b[c] + i));                                  \
+            VEC d = SUF##_or_##SI(SUF##_subs_epu8(va, vb), SUF##_subs_epu8(vb, va));             \
+            mx = SUF##_max_epu8(mx, d);                                                          \
+            any = SUF##_or_##SI(any, d);                                                         \
+            VEC lo = SUF##_unpacklo_epi8(d, zero), hi = SUF##_unpackhi_epi8(d, zero);            \
+            sse[c] = SUF##_add_epi32(sse[c], SUF##_add_epi32(SUF##_madd_epi16(lo, lo),           \
+                                                             SUF##_madd_epi16(hi, hi)));         \
+        }                                                                                        \
+        same += ZEROS;                                                                           \
+    }                                                                                            \
+    alignas(64) uint32_t lanes[STEP / 4];                                                        \
+    for (int c = 0; c < 3; c++) {                                                                \
+        SUF##_store_##SI((VEC *)lanes, sse[c]);                                                  \
+        for (int k = 0; k < STEP / 4; k++) st.sse[c] += lanes[k];                                \
+    }                                                                                            \
+    alignas(64) unsigned char bytes[STEP];                                                       \
+    SUF##_store_##SI((VEC *)bytes, mx);                                                          \
+    for (int k = 0; k < STEP; k++) st.maxDiff = max(st.maxDiff, (int)bytes[k]);                  \
+    st.differing += i - same;                                                                    \
+    diffPlanesRange(a, b, i, n, st);
+
+PG_TARGET("ssse3")
+inline void diffPlanesSSSE3(const unsigned char *const a[3], const unsigned char *const b[3], size_t n,
+                            DiffStats &st) {
+    PG_DIFF_BODY(_mm, __m128i, si128, 16,
+                 (size_t)__builtin_popcount((unsigned)_mm_movemask_epi8(_mm_cmpeq_epi8(any, zero))))
+}
+
+PG_TARGET("avx2")
+inline void diffPlanesAVX2(const unsigned char *const a[3], const unsigned char *const b[3], size_t n,
+                           DiffStats &st) {
+    PG_DIFF_BODY(_mm256, __m256i, si256, 32,
+                 (size_t)__builtin_popcount((unsigned)_mm256_movemask_epi8(_mm256_cmpeq_epi8(any, zero))))
+}
+
+PG_TARGET("avx512f,avx512bw")
+inline void diffPlanesAVX512(const unsigned char *const a[3], const unsigned char *const b[3], size_t n,
+                             DiffStats &st) {
+    PG_DIFF_BODY(_mm512, __m512i, si512, 64, (size_t)__builtin_popcountll(_mm512_cmpeq_epi8_mask(any, zero)))
+}
+
+#undef PG_DIFF_BODY
+
+#endif /* PG_SIMD_X86 */
+
+typedef void (*DiffKernel)(const unsigned char *const a[3], const unsigned char *const b[3], size_t n,
+                           DiffStats &st);
+
+inline DiffKernel diffKernelFor(SimdLevel level) {
+#if PG_SIMD_X86
+    switch (level) {
+        case SIMD_AVX512: return diffPlanesAVX512;
+        case SIMD_AVX2:   return diffPlanesAVX2;
+        case SIMD_SSSE3:  return diffPlanesSSSE3;
+        default:          break;
+    }
+#else
+    (void)level;
+#endif
+    return diffPlanesScalar;
+}
+
+// Diferenças entre duas imagens RGB intercaladas de w x h pixels.
+inline DiffStats diffImages(const unsigned char *a, const unsigned char *b, int w, int h, DiffKernel kernel,
+                            ThreadPool &pool = ThreadPool::shared()) {
+    DiffStats total;
+    mutex mtx;
+    parallelRows(w, h, 3, [&](int y0, int y1) {
+        alignas(64) unsigned char planes[6][4096];
+        const unsigned char *pa[3] = {planes[0], planes[1], planes[2]};
+        const unsigned char *pb[3] = {planes[3], planes[4], planes[5]};
+        DiffStats st;
+        size_t first = (size_t)y0 * w, end = (size_t)y1 * w;
+        for (size_t i = first; i < end; i += 4096) {
+            size_t n = min((size_t)4096, end - i);
+            deinterleaveRgb(a + i * 3, n, planes[0], planes[1], planes[2]);
+            deinterleaveRgb(b + i * 3, n, planes[3], planes[4], planes[5]);
+            kernel(pa, pb, n, st);
+        }
+        lock_guard<mutex> lock(mtx);
+        total.add(st);
+    }, pool);
+    return total;
+}
+
+// Tabelas de soma acumulada da luma de duas imagens: t[y][x] = soma sobre
+// [0, y) x [0, x), módulo 2^32; (w + 1) x (h + 1) entradas cada.
+struct SsimTables {
+    int width = 0, height = 0;
+    size_t stride = 0;
+    vector<uint32_t> sx, sy, sxx, syy, sxy;
+
+    size_t at(int x, int y) const { return (size_t)y * stride + x; }
+};
+
+inline unsigned char lumaOf(const unsigned char *p) {
+    return (unsigned char)((77 * p[0] + 150 * p[1] + 29 * p[2] + 128) >> 8);
+}
+
+// Primeiro a soma de cada linha (faixas de linhas em paralelo), depois a
+// soma das linhas de cima (faixas de colunas em paralelo).
+inline void buildSsimTables(const unsigned char *a, const unsigned char *b, int w, int h, SsimTables &t,
+                            ThreadPool &pool = ThreadPool::shared()) {
+    t.width = w;
+    t.height = h;
+    t.stride = (size_t)w + 1;
+    size_t total = t.stride * (h + 1);
+    for (vector<uint32_t> *v : {&t.sx, &t.sy, &t.sxx, &t.syy, &t.sxy}) v->assign(total, 0);
+    parallelRows(w, h, 3, [&](int y0, int y1) {
+        for (int y = y0; y < y1; y++) {
+            const unsigned char *ra = a + (size_t)y * w * 3, *rb = b + (size_t)y * w * 3;
+            size_t o = t.at(1, y + 1);
+            uint32_t sx = 0, sy = 0, sxx = 0, syy = 0, sxy = 0;
+            for (int x = 0; x < w; x++) {
+                uint32_t va = lumaOf(ra + x * 3), vb = lumaOf(rb + x * 3);
+                t.sx[o + x] = sx += va;
+                t.sy[o + x] = sy += vb;
+                t.sxx[o + x] = sxx += va * va;
+                t.syy[o + x] = syy += vb * vb;
+                t.sxy[o + x] = sxy += va * vb;
+            }
+        }
+    }, pool);
+    for (vector<uint32_t> *v : {&t.sx, &t.sy, &t.sxx, &t.syy, &t.sxy}) {
+        accumulateColumns(v->data(), t.stride, h + 1, pool);
+    }
+}
+
+// Maior lado de janela cujas somas de quadrados cabem em 32 bits.
+static const int SSIM_MAX_WINDOW = 256;
+
+// Constantes do SSIM (K1 = 0.01, K2 = 0.03, L = 255) multiplicadas por N²,
+// porque as contas usam somas em vez de médias:
+// SSIM = (2 Sx Sy + c1)(2 (N Sxy - Sx Sy) + c2) /
+//        ((Sx² + Sy² + c1)(N Sxx - Sx² + N Syy - Sy² + c2)).
+inline void ssimConstants(int window, double &c1, double &c2) {
+    double n2 = (double)window * window * window * window;
+    c1 = 6.5025 * n2;
+    c2 = 58.5225 * n2;
+}
+
+// Soma do SSIM das janelas com canto superior esquerdo (x, y), x em
+// [first, count).
+inline double ssimRowRange(const SsimTables &t, int y, int window, int first, int count) {
+    double c1, c2;
+    ssimConstants(window, c1, c2);
+    int64_t n = (int64_t)window * window;
+    size_t top = t.at(0, y), bottom = t.at(0, y + window);
+    auto box = [&](const vector<uint32_t> &v, int x) -> int64_t {
+        return (int64_t)(uint32_t)(v[bottom + x + window] - v[bottom + x] - v[top + x + window] + v[top + x]);
+    };
+    double sum = 0;
+    for (int x = first; x < count; x++) {
+        int64_t sx = box(t.sx, x), sy = box(t.sy, x);
+        int64_t sxx = box(t.sxx, x), syy = box(t.syy, x), sxy = box(t.sxy, x);
+        double num = (2.0 * sx * sy + c1) * (2.0 * (n * sxy - sx * sy) + c2);
+        double den = ((double)(sx * sx + sy * sy) + c1) * ((double)(n * sxx - sx * sx + n * syy - sy * sy) + c2);
+        sum += num / den;
+    }
+    return sum;
+}
+
+inline double ssimRowScalar(const SsimTables &t, int y, int window, int count) {
+    return ssimRowRange(t, y, window, 0, count);
+}
+
+#if PG_SIMD_X86
+
+// Soma de 8 janelas vizinhas a partir das 4 quinas na tabela v.
+PG_TARGET("avx2")
+inline __m256i ssimBoxAVX2(const uint32_t *v, size_t top, size_t bottom, int x, int window) {
+    __m256i p00 = _mm256_loadu_si256((const __m256i *)(v + top + x));
+    __m256i p01 = _mm256_loadu_si256((const __m256i *)(v + top + x + window));
+    __m256i p10 = _mm256_loadu_si256((const __m256i *)(v + bottom + x));
+    __m256i p11 = _mm256_loadu_si256((const __m256i *)(v + bottom + x + window));
+    return _mm256_add_epi32(_mm256_sub_epi32(p11, p10), _mm256_sub_epi32(p00, p01));
+}
+
+// 8 janelas por vez. As somas e produtos são exatos em int32 com janelas de
+// até 11x11 (2 Sx Sy <= 2 * (121 * 255)² < 2^31); o resto é em float.
+PG_TARGET("avx2")
+inline double ssimRowAVX2(const SsimTables &t, int y, int window, int count) {
+    if (window > 11) return ssimRowScalar(t, y, window, count);
+    double c1d, c2d;
+    ssimConstants(window, c1d, c2d);
+    const __m256 c1 = _mm256_set1_ps((float)c1d), c2 = _mm256_set1_ps((float)c2d);
+    const __m256i n = _mm256_set1_epi32(window * window);
+    size_t top = t.at(0, y), bottom = t.at(0, y + window);
+    __m256 acc = _mm256_setzero_ps();
+    int x = 0;
+    for (; x + 8 <= count; x += 8) {
+        __m256i sx = ssimBoxAVX2(t.sx.data(), top, bottom, x, window);
+        __m256i sy = ssimBoxAVX2(t.sy.data(), top, bottom, x, window);
+        __m256i sxx = ssimBoxAVX2(t.sxx.data(), top, bottom, x, window);
+        __m256i syy = ssimBoxAVX2(t.syy.data(), top, bottom, x, window);
+        __m256i sxy = ssimBoxAVX2(t.sxy.data(), top, bottom, x, window);
+        __m256i xy = _mm256_mullo_epi32(sx, sy);
+        __m256i xx = _mm256_mullo_epi32(sx, sx), yy = _mm256_mullo_epi32(sy, sy);
+        __m256 mean = _mm256_cvtepi32_ps(_mm256_add_epi32(xy, xy));
+        __m256 cov = _mm256_cvtepi32_ps(_mm256_slli_epi32(_mm256_sub_epi32(_mm256_mullo_epi32(n, sxy), xy), 1));
+        __m256 means = _mm256_cvtepi32_ps(_mm256_add_epi32(xx, yy));
+        __m256 vars = _mm256_cvtepi32_ps(_mm256_sub_epi32(_mm256_mullo_epi32(n, _mm256_add_epi32(sxx, syy)),
+                                                          _mm256_add_epi32(xx, yy)));
+        __m256 num = _mm256_mul_ps(_mm256_add_ps(mean, c1), _mm256_add_ps(cov, c2));
+        __m256 den = _mm256_mul_ps(_mm256_add_ps(means, c1), _mm256_add_ps(vars, c2));
+        acc = _mm256_add_ps(acc, _mm256_div_ps(num, den));
+    }
+    alignas(32) float lanes[8];
+    _mm256_store_ps(lanes, acc);
+    double sum = 0;
+    for (int k = 0; k < 8; k++) sum += lanes[k];
+    return sum + ssimRowRange(t, y, window, x, count);
+}
+
+#endif /* PG_SIMD_X86 */
+
+typedef double (*SsimRowKernel)(const SsimTables &t, int y, int window, int count);
+
+// SSSE3 não tem mullo_epi32 (SSE4.1): usa a escalar; AVX-512 usa a AVX2,
+// que já lê as tabelas na velocidade da memória.
+inline SsimRowKernel ssimKernelFor(SimdLevel level) {
+#if PG_SIMD_X86
+    if (level >= SIMD_AVX2) return ssimRowAVX2;
+#else
+    (void)level;
+#endif
+    return ssimRowScalar;
+}
+
+// SSIM médio da luma em janelas window x window (reduzidas ao tamanho da
+// imagem, se ela for menor, e a SSIM_MAX_WINDOW). A soma é feita linha a
+// linha em ordem, então o resultado não depende do número de threads.
+inline double ssimImages(const unsigned char *a, const unsigned char *b, int w, int h, int window,
+                         SsimRowKernel kernel, ThreadPool &pool = ThreadPool::shared()) {
+    window = min(min(window, SSIM_MAX_WINDOW), min(w, h));
+    if (window < 1) return 1.0;
+    SsimTables t;
+    buildSsimTables(a, b, w, h, t, pool);
+    int cols = w - window + 1, rows = h - window + 1;
+    vector<double> rowSums(rows);
+    // cada janela lê 4 entradas de 5 tabelas: ~20 bytes por coluna
+    parallelRows(cols, rows, 20, [&](int y0, int y1) {
+        for (int y = y0; y < y1; y++) rowSums[y] = kernel(t, y, window, cols);
+    }, pool);
+    double sum = 0;
+    for (double s : rowSums) sum += s;
+    return sum / ((double)cols * rows);
+}
+
+struct ImageComparison {
+    DiffStats diff;
+    size_t pixels = 0;
+    double ssim = 1.0;
+
+    double mse(int c) const { return pixels ? (double)diff.sse[c] / pixels : 0.0; }
+    double mse() const { return (mse(0) + mse(1) + mse(2)) / 3; }
+    // infinito quando as imagens são iguais
+    double psnr(double m) const { return m > 0 ? 10 * log10(255.0 * 255.0 / m) : INFINITY; }
+    double psnr() const { return psnr(mse()); }
+};
+
+inline ImageComparison compareImages(const unsigned char *a, const unsigned char *b, int w, int h,
+                                     int window = 8) {
+    static const DiffKernel diff = diffKernelFor(activeSimdLevel());
+    static const SsimRowKernel ssim = ssimKernelFor(activeSimdLevel());
+    ImageComparison r;
+    r.pixels = (size_t)w * h;
+    r.diff = diffImages(a, b, w, h, diff);
+    r.ssim = r.diff.differing ? ssimImages(a, b, w, h, window, ssim) : 1.0;
+    return r;
+}
+
+// Mapa de diferença: em cada pixel a maior |a - b| entre os canais, vezes
+// gain, numa escala preto -> azul -> vermelho -> amarelo -> branco.
+inline void diffHeatmap(const unsigned char *a, const unsigned char *b, int w, int h, double gain,
+                        unsigned char *out) {
+    unsigned char colors[256][3];
+    static const float stops[5][3] = {{0, 0, 0}, {0, 0, 255}, {255, 0, 0}, {255, 255, 0}, {255, 255, 255}};
+    for (int v = 0; v < 256; v++) {
+        float pos = v / 255.0f * 4;
+        int s = min((int)pos, 3);
+        float f = pos - s;
+        for (int c = 0; c < 3; c++) {
+            colors[v][c] = (unsigned char)lroundf(stops[s][c] + f * (stops[s + 1][c] - stops[s][c]));
+        }
+    }
+    unsigned char scale[256];
+    for (int d = 0; d < 256; d++) scale[d] = (unsigned char)min(255.0, d * gain + 0.5);
+    parallelPixels(out, w, h, [&](unsigned char *o, size_t n, size_t first) {
+        const unsigned char *pa = a + first * 3, *pb = b + first * 3;
+        for (size_t i = 0; i < n * 3; i += 3) {
+            int d = max(abs(pa[i] - pb[i]), max(abs(pa[i + 1] - pb[i + 1]), abs(pa[i + 2] - pb[i + 2])));
+            memcpy(o + i, colors[scale[d]], 3);
+        }
+    });
+}
+
+#endif /* ImageCompare_h */
@@ -0,0 +1,84 @@
+//
+//  ImageIO.h
+//  Leitura de qualquer formato da stb_image (PNG, JPEG, TGA, BMP, ...)
+//  para ImageBuffer, além do PPM de PpmIO.h.
+//
+//  A stb_image aloca a imagem decodificada com STBI_MALLOC. Aqui esse
+//  alocador é o de ImageBuffer (blocos alinhados em 64 bytes com folga no
+//  fim), então o resultado da stb é adotado pelo ImageBuffer sem cópia e,
+//  ao ser liberado, volta para o ImagePool como qualquer outro quadro. A
+//  imagem vira sempre RGB de 8 bits: o alfa é descartado, tons de cinza são
+//  replicados e PNG de 16 bits é reduzido.
+//
+//  Um único .cpp do programa define STB_IMAGE_IMPLEMENTATION antes de
+//  incluir este arquivo (no exemplo_03, o próprio exemplo_03.cpp).
+//
+
+#ifndef ImageIO_h
+#define ImageIO_h
+
+#include <ctype.h>
+#include <fstream>
+#include <iostream>
+#include <string>
+#include <string.h>
+#include <thread>
+
+#include "ImageBuffer.h"
+#include "PpmIO.h"
+
+using namespace std;
+
+inline void *stbImageMalloc(size_t bytes) {
+    return ImageBuffer::allocateBlock(ImageBuffer::blockBytes(bytes));
+}
+
+// A stb só usa realloc com o tamanho antigo conhecido (STBI_REALLOC_SIZED).
+inline void *stbImageRealloc(void *p, size_t oldBytes, size_t newBytes) {
+    void *q = stbImageMalloc(newBytes);
+    if (p) {
+        memcpy(q, p, oldBytes < newBytes ? oldBytes : newBytes);
+        ImageBuffer::freeBlock((unsigned char *)p);
+    }
+    return q;
+}
+
+inline void stbImageFree(void *p) {
+    if (p) ImageBuffer::freeBlock((unsigned char *)p);
+}
+
+#define STBI_MALLOC(sz) stbImageMalloc(sz)
+#define STBI_REALLOC_SIZED(p, oldsz, newsz) stbImageRealloc(p, oldsz, newsz)
+#define STBI_FREE(p) stbImageFree(p)
+#include <stb_image.h>
+
+// P3 e P6 vão para loadPPM (P3 em paralelo, P6 lido direto no buffer).
+inline bool isPPMFile(const string &path) {
+    char magic[2] = {0, 0};
+    ifstream arq(path, ios::binary);
+    arq.read(magic, 2);
+    return magic[0] == 'P' && (magic[1] == '3' || magic[1] == '6');
+}
+
+// Carrega PPM ou qualquer formato da stb_image em img (RGB intercalado,
+// linhas compactas), com o bloco vindo de pool (nullptr = alocação própria).
+inline bool loadImage(const string &path, ImageBuffer &img, unsigned int threads = thread::hardware_concurrency(),
+                      ImagePool *pool = &ImagePool::shared()) {
+    if (isPPMFile(path)) return loadPPM(path, img, threads, pool);
+    int w = 0, h = 0, comp = 0;
+    unsigned char *pixels = stbi_load(path.c_str(), &w, &h, &comp, 3);
+    if (!pixels) {
+        cerr << "Não foi possível ler " << path << ": " << stbi_failure_reason() << endl;
+        return false;
+    }
+    img.adopt(pixels, w, h, 3, pool);
+    return true;
+}
+
+// Extensões que a leitura em lote aceita ao expandir uma pasta.
+inline bool isImageExtension(string ext) {
+    for (char &c : ext) c = (char)tolower((unsigned char)c);
+    return ext == ".ppm" || ext == ".png" || ext == ".jpg" || ext == ".jpeg" || ext == ".tga" || ext == ".bmp";
+}
+
+#endif /* ImageIO_h */
@@ -0,0 +1,122 @@
+//
+//  Pipeline.h
+//  Fila limitada e contabilidade de tempo para etapas em sequência.
+//
+//  Cada etapa tem suas threads: tiram um item da fila de entrada, processam
+//  e põem na fila da etapa seguinte. Como as filas têm capacidade fixa, uma
+//  etapa mais rápida acaba esperando a mais lenta, e o número de itens vivos
+//  (imagens em memória) fica limitado. O tempo que cada etapa passa
+//  trabalhando, esperando entrada e esperando espaço na saída mostra qual
+//  delas limita o conjunto.
+//
+
+#ifndef Pipeline_h
+#define Pipeline_h
+
+#include <chrono>
+#include <condition_variable>
+#include <deque>
+#include <mutex>
+#include <string>
+#include <utility>
+#include <stddef.h>
+
+using namespace std;
+
+template <typename T>
+class BoundedQueue {
+public:
+    // producers: quantas threads vão chamar producerDone(); a fila fecha
+    // quando a última chamar.
+    BoundedQueue(size_t capacity, unsigned int producers = 1)
+        : cap(capacity ? capacity : 1), producers(producers) {}
+
+    BoundedQueue(const BoundedQueue &) = delete;
+    BoundedQueue &operator=(const BoundedQueue &) = delete;
+
+    // Espera enquanto a fila estiver cheia; false se ela já foi fechada.
+    bool push(T &&item) {
+        unique_lock<mutex> lock(mtx);
+        notFull.wait(lock, [this]() { return items.size() < cap || closed; });
+        if (closed) return false;
+        items.push_back(std::move(item));
+        lock.unlock();
+        notEmpty.notify_one();
+        return true;
+    }
+
+    // Espera por um item; false quando a fila está fechada e vazia.
+    bool pop(T &item) {
+        unique_lock<mutex> lock(mtx);
+        notEmpty.wait(lock, [this]() { return !items.empty() || closed; });
+        if (items.empty()) return false;
+        item = std::move(items.front());
+        items.pop_front();
+        lock.unlock();
+        notFull.notify_one();
+        return true;
+    }
+
+    void producerDone() {
+        {
+            lock_guard<mutex> lock(mtx);
+            if (producers > 0 && --producers > 0) return;
+            closed = true;
+        }
+        notEmpty.notify_all();
+        notFull.notify_all();
+    }
+
+private:
+    mutex mtx;
+    condition_variable notEmpty, notFull;
+    deque<T> items;
+    size_t cap;
+    unsigned int producers;
+    bool closed = false;
+};
+
+// Tempos somados de todas as threads de uma etapa.
+class StageStats {
+public:
+    StageStats(const string &name, unsigned int threads) : name(name), threads(threads ? threads : 1) {}
+
+    // Cada thread acumula localmente e entrega uma vez, ao terminar.
+    void add(double busy, double inputWait, double outputWait, size_t count) {
+        lock_guard<mutex> lock(mtx);
+        busyMs += busy;
+        inputWaitMs += inputWait;
+        outputWaitMs += outputWait;
+        items += count;
+    }
+
+    // Fração do tempo total em que as threads da etapa estiveram trabalhando;
+    // a etapa com a maior fração é o gargalo.
+    double utilization(double wallMs) const { return wallMs > 0 ? busyMs / (threads * wallMs) : 0; }
+
+    const string name;
+    const unsigned int threads;
+    double busyMs = 0, inputWaitMs = 0, outputWaitMs = 0;
+    size_t items = 0;
+
+private:
+    mutex mtx;
+};
+
+// Acumuladores de uma thread: o tempo desde a última marca vai para o campo
+// indicado.
+struct StageTimer {
+    chrono::steady_clock::time_point mark = chrono::steady_clock::now();
+    double busy = 0, inputWait = 0, outputWait = 0;
+    size_t count = 0;
+
+    void lap(double &field) {
+        auto now = chrono::steady_clock::now();
+        field += chrono::duration<double, milli>(now - mark).count();
+        mark = now;
+    }
+
+    void report(StageStats &stats) const { stats.add(busy, inputWait, outputWait, count); }
+};
+
+#endif /* Pipeline_h */
@@ -0,0 +1,267 @@
+//
+//  PlanarImage.h
+//  Imagem em planos (SoA): todo o R, depois todo o G, depois todo o B (e A,
+//  opcional), cada plano começando num endereço múltiplo de 64 bytes.
+//
+//  Os arquivos PPM e os filtros antigos usam RGB intercalado (passo 3), que
+//  obriga todo kernel SIMD a separar e juntar os canais com pshufb. Em
+//  planos, operações por canal rodam na largura inteira do registrador. A
+//  conversão fica na fronteira (leitura/gravação) ou por bloco dentro da
+//  FilterChain, e também é vetorizada.
+//
+
+#ifndef PlanarImage_h
+#define PlanarImage_h
+
+#include <stddef.h>
+#include <stdint.h>
+#include <string.h>
+#include <vector>
+
+#include "SimdRgb.h"
+#include "ThreadPool.h"
+
+using namespace std;
+
+// Layout preferido por um filtro; LAYOUT_ANY = tanto faz.
+enum PixelLayout {
+    LAYOUT_ANY = 0,
+    LAYOUT_INTERLEAVED,
+    LAYOUT_PLANAR
+};
+
+inline void deinterleaveScalar(const unsigned char *rgb, size_t pixels, unsigned char *r, unsigned char *g,
+                               unsigned char *b) {
+    for (size_t i = 0; i < pixels; i++) {
+        r[i] = rgb[i * 3];
+        g[i] = rgb[i * 3 + 1];
+        b[i] = rgb[i * 3 + 2];
+    }
+}
+
+inline void interleaveScalar(const unsigned char *r, const unsigned char *g, const unsigned char *b,
+                             size_t pixels, unsigned char *rgb) {
+    for (size_t i = 0; i < pixels; i++) {
+        rgb[i * 3]     = r[i];
+        rgb[i * 3 + 1] = g[i];
+        rgb[i * 3 + 2] = b[i];
+    }
+}
+
+// Operação por canal (v & andMask) ^ xorMask: cobre colorize (OR), negative
+// (XOR) e qualquer composição dos dois.
+inline void bitwisePlaneScalar(unsigned char *p, size_t n, unsigned char andMask, unsigned char xorMask) {
+    for (size_t i = 0; i < n; i++) p[i] = (unsigned char)((p[i] & andMask) ^ xorMask);
+}
+
+#if PG_SIMD_X86
+
+#define PG_DEINTERLEAVE_BODY(SUF, VEC, SI, STEP)                                        \
+    size_t i = 0;                                                                       \
+    for (; i + STEP <= pixels; i += STEP) {                                             \
+        VEC rv, gv, bv;                                                                 \
+        splitRgb(rgb + i * 3, rv, gv, bv);                                              \
+        SUF##_storeu_##SI((VEC *)(r + i), rv);                                          \
+        SUF##_storeu_##SI((VEC *)(g + i), gv);                                          \
+        SUF##_storeu_##SI((VEC *)(b + i), bv);                                          \
+    }                                                                                   \
+    deinterleaveScalar(rgb + i * 3, pixels - i, r + i, g + i, b + i);
+
+#define PG_INTERLEAVE_BODY(SUF, VEC, SI, STEP)                                          \
+    size_t i = 0;                                                                       \
+    for (; i + STEP <= pixels; i += STEP) {                                             \
+        VEC v[3];                                                                       \
+        mergeRgb(SUF##_loadu_##SI((const VEC *)(r + i)), SUF##_loadu_##SI((const VEC *)(g + i)), \
+                 SUF##_loadu_##SI((const VEC *)(b + i)), v);                            \
+        storeRgb(rgb + i * 3, v);                                                       \
+    }                                                                                   \
+    interleaveScalar(r + i, g + i, b + i, pixels - i, rgb + i * 3);
+
+#define PG_BITWISE_BODY(SUF, VEC, SI, STEP)                                             \
+    const VEC a = SUF##_set1_epi8((char)andMask);                                       \
+    const VEC x = SUF##_set1_epi8((char)xorMask);                                       \
+    size_t i = 0;                                                                       \
+    for (; i + STEP <= n; i += STEP) {                                                  \
+        VEC v = SUF##_loadu_##SI((const VEC *)(p + i));                                 \
+        SUF##_storeu_##SI((VEC *)(p + i), SUF##_xor_##SI(SUF##_and_##SI(v, a), x));     \
+    }                                                                                   \
+    bitwisePlaneScalar(p + i, n - i, andMask, xorMask);
+
+PG_TARGET("ssse3")
+inline void deinterleaveSSSE3(const unsigned char *rgb, size_t pixels, unsigned char *r, unsigned char *g,
+                              unsigned char *b) {
+    PG_DEINTERLEAVE_BODY(_mm, __m128i, si128, 16)
+}
+
+PG_TARGET("avx2")
+inline void deinterleaveAVX2(const unsigned char *rgb, size_t pixels, unsigned char *r, unsigned char *g,
+                             unsigned char *b) {
+    PG_DEINTERLEAVE_BODY(_mm256, __m256i, si256, 32)
+}
+
+PG_TARGET("avx512f,avx512bw")
+inline void deinterleaveAVX512(const unsigned char *rgb, size_t pixels, unsigned char *r, unsigned char *g,
+                               unsigned char *b) {
+    PG_DEINTERLEAVE_BODY(_mm512, __m512i, si512, 64)
+}
+
+PG_TARGET("ssse3")
+inline void interleaveSSSE3(const unsigned char *r, const unsigned char *g, const unsigned char *b,
+                            size_t pixels, unsigned char *rgb) {
+    PG_INTERLEAVE_BODY(_mm, __m128i, si128, 16)
+}
+
+PG_TARGET("avx2")
+inline void interleaveAVX2(const unsigned char *r, const unsigned char *g, const unsigned char *b,
+                           size_t pixels, unsigned char *rgb) {
+    PG_INTERLEAVE_BODY(_mm256, __m256i, si256, 32)
+}
+
+PG_TARGET("avx512f,avx512bw")
+inline void interleaveAVX512(const unsigned char *r, const unsigned char *g, const unsigned char *b,
+                             size_t pixels, unsigned char *rgb) {
+    PG_INTERLEAVE_BODY(_mm512, __m512i, si512, 64)
+}
+
+PG_TARGET("ssse3")
+inline void bitwisePlaneSSSE3(unsigned char *p, size_t n, unsigned char andMask, unsigned char xorMask) {
+    PG_BITWISE_BODY(_mm, __m128i, si128, 16)
+}
+
+PG_TARGET("avx2")
+inline void bitwisePlaneAVX2(unsigned char *p, size_t n, unsigned char andMask, unsigned char xorMask) {
+    PG_BITWISE_BODY(_mm256, __m256i, si256, 32)
+}
+
+PG_TARGET("avx512f,avx512bw")
+inline void bitwisePlaneAVX512(unsigned char *p, size_t n, unsigned char andMask, unsigned char xorMask) {
+    PG_BITWISE_BODY(_mm512, __m512i, si512, 64)
+}
+
+#undef PG_DEINTERLEAVE_BODY
+#undef PG_INTERLEAVE_BODY
+#undef PG_BITWISE_BODY
+
+#endif /* PG_SIMD_X86 */
+
+typedef void (*DeinterleaveKernel)(const unsigned char *rgb, size_t pixels, unsigned char *r, unsigned char *g,
+                                   unsigned char *b);
+typedef void (*InterleaveKernel)(const unsigned char *r, const unsigned char *g, const unsigned char *b,
+                                 size_t pixels, unsigned char *rgb);
+typedef void (*BitwiseKernel)(unsigned char *p, size_t n, unsigned char andMask, unsigned char xorMask);
+
+inline DeinterleaveKernel deinterleaveKernelFor(SimdLevel level) {
+#if PG_SIMD_X86
+    switch (level) {
+        case SIMD_AVX512: return deinterleaveAVX512;
+        case SIMD_AVX2:   return deinterleaveAVX2;
+        case SIMD_SSSE3:  return deinterleaveSSSE3;
+        default:          break;
+    }
+#else
+    (void)level;
+#endif
+    return deinterleaveScalar;
+}
+
+inline InterleaveKernel interleaveKernelFor(SimdLevel level) {
+#if PG_SIMD_X86
+    switch (level) {
+        case SIMD_AVX512: return interleaveAVX512;
+        case SIMD_AVX2:   return interleaveAVX2;
+        case SIMD_SSSE3:  return interleaveSSSE3;
+        default:          break;
+    }
+#else
+    (void)level;
+#endif
+    return interleaveScalar;
+}
+
+inline BitwiseKernel bitwiseKernelFor(SimdLevel level) {
+#if PG_SIMD_X86
+    switch (level) {
+        case SIMD_AVX512: return bitwisePlaneAVX512;
+        case SIMD_AVX2:   return bitwisePlaneAVX2;
+        case SIMD_SSSE3:  return bitwisePlaneSSSE3;
+        default:          break;
+    }
+#else
+    (void)level;
+#endif
+    return bitwisePlaneScalar;
+}
+
+inline void deinterleaveRgb(const unsigned char *rgb, size_t pixels, unsigned char *r, unsigned char *g,
+                            unsigned char *b) {
+    static const DeinterleaveKernel kernel = deinterleaveKernelFor(activeSimdLevel());
+    kernel(rgb, pixels, r, g, b);
+}
+
+inline void interleaveRgb(const unsigned char *r, const unsigned char *g, const unsigned char *b, size_t pixels,
+                          unsigned char *rgb) {
+    static const InterleaveKernel kernel = interleaveKernelFor(activeSimdLevel());
+    kernel(r, g, b, pixels, rgb);
+}
+
+inline void bitwisePlane(unsigned char *p, size_t n, unsigned char andMask, unsigned char xorMask) {
+    static const BitwiseKernel kernel = bitwiseKernelFor(activeSimdLevel());
+    kernel(p, n, andMask, xorMask);
+}
+
+class PlanarImage {
+public:
+    static const size_t ALIGN = 64;
+
+    PlanarImage() {}
+    PlanarImage(int w, int h, int channels = 3) { resize(w, h, channels); }
+
+    // channels: 3 (RGB) ou 4 (RGBA; o alfa começa em 255).
+    void resize(int w, int h, int channels = 3) {
+        width = w;
+        height = h;
+        this->channels = channels;
+        size_t pixels = (size_t)w * h;
+        planeStride = (pixels + ALIGN - 1) / ALIGN * ALIGN;
+        storage.assign(planeStride * channels + ALIGN, 0);
+        size_t misalign = (uintptr_t)storage.data() % ALIGN;
+        offset = misalign ? ALIGN - misalign : 0;
+        if (channels == 4) memset(plane(3), 255, pixels);
+    }
+
+    int getWidth() const { return width; }
+    int getHeight() const { return height; }
+    int getChannels() const { return channels; }
+    size_t pixels() const { return (size_t)width * height; }
+
+    unsigned char *plane(int c) { return storage.data() + offset + planeStride * c; }
+    const unsigned char *plane(int c) const { return storage.data() + offset + planeStride * c; }
+
+    // RGB intercalado -> planos (redimensiona), em faixas de linhas.
+    void fromInterleaved(const unsigned char *rgb, int w, int h, int channels = 3) {
+        resize(w, h, channels);
+        unsigned char *r = plane(0), *g = plane(1), *b = plane(2);
+        parallelRows(w, h, 3, [&](int y0, int y1) {
+            size_t first = (size_t)y0 * w;
+            deinterleaveRgb(rgb + first * 3, (size_t)(y1 - y0) * w, r + first, g + first, b + first);
+        });
+    }
+
+    // Planos R, G, B -> RGB intercalado (o alfa, se houver, fica de fora).
+    void toInterleaved(unsigned char *rgb) const {
+        const unsigned char *r = plane(0), *g = plane(1), *b = plane(2);
+        int w = width;
+        parallelRows(w, height, 3, [&](int y0, int y1) {
+            size_t first = (size_t)y0 * w;
+            interleaveRgb(r + first, g + first, b + first, (size_t)(y1 - y0) * w, rgb + first * 3);
+        });
+    }
+
+private:
+    int width = 0, height = 0, channels = 3;
+    size_t planeStride = 0; // bytes entre planos, múltiplo de ALIGN
+    size_t offset = 0;      // do início de storage ao primeiro byte alinhado
+    vector<unsigned char> storage;
+};
+
+#endif /* PlanarImage_h */
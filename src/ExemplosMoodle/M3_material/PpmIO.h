@@ -0,0 +1,579 @@
+//
+//  PpmIO.h
+//  Leitura de imagens PPM (P3/P6) usadas pelo exemplo_03.
+//
+//  O caminho binário (P6) mapeia o arquivo em memória e entrega aos filtros
+//  um ponteiro direto para os pixels mapeados, sem cópia. Com copy-on-write
+//  os filtros podem alterar os pixels in-place sem tocar no arquivo original.
+//
+//  O caminho texto (P3) lê o arquivo inteiro de uma vez e converte os números
+//  com from_chars, opcionalmente dividindo o texto entre várias threads.
+//
+//  loadPPM copia a imagem para um ImageBuffer (de um ImagePool): é o que o
+//  lote usa, já que escrever num mapeamento copy-on-write custa um page
+//  fault por página a cada quadro.
+//
+//  A escrita monta o texto P3 em blocos grandes, ou grava o P6 com uma única
+//  chamada de sistema, em vez de um << por amostra.
+//
+
+#ifndef PpmIO_h
+#define PpmIO_h
+
+#include <charconv>
+#include <fstream>
+#include <iostream>
+#include <string>
+#include <stdio.h>
+#include <thread>
+#include <utility>
+#include <vector>
+#include <stddef.h>
+#include <string.h>
+#include <errno.h>
+
+#include "ImageBuffer.h"
+
+#ifdef _WIN32
+#ifndef WIN32_LEAN_AND_MEAN
+#define WIN32_LEAN_AND_MEAN
+#endif
+#ifndef NOMINMAX
+#define NOMINMAX
+#endif
+#include <windows.h>
+#else
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <sys/uio.h>
+#include <unistd.h>
+#endif
+
+using namespace std;
+
+struct PPMHeader {
+    char type = 0;          // '3' (texto) ou '6' (binário)
+    int width = 0;
+    int height = 0;
+    int maxValue = 0;
+    size_t dataOffset = 0;  // primeiro byte depois do cabeçalho
+};
+
+// Maior maxValue do formato; acima disso v * 255 transbordaria em
+// parseP3Values.
+static const int PPM_MAX_VALUE = 65535;
+
+// Lê o próximo inteiro do cabeçalho, pulando espaços e comentários (# até o fim da linha).
+inline bool readHeaderInt(const char *buf, size_t len, size_t &pos, int &value) {
+    while (pos < len) {
+        char c = buf[pos];
+        if (c == '#') {
+            while (pos < len && buf[pos] != '\n') pos++;
+        } else if (c == ' ' || c == '\t' || c == '\n' || c == '\r') {
+            pos++;
+        } else {
+            break;
+        }
+    }
+    if (pos >= len || buf[pos] < '0' || buf[pos] > '9') return false;
+    long v = 0;
+    while (pos < len && buf[pos] >= '0' && buf[pos] <= '9') {
+        v = v * 10 + (buf[pos] - '0');
+        if (v > 0x7fffffff) return false;
+        pos++;
+    }
+    value = (int)v;
+    return true;
+}
+
+inline bool parseHeader(const char *buf, size_t len, PPMHeader &hdr) {
+    if (len < 2 || buf[0] != 'P' || (buf[1] != '3' && buf[1] != '6')) return false;
+    hdr.type = buf[1];
+    size_t pos = 2;
+    if (!readHeaderInt(buf, len, pos, hdr.width)) return false;
+    if (!readHeaderInt(buf, len, pos, hdr.height)) return false;
+    if (!readHeaderInt(buf, len, pos, hdr.maxValue)) return false;
+    if (hdr.width <= 0 || hdr.height <= 0 || hdr.maxValue <= 0 || hdr.maxValue > PPM_MAX_VALUE) return false;
+    // exatamente um caractere de espaço separa o maxValue dos dados
+    if (pos >= len) return false;
+    hdr.dataOffset = pos + 1;
+    return true;
+}
+
+// Arquivo mapeado em memória. Somente leitura (compartilhado) ou copy-on-write
+// (privado): no segundo caso as escritas ficam só na memória do processo.
+class MappedFile {
+public:
+    MappedFile() {}
+    ~MappedFile() { close(); }
+
+    MappedFile(const MappedFile &) = delete;
+    MappedFile &operator=(const MappedFile &) = delete;
+
+    MappedFile(MappedFile &&other) noexcept { swap(other); }
+    MappedFile &operator=(MappedFile &&other) noexcept {
+        if (this != &other) {
+            close();
+            swap(other);
+        }
+        return *this;
+    }
+
+    bool open(const string &path, bool copyOnWrite) {
+        close();
+#ifdef _WIN32
+        file = CreateFileA(path.c_str(), GENERIC_READ, FILE_SHARE_READ, NULL,
+                           OPEN_EXISTING, FILE_FLAG_SEQUENTIAL_SCAN, NULL);
+        if (file == INVALID_HANDLE_VALUE) return false;
+        LARGE_INTEGER fileSize;
+        if (!GetFileSizeEx(file, &fileSize) || fileSize.QuadPart == 0) {
+            close();
+            return false;
+        }
+        mapping = CreateFileMappingA(file, NULL, copyOnWrite ? PAGE_WRITECOPY : PAGE_READONLY, 0, 0, NULL);
+        if (mapping == NULL) {
+            close();
+            return false;
+        }
+        ptr = (unsigned char *)MapViewOfFile(mapping, copyOnWrite ? FILE_MAP_COPY : FILE_MAP_READ, 0, 0, 0);
+        if (ptr == NULL) {
+            close();
+            return false;
+        }
+        length = (size_t)fileSize.QuadPart;
+#else
+        int fd = ::open(path.c_str(), O_RDONLY);
+        if (fd < 0) return false;
+        struct stat st;
+        if (fstat(fd, &st) != 0 || st.st_size == 0) {
+            ::close(fd);
+            return false;
+        }
+        int prot = copyOnWrite ? (PROT_READ | PROT_WRITE) : PROT_READ;
+        int flags = copyOnWrite ? MAP_PRIVATE : MAP_SHARED;
+        void *p = mmap(NULL, (size_t)st.st_size, prot, flags, fd, 0);
+        ::close(fd); // o mapeamento continua válido depois de fechar o descritor
+        if (p == MAP_FAILED) return false;
+        ptr = (unsigned char *)p;
+        length = (size_t)st.st_size;
+        // os filtros percorrem a imagem do início ao fim
+        madvise(ptr, length, MADV_SEQUENTIAL);
+        madvise(ptr, length, MADV_WILLNEED);
+#endif
+        return true;
+    }
+
+    void close() {
+#ifdef _WIN32
+        if (ptr) UnmapViewOfFile(ptr);
+        if (mapping) CloseHandle(mapping);
+        if (file != INVALID_HANDLE_VALUE) CloseHandle(file);
+        mapping = NULL;
+        file = INVALID_HANDLE_VALUE;
+#else
+        if (ptr) munmap(ptr, length);
+#endif
+        ptr = nullptr;
+        length = 0;
+    }
+
+    unsigned char *data() const { return ptr; }
+    size_t size() const { return length; }
+
+private:
+    void swap(MappedFile &other) {
+        std::swap(ptr, other.ptr);
+        std::swap(length, other.length);
+#ifdef _WIN32
+        std::swap(file, other.file);
+        std::swap(mapping, other.mapping);
+#endif
+    }
+
+    unsigned char *ptr = nullptr;
+    size_t length = 0;
+#ifdef _WIN32
+    HANDLE file = INVALID_HANDLE_VALUE;
+    HANDLE mapping = NULL;
+#endif
+};
+
+// Imagem P6 mapeada: pixels aponta para dentro do mapeamento (RGB intercalado).
+struct MappedImage {
+    MappedFile file;
+    PPMHeader header;
+    unsigned char *pixels = nullptr;
+    int width = 0;
+    int height = 0;
+};
+
+// P6 com maxValue < 255: leva as amostras para 0..255 como parseP3Values
+// (arredondado, acima de maxValue satura), por uma tabela de 256 entradas.
+inline void rescaleP6Samples(unsigned char *p, size_t count, int maxValue) {
+    if (maxValue == 255) return;
+    unsigned char lut[256];
+    for (unsigned int v = 0; v < 256; v++) {
+        unsigned int c = v > (unsigned int)maxValue ? maxValue : v;
+        lut[v] = (unsigned char)((c * 255 + maxValue / 2) / maxValue);
+    }
+    for (size_t i = 0; i < count; i++) p[i] = lut[p[i]];
+}
+
+// Mapeia um P6 de 8 bits. Retorna false (sem mensagem) se o arquivo não for P6,
+// para que o chamador possa cair no leitor de texto. Com maxValue < 255 as
+// amostras são reescaladas nas páginas copy-on-write (o arquivo não muda);
+// sem copy-on-write esse caso é recusado.
+inline bool openMapped(const string &path, MappedImage &img, bool copyOnWrite = true) {
+    img.pixels = nullptr;
+    if (!img.file.open(path, copyOnWrite)) return false;
+    const char *buf = (const char *)img.file.data();
+    size_t len = img.file.size();
+    if (!parseHeader(buf, len, img.header) || img.header.type != '6') {
+        img.file.close();
+        return false;
+    }
+    if (img.header.maxValue > 255) {
+        cerr << "P6 com " << img.header.maxValue << " níveis (16 bits) não suportado: " << path << endl;
+        img.file.close();
+        return false;
+    }
+    size_t needed = (size_t)img.header.width * img.header.height * 3;
+    if (len < img.header.dataOffset || len - img.header.dataOffset < needed) {
+        cerr << "P6 truncado: " << path << endl;
+        img.file.close();
+        return false;
+    }
+    if (img.header.maxValue < 255 && !copyOnWrite) {
+        cerr << "P6 com " << img.header.maxValue << " níveis precisa ser reescalado (mapeamento só leitura): " << path << endl;
+        img.file.close();
+        return false;
+    }
+    img.width = img.header.width;
+    img.height = img.header.height;
+    img.pixels = img.file.data() + img.header.dataOffset;
+    rescaleP6Samples(img.pixels, needed, img.header.maxValue);
+    return true;
+}
+
+inline bool readWholeFile(const string &path, vector<char> &buf) {
+    ifstream arq(path, ios::binary | ios::ate);
+    if (!arq) return false;
+    streamsize len = arq.tellg();
+    if (len <= 0) return false;
+    buf.resize((size_t)len);
+    arq.seekg(0);
+    return (bool)arq.read(buf.data(), len);
+}
+
+inline bool isPPMSpace(char c) {
+    return c == ' ' || c == '\n' || c == '\r' || c == '\t' || c == '\v' || c == '\f';
+}
+
+// Conta os números em [p, end) sem convertê-los (transições espaço -> não-espaço).
+inline size_t countP3Values(const char *p, const char *end) {
+    size_t n = 0;
+    bool inToken = false;
+    for (; p < end; p++) {
+        bool sp = isPPMSpace(*p);
+        n += (!sp && !inToken);
+        inToken = !sp;
+    }
+    return n;
+}
+
+// Converte até limit números de [p, end) para dst. Retorna quantos foram lidos
+// ou -1 se encontrar algo que não seja número; stop (opcional) recebe onde parou.
+inline long parseP3Values(const char *p, const char *end, unsigned char *dst, size_t limit, int maxValue,
+                          const char **stop = nullptr) {
+    size_t n = 0;
+    while (n < limit) {
+        while (p < end && isPPMSpace(*p)) p++;
+        if (p >= end) break;
+        unsigned int v;
+        from_chars_result r = from_chars(p, end, v);
+        if (r.ec != errc() || (r.ptr < end && !isPPMSpace(*r.ptr))) return -1;
+        p = r.ptr;
+        if (v > (unsigned int)maxValue) v = maxValue;
+        dst[n++] = (maxValue == 255) ? (unsigned char)v : (unsigned char)((v * 255 + maxValue / 2) / maxValue);
+    }
+    if (stop) *stop = p;
+    return (long)n;
+}
+
+// Converte o raster P3 inteiro. Com mais de uma thread o texto é cortado em
+// blocos nos limites de espaço; cada bloco conta seus números, um prefixo dá
+// a posição de saída e então cada bloco converte direto para o destino.
+inline bool parseP3Raster(const char *begin, const char *end, unsigned char *dst, size_t count,
+                          int maxValue, unsigned int threads) {
+    const size_t minChunk = 1 << 20; // abaixo disso não compensa criar threads
+    size_t len = (size_t)(end - begin);
+    if (threads > len / minChunk) threads = (unsigned int)(len / minChunk);
+    if (threads <= 1) {
+        return parseP3Values(begin, end, dst, count, maxValue) == (long)count;
+    }
+
+    vector<const char *> cuts(threads + 1);
+    cuts[0] = begin;
+    cuts[threads] = end;
+    for (unsigned int i = 1; i < threads; i++) {
+        const char *c = begin + len / threads * i;
+        if (c < cuts[i - 1]) c = cuts[i - 1];
+        while (c < end && !isPPMSpace(*c)) c++;
+        cuts[i] = c;
+    }
+
+    vector<size_t> counts(threads);
+    vector<thread> pool;
+    for (unsigned int i = 0; i < threads; i++) {
+        pool.emplace_back([&, i]() { counts[i] = countP3Values(cuts[i], cuts[i + 1]); });
+    }
+    for (thread &t : pool) t.join();
+    pool.clear();
+
+    vector<size_t> offsets(threads);
+    size_t total = 0;
+    for (unsigned int i = 0; i < threads; i++) {
+        offsets[i] = total;
+        total += counts[i];
+    }
+    if (total < count) return false;
+
+    vector<char> ok(threads, 1);
+    for (unsigned int i = 0; i < threads; i++) {
+        if (offsets[i] >= count) break;
+        size_t limit = counts[i] < count - offsets[i] ? counts[i] : count - offsets[i];
+        pool.emplace_back([&, i, limit]() {
+            ok[i] = parseP3Values(cuts[i], cuts[i + 1], dst + offsets[i], limit, maxValue) == (long)limit;
+        });
+    }
+    for (thread &t : pool) t.join();
+    for (char o : ok) {
+        if (!o) return false;
+    }
+    return true;
+}
+
+// Carrega um P3 ou P6 inteiro em img (RGB intercalado, linhas compactas),
+// com o bloco vindo de pool (nullptr = alocação própria). No P6 só o
+// cabeçalho passa por um buffer intermediário: os pixels são lidos direto
+// para img.
+inline bool loadPPM(const string &path, ImageBuffer &img, unsigned int threads = thread::hardware_concurrency(),
+                    ImagePool *pool = &ImagePool::shared()) {
+    ifstream arq(path, ios::binary | ios::ate);
+    streamsize len = arq ? (streamsize)arq.tellg() : -1;
+    if (len <= 0) {
+        cerr << "Não foi possível ler " << path << endl;
+        return false;
+    }
+    arq.seekg(0);
+    char head[4096];
+    size_t got = (size_t)(len < (streamsize)sizeof(head) ? len : (streamsize)sizeof(head));
+    PPMHeader hdr;
+    if (arq.read(head, (streamsize)got) && parseHeader(head, got, hdr) && hdr.type == '6') {
+        size_t count = (size_t)hdr.width * hdr.height * 3;
+        if (hdr.maxValue > 255 || (size_t)len < hdr.dataOffset || (size_t)len - hdr.dataOffset < count) {
+            cerr << "Dados de pixel inválidos ou incompletos: " << path << endl;
+            return false;
+        }
+        img.allocate(hdr.width, hdr.height, 3, 1, pool);
+        size_t inHead = got - hdr.dataOffset < count ? got - hdr.dataOffset : count;
+        memcpy(img.data(), head + hdr.dataOffset, inHead);
+        if (inHead < count && !arq.read((char *)img.data() + inHead, (streamsize)(count - inHead))) {
+            cerr << "Erro ao ler " << path << endl;
+            return false;
+        }
+        rescaleP6Samples(img.data(), count, hdr.maxValue);
+        return true;
+    }
+
+    // P3 (ou cabeçalho maior que head): o texto inteiro de uma vez
+    vector<char> buf;
+    if (!readWholeFile(path, buf)) {
+        cerr << "Não foi possível ler " << path << endl;
+        return false;
+    }
+    if (!parseHeader(buf.data(), buf.size(), hdr)) {
+        cerr << "Cabeçalho PPM inválido: " << path << endl;
+        return false;
+    }
+    size_t count = (size_t)hdr.width * hdr.height * 3;
+    const char *begin = buf.data() + hdr.dataOffset;
+    const char *end = buf.data() + buf.size();
+    img.allocate(hdr.width, hdr.height, 3, 1, pool);
+    bool ok;
+    if (hdr.type == '3') {
+        ok = parseP3Raster(begin, end, img.data(), count, hdr.maxValue, threads);
+    } else {
+        ok = hdr.maxValue <= 255 && begin <= end && (size_t)(end - begin) >= count;
+        if (ok) {
+            memcpy(img.data(), begin, count);
+            rescaleP6Samples(img.data(), count, hdr.maxValue);
+        }
+    }
+    if (!ok) {
+        cerr << "Dados de pixel inválidos ou incompletos: " << path << endl;
+        img.release();
+        return false;
+    }
+    return true;
+}
+
+// Arquivo de saída sem buffer próprio: cada write vai direto para o sistema.
+class RawOutFile {
+public:
+    RawOutFile() {}
+    ~RawOutFile() { close(); }
+
+    RawOutFile(const RawOutFile &) = delete;
+    RawOutFile &operator=(const RawOutFile &) = delete;
+
+    bool open(const string &path) {
+        close();
+#ifdef _WIN32
+        fp = fopen(path.c_str(), "wb");
+        if (!fp) return false;
+        setvbuf(fp, NULL, _IONBF, 0);
+        return true;
+#else
+        fd = ::open(path.c_str(), O_WRONLY | O_CREAT | O_TRUNC, 0644);
+        return fd >= 0;
+#endif
+    }
+
+    // Grava os dois blocos em sequência (writev quando disponível).
+    bool write(const void *a, size_t alen, const void *b = nullptr, size_t blen = 0) {
+#ifdef _WIN32
+        return fwrite(a, 1, alen, fp) == alen && (blen == 0 || fwrite(b, 1, blen, fp) == blen);
+#else
+        struct iovec iov[2];
+        iov[0].iov_base = (void *)a;
+        iov[0].iov_len = alen;
+        iov[1].iov_base = (void *)b;
+        iov[1].iov_len = blen;
+        int first = 0;
+        while (first < 2) {
+            ssize_t n = writev(fd, iov + first, 2 - first);
+            if (n < 0) {
+                if (errno == EINTR) continue;
+                return false;
+            }
+            // escrita parcial: avança sobre o que já foi gravado
+            while (first < 2 && (size_t)n >= iov[first].iov_len) {
+                n -= iov[first].iov_len;
+                first++;
+            }
+            if (first < 2) {
+                iov[first].iov_base = (char *)iov[first].iov_base + n;
+                iov[first].iov_len -= n;
+            }
+        }
+        return true;
+#endif
+    }
+
+    bool close() {
+        bool ok = true;
+#ifdef _WIN32
+        if (fp) ok = fclose(fp) == 0;
+        fp = nullptr;
+#else
+        if (fd >= 0) ok = ::close(fd) == 0;
+        fd = -1;
+#endif
+        return ok;
+    }
+
+private:
+#ifdef _WIN32
+    FILE *fp = nullptr;
+#else
+    int fd = -1;
+#endif
+};
+
+inline string ppmHeaderText(char type, int w, int h) {
+    return string("P") + type + "\n#Gerado por chroma-key.\n" + to_string(w) + " " + to_string(h) + "\n255\n";
+}
+
+// Formata amostras P3 em out; 5 pixels por linha (no máximo 60 caracteres,
+// dentro do limite de 70 do formato). Retorna o número de bytes escritos;
+// out precisa de 4 bytes por amostra.
+inline size_t formatP3(const unsigned char *data, size_t count, char *out) {
+    static const struct Digits {
+        char text[256][4];
+        unsigned char len[256];
+        Digits() {
+            for (int v = 0; v < 256; v++) {
+                len[v] = (unsigned char)snprintf(text[v], 4, "%d", v);
+            }
+        }
+    } digits;
+    char *o = out;
+    for (size_t i = 0; i < count; i++) {
+        unsigned char v = data[i];
+        memcpy(o, digits.text[v], 3);
+        o += digits.len[v];
+        *o++ = (i % 15 == 14 || i + 1 == count) ? '\n' : ' ';
+    }
+    return (size_t)(o - out);
+}
+
+// Grava amostras de 8 bits: 3 canais (P6/P3) ou 1 canal (P5/P2).
+inline bool savePNM(const string &path, const unsigned char *data, int w, int h, int channels, bool binary) {
+    RawOutFile out;
+    if (!out.open(path)) {
+        cerr << "Não foi possível criar " << path << endl;
+        return false;
+    }
+    char type = channels == 1 ? (binary ? '5' : '2') : (binary ? '6' : '3');
+    string header = ppmHeaderText(type, w, h);
+    size_t count = (size_t)w * h * channels;
+    bool ok;
+    if (binary) {
+        ok = out.write(header.data(), header.size(), data, count);
+    } else {
+        // blocos múltiplos de 15 amostras para manter as linhas inteiras
+        const size_t chunkSamples = 15 * 64 * 1024;
+        vector<char> buf(chunkSamples * 4);
+        ok = out.write(header.data(), header.size());
+        for (size_t i = 0; ok && i < count; i += chunkSamples) {
+            size_t n = count - i < chunkSamples ? count - i : chunkSamples;
+            ok = out.write(buf.data(), formatP3(data + i, n, buf.data()));
+        }
+    }
+    ok = out.close() && ok;
+    if (!ok) {
+        cerr << "Erro ao gravar " << path << endl;
+    }
+    return ok;
+}
+
+// Grava RGB intercalado como P6 (binary) ou P3.
+inline bool savePPM(const string &path, const unsigned char *data, int w, int h, bool binary = true) {
+    return savePNM(path, data, w, h, 3, binary);
+}
+
+// Grava um canal (por exemplo a máscara do chroma-key) como P5.
+inline bool savePGM(const string &path, const unsigned char *data, int w, int h) {
+    return savePNM(path, data, w, h, 1, true);
+}
+
+// Grava RGBA intercalado como PAM (P7, TUPLTYPE RGB_ALPHA), que guarda o alfa.
+inline bool savePAM(const string &path, const unsigned char *data, int w, int h) {
+    RawOutFile out;
+    if (!out.open(path)) {
+        cerr << "Não foi possível criar " << path << endl;
+        return false;
+    }
+    string header = "P7\nWIDTH " + to_string(w) + "\nHEIGHT " + to_string(h)
+                    + "\nDEPTH 4\nMAXVAL 255\nTUPLTYPE RGB_ALPHA\nENDHDR\n";
+    bool ok = out.write(header.data(), header.size(), data, (size_t)w * h * 4);
+    ok = out.close() && ok;
+    if (!ok) {
+        cerr << "Erro ao gravar " << path << endl;
+    }
+    return ok;
+}
+
+#endif /* PpmIO_h */
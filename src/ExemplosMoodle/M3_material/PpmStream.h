@@ -0,0 +1,262 @@
+//
+//  PpmStream.h
+//  Processamento em faixas para imagens maiores que a memória.
+//
+//  A imagem é lida uma faixa de linhas por vez, filtrada e gravada, enquanto
+//  a faixa seguinte já está sendo lida por uma thread de leitura que dura o
+//  arquivo inteiro; as duas faixas vão e voltam entre ela e a de filtros
+//  por filas (Pipeline.h). A memória usada é
+//  O(largura x altura da faixa) e não depende da altura da imagem. Só serve
+//  para filtros pontuais: cadeias com autolevels/equalize, que precisam do
+//  histograma da imagem inteira antes de gravar o primeiro pixel, e com
+//  blur/boxblur, que leem linhas vizinhas de outras faixas, são recusadas.
+//
+
+#ifndef PpmStream_h
+#define PpmStream_h
+
+#include <atomic>
+#include <string>
+#include <thread>
+#include <vector>
+#include <stdio.h>
+
+#include "PpmIO.h"
+#include "FilterChain.h"
+#include "Pipeline.h"
+
+using namespace std;
+
+// Leitor sequencial de P3/P6 que entrega linhas sob demanda.
+class PPMBandReader {
+public:
+    PPMBandReader() {}
+    ~PPMBandReader() { close(); }
+
+    PPMBandReader(const PPMBandReader &) = delete;
+    PPMBandReader &operator=(const PPMBandReader &) = delete;
+
+    bool open(const string &path) {
+        close();
+        fp = fopen(path.c_str(), "rb");
+        if (!fp) {
+            cerr << "Não foi possível ler " << path << endl;
+            return false;
+        }
+        if (!readHeader()) {
+            cerr << "Cabeçalho PPM inválido: " << path << endl;
+            close();
+            return false;
+        }
+        if (hdr.type == '6' && hdr.maxValue > 255) {
+            cerr << "P6 com " << hdr.maxValue << " níveis (16 bits) não suportado: " << path << endl;
+            close();
+            return false;
+        }
+        return true;
+    }
+
+    void close() {
+        if (fp) fclose(fp);
+        fp = nullptr;
+        hdr = PPMHeader();
+        text.clear();
+        pos = 0;
+        eof = false;
+    }
+
+    const PPMHeader &header() const { return hdr; }
+
+    // Lê as próximas rows linhas (RGB intercalado) para dst, em 0..255
+    // qualquer que seja o maxValue.
+    bool readRows(unsigned char *dst, int rows) {
+        size_t count = (size_t)rows * hdr.width * 3;
+        if (hdr.type == '6') {
+            if (fread(dst, 1, count, fp) != count) return false;
+            rescaleP6Samples(dst, count, hdr.maxValue);
+            return true;
+        }
+        return readTextValues(dst, count);
+    }
+
+private:
+    // Cabeçalho lido byte a byte: ele é pequeno e o resto do arquivo fica
+    // posicionado exatamente no primeiro byte do raster.
+    bool readHeaderInt(int &value) {
+        int c = getc(fp);
+        for (;;) {
+            if (c == '#') {
+                while (c != '\n' && c != EOF) c = getc(fp);
+            } else if (c == ' ' || c == '\t' || c == '\n' || c == '\r') {
+                c = getc(fp);
+            } else {
+                break;
+            }
+        }
+        if (c < '0' || c > '9') return false;
+        long v = 0;
+        while (c >= '0' && c <= '9') {
+            v = v * 10 + (c - '0');
+            if (v > 0x7fffffff) return false;
+            c = getc(fp);
+        }
+        value = (int)v;
+        // c é o caractere de espaço que encerra o número e já foi consumido
+        return c != EOF;
+    }
+
+    bool readHeader() {
+        int p = getc(fp), t = getc(fp);
+        if (p != 'P' || (t != '3' && t != '6')) return false;
+        hdr.type = (char)t;
+        if (!readHeaderInt(hdr.width) || !readHeaderInt(hdr.height) || !readHeaderInt(hdr.maxValue)) return false;
+        return hdr.width > 0 && hdr.height > 0 && hdr.maxValue > 0 && hdr.maxValue <= PPM_MAX_VALUE;
+    }
+
+    // P3: o texto é lido em blocos de 1 MiB; só é convertido até o último
+    // espaço do bloco, para nenhum número ficar cortado entre dois blocos.
+    bool readTextValues(unsigned char *dst, size_t count) {
+        const size_t chunk = 1 << 20;
+        size_t got = 0;
+        while (got < count) {
+            size_t avail = text.size() - pos;
+            const char *begin = text.data() + pos;
+            const char *end = begin + avail;
+            const char *cut = end;
+            if (!eof) {
+                while (cut > begin && !isPPMSpace(cut[-1])) cut--;
+            }
+            const char *stop = begin;
+            long n = parseP3Values(begin, cut, dst + got, count - got, hdr.maxValue, &stop);
+            if (n < 0) return false;
+            got += (size_t)n;
+            pos += (size_t)(stop - begin);
+            if (got == count) break;
+            if (eof) return false;
+            // descarta o que já foi usado e completa o bloco
+            text.erase(text.begin(), text.begin() + pos);
+            pos = 0;
+            size_t old = text.size();
+            text.resize(old + chunk);
+            size_t r = fread(text.data() + old, 1, chunk, fp);
+            text.resize(old + r);
+            if (r < chunk) eof = true;
+        }
+        return true;
+    }
+
+    FILE *fp = nullptr;
+    PPMHeader hdr;
+    vector<char> text;
+    size_t pos = 0;
+    bool eof = false;
+};
+
+// Gravador sequencial: cabeçalho na abertura, depois linhas em ordem.
+class PNMBandWriter {
+public:
+    bool open(const string &path, int w, int h, int channels, bool binary) {
+        width = w;
+        this->channels = channels;
+        this->binary = binary;
+        if (!out.open(path)) {
+            cerr << "Não foi possível criar " << path << endl;
+            return false;
+        }
+        char type = channels == 1 ? (binary ? '5' : '2') : (binary ? '6' : '3');
+        string header = ppmHeaderText(type, w, h);
+        return out.write(header.data(), header.size());
+    }
+
+    bool writeRows(const unsigned char *data, int rows) {
+        size_t count = (size_t)rows * width * channels;
+        if (binary) return out.write(data, count);
+        text.resize(count * 4);
+        return out.write(text.data(), formatP3(data, count, text.data()));
+    }
+
+    bool close() { return out.close(); }
+
+private:
+    RawOutFile out;
+    vector<char> text;
+    int width = 0;
+    int channels = 3;
+    bool binary = true;
+};
+
+// Filtra input -> output em faixas de bandRows linhas, lendo a faixa seguinte
+// enquanto a atual é filtrada e gravada. maskPath vazio = sem máscara.
+inline bool streamFilter(const string &input, const string &output, const FilterChain &chain,
+                         int bandRows, bool binary, const string &maskPath = "",
+                         int *width = nullptr, int *height = nullptr) {
+    if (chain.needsWholeImage()) {
+        cerr << "autolevels, equalize e blur não funcionam em faixas: " << input << endl;
+        return false;
+    }
+    PPMBandReader reader;
+    if (!reader.open(input)) return false;
+    int w = reader.header().width;
+    int h = reader.header().height;
+    if (width) *width = w;
+    if (height) *height = h;
+    if (bandRows <= 0) bandRows = 1;
+    if (bandRows > h) bandRows = h;
+
+    PNMBandWriter writer, maskWriter;
+    if (!writer.open(output, w, h, 3, binary)) return false;
+    bool withMask = !maskPath.empty();
+    if (withMask && !maskWriter.open(maskPath, w, h, 1, true)) return false;
+
+    // faixa lida: rows linhas em pixels; ok false se a leitura falhou
+    struct Band {
+        vector<unsigned char> pixels;
+        int rows = 0;
+        bool ok = true;
+    };
+    size_t bandBytes = (size_t)bandRows * w * 3;
+    BoundedQueue<Band> empty(2), full(2);
+    for (int i = 0; i < 2; i++) {
+        Band b;
+        b.pixels.resize(bandBytes);
+        empty.push(std::move(b));
+    }
+    vector<unsigned char> mask(withMask ? (size_t)bandRows * w : 0);
+
+    // uma thread lê as faixas em ordem enquanto esta filtra e grava
+    atomic<bool> stop{false};
+    thread readerThread([&]() {
+        Band b;
+        for (int y = 0; y < h && empty.pop(b) && !stop.load(); y += bandRows) {
+            b.rows = h - y < bandRows ? h - y : bandRows;
+            b.ok = reader.readRows(b.pixels.data(), b.rows);
+            bool ok = b.ok;
+            if (!full.push(std::move(b)) || !ok) break;
+        }
+        full.producerDone();
+    });
+
+    bool ok = true;
+    for (int y = 0; ok && y < h;) {
+        Band b;
+        if (!full.pop(b) || !b.ok) {
+            ok = false;
+            break;
+        }
+        chain.apply(b.pixels.data(), w, b.rows, withMask ? mask.data() : nullptr);
+        ok = writer.writeRows(b.pixels.data(), b.rows);
+        if (ok && withMask) ok = maskWriter.writeRows(mask.data(), b.rows);
+        y += b.rows;
+        empty.push(std::move(b));
+    }
+    // em caso de erro a leitura para na próxima faixa
+    stop.store(true);
+    empty.producerDone();
+    readerThread.join();
+    ok = writer.close() && ok;
+    if (withMask) ok = maskWriter.close() && ok;
+    if (!ok) cerr << "Erro ao processar " << input << " em faixas" << endl;
+    return ok;
+}
+
+#endif /* PpmStream_h */
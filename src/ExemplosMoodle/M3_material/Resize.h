@@ -0,0 +1,328 @@
+//
+//  Resize.h
+//  Redimensionamento separável (caixa, bilinear e Lanczos3) com SIMD e
+//  threads.
+//
+//  Os pesos de cada coluna e de cada linha de saída são calculados uma vez,
+//  em Q14 com soma exata 1 << 14 (como em Blur.h), e o filtro 2D vira duas
+//  passadas: a horizontal gera uma imagem intermediária com a largura nova e
+//  a altura original; a vertical lê essa imagem e gera a altura nova. Na
+//  redução o suporte do filtro cresce com a escala, então todos os pixels de
+//  entrada contribuem (sem serrilhado).
+//
+//  A passada vertical é exatamente a convolução de Blur.h: cada linha de
+//  saída é a soma ponderada de algumas linhas inteiras de entrada. Na
+//  horizontal cada pixel de saída tem seus próprios pesos; a versão SIMD
+//  carrega dois pixels vizinhos de entrada, separa os canais em pares de 16
+//  bits com pshufb e faz um madd por par de pesos.
+//
+
+#ifndef Resize_h
+#define Resize_h
+
+#include <algorithm>
+#include <math.h>
+#include <stddef.h>
+#include <stdint.h>
+#include <string.h>
+#include <string>
+#include <vector>
+
+#include "CpuFeatures.h"
+#include "ThreadPool.h"
+#include "ImageBuffer.h"
+#include "Blur.h"
+
+using namespace std;
+
+enum ResizeFilter {
+    RESIZE_BOX,
+    RESIZE_BILINEAR,
+    RESIZE_LANCZOS3,
+};
+
+inline bool parseResizeFilter(const string &name, ResizeFilter &filter) {
+    if (name == "box" || name == "caixa") {
+        filter = RESIZE_BOX;
+    } else if (name == "bilinear") {
+        filter = RESIZE_BILINEAR;
+    } else if (name == "lanczos3" || name == "lanczos") {
+        filter = RESIZE_LANCZOS3;
+    } else {
+        return false;
+    }
+    return true;
+}
+
+// Meia largura do filtro em pixels de entrada, na escala 1.
+inline double resizeSupport(ResizeFilter filter) {
+    switch (filter) {
+        case RESIZE_BOX:      return 0.5;
+        case RESIZE_BILINEAR: return 1.0;
+        default:              return 3.0;
+    }
+}
+
+inline double resizeKernel(ResizeFilter filter, double x) {
+    switch (filter) {
+        case RESIZE_BOX:
+            return x > -0.5 && x <= 0.5 ? 1.0 : 0.0;
+        case RESIZE_BILINEAR:
+            x = fabs(x);
+            return x < 1.0 ? 1.0 - x : 0.0;
+        default: {
+            x = fabs(x);
+            if (x >= 3.0) return 0.0;
+            if (x < 1e-8) return 1.0;
+            double px = 3.14159265358979323846 * x;
+            return 3.0 * sin(px) * sin(px / 3.0) / (px * px);
+        }
+    }
+}
+
+struct ResizeWeights {
+    int taps = 0;      // pesos por saída, sempre par (os kernels usam pares)
+    vector<int> start; // primeiro índice de entrada de cada saída
+    vector<int16_t> w; // taps pesos por saída em Q14; os que sobram são zero
+};
+
+// Pesos para levar in amostras a out: a saída i fica centrada em
+// (i + 0.5) * in / out e, na redução, o filtro é esticado pela escala.
+inline ResizeWeights resizeWeights(int in, int out, ResizeFilter filter) {
+    ResizeWeights rw;
+    double scale = (double)in / out;
+    double stretch = scale > 1.0 ? scale : 1.0;
+    double support = resizeSupport(filter) * stretch;
+    rw.taps = (int)ceil(support) * 2 + 1;
+    rw.taps += rw.taps & 1;
+    rw.start.resize(out);
+    rw.w.assign((size_t)out * rw.taps, 0);
+    vector<double> real;
+    for (int i = 0; i < out; i++) {
+        double center = (i + 0.5) * scale;
+        int first = max((int)(center - support + 0.5), 0);
+        int last = min((int)(center + support + 0.5), in);
+        real.clear();
+        double sum = 0;
+        for (int x = first; x < last; x++) {
+            real.push_back(resizeKernel(filter, (x - center + 0.5) / stretch));
+            sum += real.back();
+        }
+        int16_t *w = rw.w.data() + (size_t)i * rw.taps;
+        rw.start[i] = first;
+        if (sum <= 0) {
+            // nenhum peso útil (não acontece com os filtros acima): o vizinho mais próximo
+            rw.start[i] = min((int)center, in - 1);
+            w[0] = 1 << BLUR_SHIFT;
+            continue;
+        }
+        BlurWeights q = quantizeWeights(real);
+        copy(q.w.begin(), q.w.begin() + min(q.w.size(), (size_t)rw.taps), w);
+    }
+    return rw;
+}
+
+// Passada horizontal de uma linha: row tem pelo menos (in + taps) pixels
+// legíveis (ver resampleRows), out recebe outWidth pixels.
+inline void resampleRowScalar(const unsigned char *row, unsigned char *out, int outWidth, int channels,
+                              const ResizeWeights &rw) {
+    for (int x = 0; x < outWidth; x++) {
+        const unsigned char *p = row + (size_t)rw.start[x] * channels;
+        const int16_t *w = rw.w.data() + (size_t)x * rw.taps;
+        for (int c = 0; c < channels; c++) {
+            int32_t acc = 1 << (BLUR_SHIFT - 1);
+            for (int k = 0; k < rw.taps; k++) acc += w[k] * p[k * channels + c];
+            acc >>= BLUR_SHIFT;
+            out[(size_t)x * channels + c] = (unsigned char)(acc < 0 ? 0 : (acc > 255 ? 255 : acc));
+        }
+    }
+}
+
+#if PG_SIMD_X86
+
+// Máscara do pshufb: dois pixels vizinhos (8 bytes carregados) viram, em
+// cada canal c, o par de 16 bits (pixel k, pixel k+1), pronto para o madd.
+// Só 3 ou 4 canais: com menos, sobraria registrador sem uso.
+inline void resampleShuffleMask(int channels, unsigned char mask[16]) {
+    for (int c = 0; c < 4; c++) {
+        mask[4 * c] = c < channels ? (unsigned char)c : 0x80;
+        mask[4 * c + 1] = 0x80;
+        mask[4 * c + 2] = c < channels ? (unsigned char)(channels + c) : 0x80;
+        mask[4 * c + 3] = 0x80;
+    }
+}
+
+inline int32_t resamplePair(const int16_t *w, int k) {
+    return (int32_t)((uint32_t)(uint16_t)w[k] | ((uint32_t)(uint16_t)w[k + 1] << 16));
+}
+
+PG_TARGET("ssse3")
+inline __m128i resampleStep(__m128i acc, const unsigned char *p, const int16_t *w, int k, int channels,
+                            __m128i mask) {
+    __m128i v = _mm_shuffle_epi8(_mm_loadl_epi64((const __m128i *)(p + k * channels)), mask);
+    return _mm_add_epi32(acc, _mm_madd_epi16(v, _mm_set1_epi32(resamplePair(w, k))));
+}
+
+PG_TARGET("ssse3")
+inline void resampleStore(__m128i acc, unsigned char *out, int channels) {
+    acc = _mm_srai_epi32(acc, BLUR_SHIFT);
+    acc = _mm_packus_epi16(_mm_packs_epi32(acc, acc), acc);
+    uint32_t px = (uint32_t)_mm_cvtsi128_si32(acc);
+    memcpy(out, &px, channels);
+}
+
+PG_TARGET("ssse3")
+inline void resampleRowSSSE3(const unsigned char *row, unsigned char *out, int outWidth, int channels,
+                             const ResizeWeights &rw) {
+    if (channels != 3 && channels != 4) {
+        resampleRowScalar(row, out, outWidth, channels, rw);
+        return;
+    }
+    unsigned char m[16];
+    resampleShuffleMask(channels, m);
+    const __m128i mask = _mm_loadu_si128((const __m128i *)m);
+    const __m128i half = _mm_set1_epi32(1 << (BLUR_SHIFT - 1));
+    for (int x = 0; x < outWidth; x++) {
+        const unsigned char *p = row + (size_t)rw.start[x] * channels;
+        const int16_t *w = rw.w.data() + (size_t)x * rw.taps;
+        __m128i acc = half;
+        for (int k = 0; k < rw.taps; k += 2) acc = resampleStep(acc, p, w, k, channels, mask);
+        resampleStore(acc, out + (size_t)x * channels, channels);
+    }
+}
+
+// Quatro taps por vez: um par de pixels em cada metade de 128 bits.
+PG_TARGET("avx2")
+inline void resampleRowAVX2(const unsigned char *row, unsigned char *out, int outWidth, int channels,
+                            const ResizeWeights &rw) {
+    if (channels != 3 && channels != 4) {
+        resampleRowScalar(row, out, outWidth, channels, rw);
+        return;
+    }
+    unsigned char m[16];
+    resampleShuffleMask(channels, m);
+    const __m128i mask = _mm_loadu_si128((const __m128i *)m);
+    const __m256i mask2 = _mm256_broadcastsi128_si256(mask);
+    const __m128i half = _mm_set1_epi32(1 << (BLUR_SHIFT - 1));
+    for (int x = 0; x < outWidth; x++) {
+        const unsigned char *p = row + (size_t)rw.start[x] * channels;
+        const int16_t *w = rw.w.data() + (size_t)x * rw.taps;
+        __m256i acc2 = _mm256_setzero_si256();
+        int k = 0;
+        for (; k + 4 <= rw.taps; k += 4) {
+            __m128i lo = _mm_loadl_epi64((const __m128i *)(p + k * channels));
+            __m128i hi = _mm_loadl_epi64((const __m128i *)(p + (k + 2) * channels));
+            __m256i v = _mm256_shuffle_epi8(_mm256_inserti128_si256(_mm256_castsi128_si256(lo), hi, 1), mask2);
+            __m256i wk = _mm256_inserti128_si256(_mm256_castsi128_si256(_mm_set1_epi32(resamplePair(w, k))),
+                                                 _mm_set1_epi32(resamplePair(w, k + 2)), 1);
+            acc2 = _mm256_add_epi32(acc2, _mm256_madd_epi16(v, wk));
+        }
+        __m128i acc = _mm_add_epi32(half, _mm_add_epi32(_mm256_castsi256_si128(acc2),
+                                                        _mm256_extracti128_si256(acc2, 1)));
+        if (k < rw.taps) acc = resampleStep(acc, p, w, k, channels, mask);
+        resampleStore(acc, out + (size_t)x * channels, channels);
+    }
+}
+
+#endif /* PG_SIMD_X86 */
+
+typedef void (*ResampleKernel)(const unsigned char *row, unsigned char *out, int outWidth, int channels,
+                               const ResizeWeights &rw);
+
+// Não há versão AVX-512: os pares de pixels vêm de endereços diferentes e
+// juntar quatro deles num registrador custaria mais que o madd economiza.
+inline ResampleKernel resampleKernelFor(SimdLevel level) {
+#if PG_SIMD_X86
+    switch (level) {
+        case SIMD_AVX512:
+        case SIMD_AVX2:   return resampleRowAVX2;
+        case SIMD_SSSE3:  return resampleRowSSSE3;
+        default:          break;
+    }
+#else
+    (void)level;
+#endif
+    return resampleRowScalar;
+}
+
+// Passada horizontal das linhas [y0, y1): src (largura in) -> dst (largura
+// rw.start.size()). Cada linha é copiada para um buffer com taps pixels de
+// zeros no fim, porque os kernels leem pares inteiros e os pesos zero do
+// fim de cada saída podem apontar além da linha.
+inline void resampleRows(const unsigned char *src, int in, unsigned char *dst, int channels, int y0, int y1,
+                         const ResizeWeights &rw, ResampleKernel kernel) {
+    int out = (int)rw.start.size();
+    size_t inBytes = (size_t)in * channels;
+    vector<unsigned char> row(inBytes + (size_t)rw.taps * channels + 16, 0);
+    for (int y = y0; y < y1; y++) {
+        memcpy(row.data(), src + (size_t)y * inBytes, inBytes);
+        kernel(row.data(), dst + (size_t)y * out * channels, out, channels, rw);
+    }
+}
+
+// Passada vertical das linhas de saída [y0, y1): cada uma é a convolução
+// de rw.taps linhas de src (altura in, rowBytes bytes por linha).
+inline void resampleColumns(const unsigned char *src, int in, unsigned char *dst, size_t rowBytes, int y0, int y1,
+                            const ResizeWeights &rw, ConvolveKernel conv) {
+    vector<const unsigned char *> taps(rw.taps);
+    for (int y = y0; y < y1; y++) {
+        for (int k = 0; k < rw.taps; k++) taps[k] = src + (size_t)min(rw.start[y] + k, in - 1) * rowBytes;
+        conv(taps.data(), rw.w.data() + (size_t)y * rw.taps, rw.taps, rowBytes, dst + (size_t)y * rowBytes);
+    }
+}
+
+// src (sw x sh) -> dst (dw x dh), channels canais intercalados, linhas
+// compactas. Um eixo que não muda de tamanho não é filtrado (com escala 1
+// os três filtros dão a identidade).
+inline void resizeImage(const unsigned char *src, int sw, int sh, unsigned char *dst, int dw, int dh, int channels,
+                        ResizeFilter filter, ResampleKernel rows, ConvolveKernel conv,
+                        ThreadPool &pool = ThreadPool::shared()) {
+    if (sw <= 0 || sh <= 0 || dw <= 0 || dh <= 0) return;
+    ImageBuffer tmp;
+    const unsigned char *mid = src;
+    if (dw != sw) {
+        ResizeWeights rw = resizeWeights(sw, dw, filter);
+        unsigned char *out = dst;
+        if (dh != sh) {
+            tmp = ImagePool::shared().acquire(dw, sh, channels);
+            out = tmp.data();
+        }
+        parallelRows(sw, sh, channels, [&](int y0, int y1) {
+            resampleRows(src, sw, out, channels, y0, y1, rw, rows);
+        }, pool);
+        mid = out;
+    }
+    size_t rowBytes = (size_t)dw * channels;
+    if (dh != sh) {
+        ResizeWeights rw = resizeWeights(sh, dh, filter);
+        parallelRows(dw, dh, channels, [&](int y0, int y1) {
+            resampleColumns(mid, sh, dst, rowBytes, y0, y1, rw, conv);
+        }, pool);
+    } else if (mid == src) {
+        memcpy(dst, src, rowBytes * dh);
+    }
+}
+
+inline void resizeImage(const unsigned char *src, int sw, int sh, unsigned char *dst, int dw, int dh, int channels,
+                        ResizeFilter filter) {
+    static const ResampleKernel rows = resampleKernelFor(activeSimdLevel());
+    static const ConvolveKernel conv = convolveKernelFor(activeSimdLevel());
+    resizeImage(src, sw, sh, dst, dw, dh, channels, filter, rows, conv);
+}
+
+// Tamanho final: com um dos lados 0, ele segue a proporção do original.
+inline bool resizeTarget(int sw, int sh, int &dw, int &dh) {
+    if (dw <= 0 && dh <= 0) return false;
+    if (dw <= 0) dw = max(1, (int)lround((double)sw * dh / sh));
+    if (dh <= 0) dh = max(1, (int)lround((double)sh * dw / sw));
+    return true;
+}
+
+// Troca img por uma cópia redimensionada vinda do pool.
+inline void resizeBuffer(ImageBuffer &img, int dw, int dh, ResizeFilter filter) {
+    ImageBuffer out = ImagePool::shared().acquire(dw, dh, img.getChannels());
+    resizeImage(img.data(), img.getWidth(), img.getHeight(), out.data(), dw, dh, img.getChannels(), filter);
+    img = std::move(out);
+}
+
+#endif /* Resize_h */
@@ -0,0 +1,289 @@
+//
+//  SimdRgb.h
+//  Separação de RGB intercalado em planos R, G e B, o caminho inverso
+//  (juntar três planos em RGB) e o de espalhar um valor por pixel para os
+//  três canais, com pshufb. storeRgba junta quatro planos em RGBA.
+//
+//  Cada grupo de 16 pixels ocupa 48 bytes = 3 registradores de 128 bits.
+//  No AVX2/AVX-512 o pshufb age dentro de cada pista de 128 bits, então cada
+//  pista recebe um grupo de 16 pixels diferente e as mesmas máscaras servem.
+//
+
+#ifndef SimdRgb_h
+#define SimdRgb_h
+
+#include "CpuFeatures.h"
+
+#if PG_SIMD_X86
+
+struct RgbShuffleMasks {
+    // split[v][c]: leva os bytes do canal c presentes no registrador v para a
+    // posição do pixel; o resto vira zero (bit 7 ligado)
+    alignas(16) unsigned char split[3][3][16];
+    // spread[v]: byte j do registrador de saída v recebe o pixel (16v + j) / 3
+    alignas(16) unsigned char spread[3][16];
+    // merge[v][c]: bytes do registrador de saída v que vêm do plano c
+    alignas(16) unsigned char merge[3][3][16];
+
+    RgbShuffleMasks() {
+        for (int v = 0; v < 3; v++) {
+            for (int c = 0; c < 3; c++) {
+                for (int k = 0; k < 16; k++) {
+                    int pos = 3 * k + c;
+                    split[v][c][k] = (pos / 16 == v) ? (unsigned char)(pos % 16) : 0x80;
+                }
+            }
+            for (int j = 0; j < 16; j++) {
+                spread[v][j] = (unsigned char)((16 * v + j) / 3);
+                for (int c = 0; c < 3; c++) {
+                    merge[v][c][j] = (16 * v + j) % 3 == c ? spread[v][j] : 0x80;
+                }
+            }
+        }
+    }
+};
+
+inline const RgbShuffleMasks &rgbMasks() {
+    static const RgbShuffleMasks masks;
+    return masks;
+}
+
+// ---- 128 bits: 16 pixels ----
+
+PG_TARGET("ssse3")
+inline __m128i rgbMask128(const unsigned char *m) {
+    return _mm_load_si128((const __m128i *)m);
+}
+
+PG_TARGET("ssse3")
+inline void loadRgb(const unsigned char *p, __m128i v[3]) {
+    for (int i = 0; i < 3; i++) v[i] = _mm_loadu_si128((const __m128i *)(p + 16 * i));
+}
+
+PG_TARGET("ssse3")
+inline void storeRgb(unsigned char *p, const __m128i v[3]) {
+    for (int i = 0; i < 3; i++) _mm_storeu_si128((__m128i *)(p + 16 * i), v[i]);
+}
+
+PG_TARGET("ssse3")
+inline void splitRgb(const __m128i v[3], __m128i &r, __m128i &g, __m128i &b) {
+    const RgbShuffleMasks &m = rgbMasks();
+    __m128i *out[3] = {&r, &g, &b};
+    for (int c = 0; c < 3; c++) {
+        *out[c] = _mm_or_si128(_mm_or_si128(_mm_shuffle_epi8(v[0], rgbMask128(m.split[0][c])),
+                                            _mm_shuffle_epi8(v[1], rgbMask128(m.split[1][c]))),
+                               _mm_shuffle_epi8(v[2], rgbMask128(m.split[2][c])));
+    }
+}
+
+PG_TARGET("ssse3")
+inline void splitRgb(const unsigned char *p, __m128i &r, __m128i &g, __m128i &b) {
+    __m128i v[3];
+    loadRgb(p, v);
+    splitRgb(v, r, g, b);
+}
+
+// Repete cada byte de x três vezes, no mesmo formato dos registradores de loadRgb.
+PG_TARGET("ssse3")
+inline void spreadRgb(__m128i x, __m128i v[3]) {
+    const RgbShuffleMasks &m = rgbMasks();
+    for (int i = 0; i < 3; i++) v[i] = _mm_shuffle_epi8(x, rgbMask128(m.spread[i]));
+}
+
+PG_TARGET("ssse3")
+inline void storeSpread(unsigned char *p, __m128i x) {
+    __m128i v[3];
+    spreadRgb(x, v);
+    storeRgb(p, v);
+}
+
+// Inverso de splitRgb: planos r, g, b de volta para RGB intercalado.
+PG_TARGET("ssse3")
+inline void mergeRgb(__m128i r, __m128i g, __m128i b, __m128i v[3]) {
+    const RgbShuffleMasks &m = rgbMasks();
+    for (int i = 0; i < 3; i++) {
+        v[i] = _mm_or_si128(_mm_or_si128(_mm_shuffle_epi8(r, rgbMask128(m.merge[i][0])),
+                                         _mm_shuffle_epi8(g, rgbMask128(m.merge[i][1]))),
+                            _mm_shuffle_epi8(b, rgbMask128(m.merge[i][2])));
+    }
+}
+
+// Planos r, g, b, a de 16 pixels -> 64 bytes RGBA intercalados.
+PG_TARGET("ssse3")
+inline void storeRgba(unsigned char *p, __m128i r, __m128i g, __m128i b, __m128i a) {
+    __m128i rgLo = _mm_unpacklo_epi8(r, g), rgHi = _mm_unpackhi_epi8(r, g);
+    __m128i baLo = _mm_unpacklo_epi8(b, a), baHi = _mm_unpackhi_epi8(b, a);
+    _mm_storeu_si128((__m128i *)p, _mm_unpacklo_epi16(rgLo, baLo));
+    _mm_storeu_si128((__m128i *)(p + 16), _mm_unpackhi_epi16(rgLo, baLo));
+    _mm_storeu_si128((__m128i *)(p + 32), _mm_unpacklo_epi16(rgHi, baHi));
+    _mm_storeu_si128((__m128i *)(p + 48), _mm_unpackhi_epi16(rgHi, baHi));
+}
+
+// ---- 256 bits: 2 grupos de 16 pixels (96 bytes) ----
+
+PG_TARGET("avx2")
+inline __m256i rgbMask256(const unsigned char *m) {
+    return _mm256_broadcastsi128_si256(_mm_load_si128((const __m128i *)m));
+}
+
+PG_TARGET("avx2")
+inline void loadRgb(const unsigned char *p, __m256i v[3]) {
+    for (int i = 0; i < 3; i++) {
+        v[i] = _mm256_inserti128_si256(_mm256_castsi128_si256(_mm_loadu_si128((const __m128i *)(p + 16 * i))),
+                                       _mm_loadu_si128((const __m128i *)(p + 48 + 16 * i)), 1);
+    }
+}
+
+PG_TARGET("avx2")
+inline void storeRgb(unsigned char *p, const __m256i v[3]) {
+    for (int i = 0; i < 3; i++) {
+        _mm_storeu_si128((__m128i *)(p + 16 * i), _mm256_castsi256_si128(v[i]));
+        _mm_storeu_si128((__m128i *)(p + 48 + 16 * i), _mm256_extracti128_si256(v[i], 1));
+    }
+}
+
+PG_TARGET("avx2")
+inline void splitRgb(const __m256i v[3], __m256i &r, __m256i &g, __m256i &b) {
+    const RgbShuffleMasks &m = rgbMasks();
+    __m256i *out[3] = {&r, &g, &b};
+    for (int c = 0; c < 3; c++) {
+        *out[c] = _mm256_or_si256(_mm256_or_si256(_mm256_shuffle_epi8(v[0], rgbMask256(m.split[0][c])),
+                                                  _mm256_shuffle_epi8(v[1], rgbMask256(m.split[1][c]))),
+                                  _mm256_shuffle_epi8(v[2], rgbMask256(m.split[2][c])));
+    }
+}
+
+PG_TARGET("avx2")
+inline void splitRgb(const unsigned char *p, __m256i &r, __m256i &g, __m256i &b) {
+    __m256i v[3];
+    loadRgb(p, v);
+    splitRgb(v, r, g, b);
+}
+
+PG_TARGET("avx2")
+inline void spreadRgb(__m256i x, __m256i v[3]) {
+    const RgbShuffleMasks &m = rgbMasks();
+    for (int i = 0; i < 3; i++) v[i] = _mm256_shuffle_epi8(x, rgbMask256(m.spread[i]));
+}
+
+PG_TARGET("avx2")
+inline void storeSpread(unsigned char *p, __m256i x) {
+    __m256i v[3];
+    spreadRgb(x, v);
+    storeRgb(p, v);
+}
+
+PG_TARGET("avx2")
+inline void mergeRgb(__m256i r, __m256i g, __m256i b, __m256i v[3]) {
+    const RgbShuffleMasks &m = rgbMasks();
+    for (int i = 0; i < 3; i++) {
+        v[i] = _mm256_or_si256(_mm256_or_si256(_mm256_shuffle_epi8(r, rgbMask256(m.merge[i][0])),
+                                               _mm256_shuffle_epi8(g, rgbMask256(m.merge[i][1]))),
+                               _mm256_shuffle_epi8(b, rgbMask256(m.merge[i][2])));
+    }
+}
+
+// Os unpacks ficam dentro de cada pista: q[j] tem os pixels 4j..4j+3 do
+// grupo de cada pista, e as pistas são reordenadas na gravação.
+PG_TARGET("avx2")
+inline void storeRgba(unsigned char *p, __m256i r, __m256i g, __m256i b, __m256i a) {
+    __m256i rgLo = _mm256_unpacklo_epi8(r, g), rgHi = _mm256_unpackhi_epi8(r, g);
+    __m256i baLo = _mm256_unpacklo_epi8(b, a), baHi = _mm256_unpackhi_epi8(b, a);
+    __m256i q0 = _mm256_unpacklo_epi16(rgLo, baLo), q1 = _mm256_unpackhi_epi16(rgLo, baLo);
+    __m256i q2 = _mm256_unpacklo_epi16(rgHi, baHi), q3 = _mm256_unpackhi_epi16(rgHi, baHi);
+    _mm256_storeu_si256((__m256i *)p, _mm256_permute2x128_si256(q0, q1, 0x20));
+    _mm256_storeu_si256((__m256i *)(p + 32), _mm256_permute2x128_si256(q2, q3, 0x20));
+    _mm256_storeu_si256((__m256i *)(p + 64), _mm256_permute2x128_si256(q0, q1, 0x31));
+    _mm256_storeu_si256((__m256i *)(p + 96), _mm256_permute2x128_si256(q2, q3, 0x31));
+}
+
+// ---- 512 bits: 4 grupos de 16 pixels (192 bytes) ----
+
+PG_TARGET("avx512f,avx512bw")
+inline __m512i rgbMask512(const unsigned char *m) {
+    return _mm512_broadcast_i32x4(_mm_load_si128((const __m128i *)m));
+}
+
+PG_TARGET("avx512f,avx512bw")
+inline __m512i loadLanes48(const unsigned char *p) {
+    __m512i v = _mm512_castsi128_si512(_mm_loadu_si128((const __m128i *)p));
+    v = _mm512_inserti32x4(v, _mm_loadu_si128((const __m128i *)(p + 48)), 1);
+    v = _mm512_inserti32x4(v, _mm_loadu_si128((const __m128i *)(p + 96)), 2);
+    return _mm512_inserti32x4(v, _mm_loadu_si128((const __m128i *)(p + 144)), 3);
+}
+
+PG_TARGET("avx512f,avx512bw")
+inline void loadRgb(const unsigned char *p, __m512i v[3]) {
+    for (int i = 0; i < 3; i++) v[i] = loadLanes48(p + 16 * i);
+}
+
+PG_TARGET("avx512f,avx512bw")
+inline void storeRgb(unsigned char *p, const __m512i v[3]) {
+    for (int i = 0; i < 3; i++) {
+        _mm_storeu_si128((__m128i *)(p + 16 * i), _mm512_castsi512_si128(v[i]));
+        _mm_storeu_si128((__m128i *)(p + 48 + 16 * i), _mm512_extracti32x4_epi32(v[i], 1));
+        _mm_storeu_si128((__m128i *)(p + 96 + 16 * i), _mm512_extracti32x4_epi32(v[i], 2));
+        _mm_storeu_si128((__m128i *)(p + 144 + 16 * i), _mm512_extracti32x4_epi32(v[i], 3));
+    }
+}
+
+PG_TARGET("avx512f,avx512bw")
+inline void splitRgb(const __m512i v[3], __m512i &r, __m512i &g, __m512i &b) {
+    const RgbShuffleMasks &m = rgbMasks();
+    __m512i *out[3] = {&r, &g, &b};
+    for (int c = 0; c < 3; c++) {
+        *out[c] = _mm512_or_si512(_mm512_or_si512(_mm512_shuffle_epi8(v[0], rgbMask512(m.split[0][c])),
+                                                  _mm512_shuffle_epi8(v[1], rgbMask512(m.split[1][c]))),
+                                  _mm512_shuffle_epi8(v[2], rgbMask512(m.split[2][c])));
+    }
+}
+
+PG_TARGET("avx512f,avx512bw")
+inline void splitRgb(const unsigned char *p, __m512i &r, __m512i &g, __m512i &b) {
+    __m512i v[3];
+    loadRgb(p, v);
+    splitRgb(v, r, g, b);
+}
+
+PG_TARGET("avx512f,avx512bw")
+inline void spreadRgb(__m512i x, __m512i v[3]) {
+    const RgbShuffleMasks &m = rgbMasks();
+    for (int i = 0; i < 3; i++) v[i] = _mm512_shuffle_epi8(x, rgbMask512(m.spread[i]));
+}
+
+PG_TARGET("avx512f,avx512bw")
+inline void storeSpread(unsigned char *p, __m512i x) {
+    __m512i v[3];
+    spreadRgb(x, v);
+    storeRgb(p, v);
+}
+
+PG_TARGET("avx512f,avx512bw")
+inline void mergeRgb(__m512i r, __m512i g, __m512i b, __m512i v[3]) {
+    const RgbShuffleMasks &m = rgbMasks();
+    for (int i = 0; i < 3; i++) {
+        v[i] = _mm512_or_si512(_mm512_or_si512(_mm512_shuffle_epi8(r, rgbMask512(m.merge[i][0])),
+                                               _mm512_shuffle_epi8(g, rgbMask512(m.merge[i][1]))),
+                               _mm512_shuffle_epi8(b, rgbMask512(m.merge[i][2])));
+    }
+}
+
+// Como na versão AVX2, com 4 pistas: a gravação é uma transposição 4x4 das
+// pistas de q0..q3.
+PG_TARGET("avx512f,avx512bw")
+inline void storeRgba(unsigned char *p, __m512i r, __m512i g, __m512i b, __m512i a) {
+    __m512i rgLo = _mm512_unpacklo_epi8(r, g), rgHi = _mm512_unpackhi_epi8(r, g);
+    __m512i baLo = _mm512_unpacklo_epi8(b, a), baHi = _mm512_unpackhi_epi8(b, a);
+    __m512i q0 = _mm512_unpacklo_epi16(rgLo, baLo), q1 = _mm512_unpackhi_epi16(rgLo, baLo);
+    __m512i q2 = _mm512_unpacklo_epi16(rgHi, baHi), q3 = _mm512_unpackhi_epi16(rgHi, baHi);
+    __m512i t0 = _mm512_shuffle_i32x4(q0, q1, 0x44), t1 = _mm512_shuffle_i32x4(q2, q3, 0x44);
+    __m512i t2 = _mm512_shuffle_i32x4(q0, q1, 0xEE), t3 = _mm512_shuffle_i32x4(q2, q3, 0xEE);
+    _mm512_storeu_si512((void *)p, _mm512_shuffle_i32x4(t0, t1, 0x88));
+    _mm512_storeu_si512((void *)(p + 64), _mm512_shuffle_i32x4(t0, t1, 0xDD));
+    _mm512_storeu_si512((void *)(p + 128), _mm512_shuffle_i32x4(t2, t3, 0x88));
+    _mm512_storeu_si512((void *)(p + 192), _mm512_shuffle_i32x4(t2, t3, 0xDD));
+}
+
+#endif /* PG_SIMD_X86 */
+
+#endif /* SimdRgb_h */
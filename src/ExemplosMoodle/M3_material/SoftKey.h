@@ -0,0 +1,189 @@
+//
+//  SoftKey.h
+//  Chroma-key com alfa suave e supressão de vazamento (spill), de RGB para
+//  RGBA numa passada só.
+//
+//  Em vez da decisão binária de ChromaKey.h, o alfa sobe linearmente com a
+//  distância d à cor-chave: 0 até a tolerância interna, 255 a partir da
+//  externa. Nas bordas (cabelo, desfoque de movimento) o pixel fica
+//  parcialmente transparente e a composição não mostra serrilhado.
+//
+//  Supressão de vazamento: a luz refletida do fundo deixa o primeiro plano
+//  com um tom da cor-chave. O canal dominante da chave (o verde numa tela
+//  verde) é limitado ao maior dos outros dois canais do pixel; spill diz
+//  quanto do excesso é removido (256 = tudo).
+//
+//  d^2 é calculado em inteiros como em ChromaKey.h; a raiz, a rampa do alfa
+//  e o arredondamento são em float, com as mesmas operações na versão
+//  escalar e nas SIMD, então o resultado é o mesmo em todos os níveis. O
+//  RGB guardado é o do pixel (alfa não pré-multiplicado).
+//
+
+#ifndef SoftKey_h
+#define SoftKey_h
+
+#include <algorithm>
+#include <math.h>
+#include <stddef.h>
+
+#include "SimdRgb.h"
+#include "ThreadPool.h"
+#include "ImageBuffer.h"
+
+using namespace std;
+
+struct SoftKey {
+    int r, g, b;
+    float inner;  // distância até a qual o pixel é fundo (alfa 0)
+    float scale;  // 255 / (externa - interna): inclinação da rampa do alfa
+    int spill;    // 0..256: fração (/256) do excesso do canal dominante removida
+    int dominant; // canal da cor-chave com o maior valor
+    int others[2];
+};
+
+// Tolerâncias relativas, como em chromaKeyColor (d / dmax, dmax = distância
+// do preto ao branco); spill em 0..1.
+inline SoftKey softKey(int r, int g, int b, double inner, double outer, double spill) {
+    const double dmax = sqrt(3.0) * 255;
+    SoftKey k;
+    k.r = r < 0 ? 0 : (r > 255 ? 255 : r);
+    k.g = g < 0 ? 0 : (g > 255 ? 255 : g);
+    k.b = b < 0 ? 0 : (b > 255 ? 255 : b);
+    inner = inner < 0 ? 0 : inner;
+    outer = outer < inner ? inner : outer;
+    k.inner = (float)(inner * dmax);
+    // tolerâncias iguais: chave binária em d = interna
+    k.scale = (float)(255 / max((outer - inner) * dmax, 1e-3));
+    k.spill = (int)lround((spill < 0 ? 0 : (spill > 1 ? 1 : spill)) * 256);
+    int rgb[3] = {k.r, k.g, k.b};
+    k.dominant = 0;
+    for (int c = 1; c < 3; c++) {
+        if (rgb[c] > rgb[k.dominant]) k.dominant = c;
+    }
+    k.others[0] = k.dominant == 0 ? 1 : 0;
+    k.others[1] = k.dominant == 2 ? 1 : 2;
+    return k;
+}
+
+inline void softKeyScalar(const unsigned char *rgb, size_t pixels, const SoftKey &k, unsigned char *rgba) {
+    for (size_t p = 0; p < pixels; p++, rgb += 3, rgba += 4) {
+        int dr = rgb[0] - k.r, dg = rgb[1] - k.g, db = rgb[2] - k.b;
+        float a = (sqrtf((float)(dr * dr + dg * dg + db * db)) - k.inner) * k.scale;
+        a = a > 0.0f ? a : 0.0f;
+        a = a < 255.0f ? a : 255.0f;
+        int c[3] = {rgb[0], rgb[1], rgb[2]};
+        int limit = max(c[k.others[0]], c[k.others[1]]);
+        int excess = c[k.dominant] - limit;
+        if (excess > 0) c[k.dominant] -= (excess * k.spill) >> 8;
+        rgba[0] = (unsigned char)c[0];
+        rgba[1] = (unsigned char)c[1];
+        rgba[2] = (unsigned char)c[2];
+        rgba[3] = (unsigned char)lrintf(a);
+    }
+}
+
+#if PG_SIMD_X86
+
+// Por pista de 128 bits: |diferença| em 8 bits e d^2 com pmaddwd em 32 bits
+// (como PG_CHROMA_KEYED), depois raiz e rampa em float e os packs de volta
+// para 8 bits, que saem na ordem dos pixels. cvtps arredonda para o par
+// mais próximo, como lrintf.
+#define PG_SOFTKEY_BODY(SUF, VEC, PS, SI, STEP)                                                  \
+    const VEC kr = SUF##_set1_epi8((char)k.r);                                                   \
+    const VEC kg = SUF##_set1_epi8((char)k.g);                                                   \
+    const VEC kb = SUF##_set1_epi8((char)k.b);                                                   \
+    const VEC zero = SUF##_setzero_##SI();                                                       \
+    const VEC spill = SUF##_set1_epi16((short)k.spill);                                          \
+    const PS inner = SUF##_set1_ps(k.inner), scale = SUF##_set1_ps(k.scale);                     \
+    const PS fzero = SUF##_setzero_ps(), full = SUF##_set1_ps(255.0f);                           \
+    size_t i = 0;                                                                                \
+    for (; i + STEP <= pixels; i += STEP) {                                                      \
+        VEC c[3];                                                                                \
+        splitRgb(rgb + i * 3, c[0], c[1], c[2]);                                                 \
+        VEC dr = SUF##_or_##SI(SUF##_subs_epu8(c[0], kr), SUF##_subs_epu8(kr, c[0]));            \
+        VEC dg = SUF##_or_##SI(SUF##_subs_epu8(c[1], kg), SUF##_subs_epu8(kg, c[1]));            \
+        VEC db = SUF##_or_##SI(SUF##_subs_epu8(c[2], kb), SUF##_subs_epu8(kb, c[2]));            \
+        VEC half[2];                                                                             \
+        for (int h = 0; h < 2; h++) {                                                            \
+            VEC r16 = h ? SUF##_unpackhi_epi8(dr, zero) : SUF##_unpacklo_epi8(dr, zero);         \
+            VEC g16 = h ? SUF##_unpackhi_epi8(dg, zero) : SUF##_unpacklo_epi8(dg, zero);         \
+            VEC b16 = h ? SUF##_unpackhi_epi8(db, zero) : SUF##_unpacklo_epi8(db, zero);         \
+            VEC rg[2] = {SUF##_unpacklo_epi16(r16, g16), SUF##_unpackhi_epi16(r16, g16)};        \
+            VEC bz[2] = {SUF##_unpacklo_epi16(b16, zero), SUF##_unpackhi_epi16(b16, zero)};      \
+            VEC a[2];                                                                            \
+            for (int q = 0; q < 2; q++) {                                                        \
+                VEC d2 = SUF##_add_epi32(SUF##_madd_epi16(rg[q], rg[q]),                         \
+                                         SUF##_madd_epi16(bz[q], bz[q]));                        \
+                PS d = SUF##_sqrt_ps(SUF##_cvtepi32_ps(d2));                                     \
+                PS x = SUF##_mul_ps(SUF##_sub_ps(d, inner), scale);                              \
+                a[q] = SUF##_cvtps_epi32(SUF##_min_ps(SUF##_max_ps(x, fzero), full));            \
+            }                                                                                    \
+            half[h] = SUF##_packs_epi32(a[0], a[1]);                                             \
+        }                                                                                        \
+        VEC alpha = SUF##_packus_epi16(half[0], half[1]);                                        \
+        VEC &dom = c[k.dominant];                                                                \
+        VEC excess = SUF##_subs_epu8(dom, SUF##_max_epu8(c[k.others[0]], c[k.others[1]]));      \
+        VEC exLo = SUF##_unpacklo_epi8(excess, zero), exHi = SUF##_unpackhi_epi8(excess, zero);  \
+        VEC cutLo = SUF##_srli_epi16(SUF##_mullo_epi16(exLo, spill), 8);                         \
+        VEC cutHi = SUF##_srli_epi16(SUF##_mullo_epi16(exHi, spill), 8);                         \
+        dom = SUF##_subs_epu8(dom, SUF##_packus_epi16(cutLo, cutHi));                            \
+        storeRgba(rgba + i * 4, c[0], c[1], c[2], alpha);                                        \
+    }                                                                                            \
+    softKeyScalar(rgb + i * 3, pixels - i, k, rgba + i * 4);
+
+PG_TARGET("ssse3")
+inline void softKeySSSE3(const unsigned char *rgb, size_t pixels, const SoftKey &k, unsigned char *rgba) {
+    PG_SOFTKEY_BODY(_mm, __m128i, __m128, si128, 16)
+}
+
+PG_TARGET("avx2")
+inline void softKeyAVX2(const unsigned char *rgb, size_t pixels, const SoftKey &k, unsigned char *rgba) {
+    PG_SOFTKEY_BODY(_mm256, __m256i, __m256, si256, 32)
+}
+
+PG_TARGET("avx512f,avx512bw")
+inline void softKeyAVX512(const unsigned char *rgb, size_t pixels, const SoftKey &k, unsigned char *rgba) {
+    PG_SOFTKEY_BODY(_mm512, __m512i, __m512, si512, 64)
+}
+
+#undef PG_SOFTKEY_BODY
+
+#endif /* PG_SIMD_X86 */
+
+typedef void (*SoftKeyKernel)(const unsigned char *rgb, size_t pixels, const SoftKey &k, unsigned char *rgba);
+
+inline SoftKeyKernel softKeyKernelFor(SimdLevel level) {
+#if PG_SIMD_X86
+    switch (level) {
+        case SIMD_AVX512: return softKeyAVX512;
+        case SIMD_AVX2:   return softKeyAVX2;
+        case SIMD_SSSE3:  return softKeySSSE3;
+        default:          break;
+    }
+#else
+    (void)level;
+#endif
+    return softKeyScalar;
+}
+
+// rgb (w x h, 3 canais) -> rgba (4 canais), em faixas de linhas no pool.
+inline void softKeyRgba(const unsigned char *rgb, int w, int h, const SoftKey &k, unsigned char *rgba,
+                        SoftKeyKernel kernel, ThreadPool &pool = ThreadPool::shared()) {
+    parallelRows(w, h, 7, [&](int y0, int y1) {
+        size_t first = (size_t)y0 * w;
+        kernel(rgb + first * 3, (size_t)(y1 - y0) * w, k, rgba + first * 4);
+    }, pool);
+}
+
+inline void softKeyRgba(const unsigned char *rgb, int w, int h, const SoftKey &k, unsigned char *rgba) {
+    static const SoftKeyKernel kernel = softKeyKernelFor(activeSimdLevel());
+    softKeyRgba(rgb, w, h, k, rgba, kernel);
+}
+
+// out recebe a imagem RGBA, com o bloco vindo do ImagePool.
+inline void softKeyRgba(const unsigned char *rgb, int w, int h, const SoftKey &k, ImageBuffer &out) {
+    out = ImagePool::shared().acquire(w, h, 4);
+    softKeyRgba(rgb, w, h, k, out.data());
+}
+
+#endif /* SoftKey_h */
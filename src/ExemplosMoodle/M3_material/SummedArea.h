@@ -0,0 +1,248 @@
+//
+//  SummedArea.h
+//  Tabela de somas acumuladas (summed-area table, ou integral image) e
+//  filtro de média de caixa com custo fixo por pixel, qualquer que seja o
+//  raio.
+//
+//  t[y][x] é a soma de [0, y) x [0, x) em cada canal. A tabela é montada em
+//  duas passadas paralelas: a soma acumulada de cada linha (faixas de linhas
+//  no pool) e depois a soma das linhas de cima (faixas de colunas). A soma
+//  de qualquer retângulo sai de 4 leituras. As entradas são de 32 bits e
+//  podem dar a volta: a soma de um retângulo é uma diferença módulo 2^32 e
+//  sai exata, porque cabe em 32 bits.
+//
+//  A média de caixa replica as bordas, como boxBlur em Blur.h. Para cada
+//  linha de saída, a diferença entre as linhas da tabela abaixo e acima da
+//  janela (mais as linhas replicadas, se a janela passa da borda) é
+//  estendida r colunas para cada lado; a janela de cada pixel vira então a
+//  diferença de duas entradas dessa linha, e um kernel SIMD converte 4 a 16
+//  somas por registrador em médias.
+//
+
+#ifndef SummedArea_h
+#define SummedArea_h
+
+#include <algorithm>
+#include <math.h>
+#include <stddef.h>
+#include <stdint.h>
+#include <vector>
+
+#include "CpuFeatures.h"
+#include "ThreadPool.h"
+#include "ImageBuffer.h"
+
+using namespace std;
+
+struct SummedArea {
+    int width = 0, height = 0, channels = 0;
+    size_t stride = 0; // (width + 1) * channels entradas por linha
+    // (height + 1) linhas num bloco do ImagePool: a tabela de um quadro
+    // aproveita a memória (já mapeada) da do quadro anterior
+    ImageBuffer storage;
+
+    uint32_t *sums() { return (uint32_t *)storage.data(); }
+    uint32_t *row(int y) { return sums() + (size_t)y * stride; }
+    const uint32_t *row(int y) const { return (const uint32_t *)storage.data() + (size_t)y * stride; }
+
+    // Soma de [x0, x1) x [y0, y1) no canal c.
+    uint32_t rect(int x0, int y0, int x1, int y1, int c) const {
+        const uint32_t *top = row(y0), *bottom = row(y1);
+        return bottom[(size_t)x1 * channels + c] - bottom[(size_t)x0 * channels + c]
+               - top[(size_t)x1 * channels + c] + top[(size_t)x0 * channels + c];
+    }
+};
+
+// Segunda passada: soma a cada linha de uma tabela de rows linhas a linha de
+// cima, em faixas de colunas no pool (cada faixa desce a tabela inteira).
+inline void accumulateColumns(uint32_t *table, size_t stride, int rows, ThreadPool &pool = ThreadPool::shared()) {
+    const size_t strip = 1024;
+    pool.run((stride + strip - 1) / strip, [&](size_t s) {
+        size_t x0 = s * strip, x1 = min(stride, x0 + strip);
+        for (int y = 1; y < rows; y++) {
+            uint32_t *cur = table + (size_t)y * stride, *up = cur - stride;
+            for (size_t x = x0; x < x1; x++) cur[x] += up[x];
+        }
+    });
+}
+
+// Soma acumulada de uma linha de w pixels: dst[0..CH) = 0 e
+// dst[(x + 1) * CH + c] = soma de src[0..x] no canal c. As somas ficam em
+// registradores (com a soma só na memória, cada pixel esperaria a gravação
+// do anterior).
+template <int CH>
+inline void prefixRow(const unsigned char *src, int w, uint32_t *dst) {
+    uint32_t acc[CH] = {};
+    for (int c = 0; c < CH; c++) dst[c] = 0;
+    dst += CH;
+    for (int x = 0; x < w; x++, src += CH, dst += CH) {
+        for (int c = 0; c < CH; c++) dst[c] = acc[c] += src[c];
+    }
+}
+
+inline void prefixRow(const unsigned char *src, int w, int channels, uint32_t *dst) {
+    switch (channels) {
+        case 1: prefixRow<1>(src, w, dst); return;
+        case 3: prefixRow<3>(src, w, dst); return;
+        case 4: prefixRow<4>(src, w, dst); return;
+        default: break;
+    }
+    for (int c = 0; c < channels; c++) dst[c] = 0;
+    for (size_t i = 0, n = (size_t)w * channels; i < n; i++) dst[i + channels] = dst[i] + src[i];
+}
+
+// Tabela de uma imagem de w x h pixels com channels canais intercalados e
+// linhas a rowBytes bytes uma da outra.
+inline void buildSummedArea(const unsigned char *data, size_t rowBytes, int w, int h, int channels, SummedArea &t,
+                            ThreadPool &pool = ThreadPool::shared()) {
+    t.width = w;
+    t.height = h;
+    t.channels = channels;
+    t.stride = ((size_t)w + 1) * channels;
+    t.storage = ImagePool::shared().acquire(w + 1, h + 1, channels * (int)sizeof(uint32_t));
+    fill(t.row(0), t.row(1), 0u);
+    parallelRows(w, h, channels, [&](int y0, int y1) {
+        for (int y = y0; y < y1; y++) prefixRow(data + (size_t)y * rowBytes, w, channels, t.row(y + 1));
+    }, pool);
+    accumulateColumns(t.sums(), t.stride, h + 1, pool);
+}
+
+// Raio máximo da média: (2r+1)² * 255 precisa caber em int32.
+static const int BOX_MAX_RADIUS = 1450;
+
+// out[i] = (hi[i] - lo[i]) * inv arredondado, i em [begin, end). A conta é
+// em float, como nas versões SIMD, para o resultado ser o mesmo em todas.
+inline void boxMeanRange(const uint32_t *lo, const uint32_t *hi, float inv, size_t begin, size_t end,
+                         unsigned char *out) {
+    for (size_t i = begin; i < end; i++) {
+        long v = lrintf((float)(int32_t)(hi[i] - lo[i]) * inv);
+        out[i] = (unsigned char)(v > 255 ? 255 : v);
+    }
+}
+
+inline void boxMeanScalar(const uint32_t *lo, const uint32_t *hi, float inv, size_t count, unsigned char *out) {
+    boxMeanRange(lo, hi, inv, 0, count, out);
+}
+
+#if PG_SIMD_X86
+
+// Quatro registradores de somas por vez: cvtps arredonda para o par mais
+// próximo, como lrintf. Os packs trabalham por faixa de 128 bits; ORDER põe
+// os dwords de volta na ordem dos pixels em AVX2 e AVX-512.
+#define PG_BOX_MEAN_BODY(SUF, VEC, PS, SI, STEP, ORDER)                                        \
+    const PS vinv = SUF##_set1_ps(inv);                                                        \
+    size_t i = 0;                                                                              \
+    for (; i + STEP <= count; i += STEP) {                                                     \
+        VEC q[4];                                                                              \
+        for (int k = 0; k < 4; k++) {                                                          \
+            VEC a = SUF##_loadu_##SI((const VEC *)(lo + i + k * STEP / 4));                    \
+            VEC b = SUF##_loadu_##SI((const VEC *)(hi + i + k * STEP / 4));                    \
+            q[k] = SUF##_cvtps_epi32(SUF##_mul_ps(SUF##_cvtepi32_ps(SUF##_sub_epi32(b, a)), vinv)); \
+        }                                                                                      \
+        VEC v = SUF##_packus_epi16(SUF##_packs_epi32(q[0], q[1]), SUF##_packs_epi32(q[2], q[3])); \
+        SUF##_storeu_##SI((VEC *)(out + i), ORDER);                                            \
+    }                                                                                          \
+    boxMeanRange(lo, hi, inv, i, count, out);
+
+PG_TARGET("ssse3")
+inline void boxMeanSSSE3(const uint32_t *lo, const uint32_t *hi, float inv, size_t count, unsigned char *out) {
+    PG_BOX_MEAN_BODY(_mm, __m128i, __m128, si128, 16, v)
+}
+
+PG_TARGET("avx2")
+inline void boxMeanAVX2(const uint32_t *lo, const uint32_t *hi, float inv, size_t count, unsigned char *out) {
+    PG_BOX_MEAN_BODY(_mm256, __m256i, __m256, si256, 32,
+                     _mm256_permutevar8x32_epi32(v, _mm256_setr_epi32(0, 4, 1, 5, 2, 6, 3, 7)))
+}
+
+PG_TARGET("avx512f,avx512bw")
+inline void boxMeanAVX512(const uint32_t *lo, const uint32_t *hi, float inv, size_t count, unsigned char *out) {
+    PG_BOX_MEAN_BODY(_mm512, __m512i, __m512, si512, 64,
+                     _mm512_permutexvar_epi32(_mm512_setr_epi32(0, 4, 8, 12, 1, 5, 9, 13,
+                                                                2, 6, 10, 14, 3, 7, 11, 15), v))
+}
+
+#undef PG_BOX_MEAN_BODY
+
+#endif /* PG_SIMD_X86 */
+
+typedef void (*BoxMeanKernel)(const uint32_t *lo, const uint32_t *hi, float inv, size_t count, unsigned char *out);
+
+inline BoxMeanKernel boxMeanKernelFor(SimdLevel level) {
+#if PG_SIMD_X86
+    switch (level) {
+        case SIMD_AVX512: return boxMeanAVX512;
+        case SIMD_AVX2:   return boxMeanAVX2;
+        case SIMD_SSSE3:  return boxMeanSSSE3;
+        default:          break;
+    }
+#else
+    (void)level;
+#endif
+    return boxMeanScalar;
+}
+
+// Soma, por coluna X da tabela e canal, das linhas da janela da linha y de
+// saída, com as bordas de cima e de baixo replicadas; estendida r colunas
+// para cada lado (a linha e a coluna da borda se repetem), de modo que
+// ext[(X + r) * channels + c] vale para X em [-r, w + r].
+inline void boxWindowRow(const SummedArea &t, int y, int r, uint32_t *ext) {
+    int w = t.width, h = t.height, ch = t.channels;
+    int ya = y - r, yb = y + r + 1;
+    int y0 = max(0, ya), y1 = min(h, yb);
+    uint32_t above = (uint32_t)max(0, -ya), below = (uint32_t)max(0, yb - h);
+    const uint32_t *top = t.row(y0), *bottom = t.row(y1);
+    const uint32_t *first = t.row(1), *last = t.row(h), *beforeLast = t.row(h - 1);
+    uint32_t *d = ext + (size_t)r * ch;
+    size_t n = t.stride;
+    if (above == 0 && below == 0) {
+        for (size_t i = 0; i < n; i++) d[i] = bottom[i] - top[i];
+    } else {
+        for (size_t i = 0; i < n; i++) {
+            d[i] = bottom[i] - top[i] + above * first[i] + below * (last[i] - beforeLast[i]);
+        }
+    }
+    // à esquerda de X = 0 cada coluna a mais soma de novo a coluna 0; à
+    // direita de X = w, a coluna w - 1
+    for (int c = 0; c < ch; c++) {
+        uint32_t left = d[ch + c], right = d[(size_t)w * ch + c] - d[(size_t)(w - 1) * ch + c];
+        for (int k = 1; k <= r; k++) {
+            d[-(ptrdiff_t)k * ch + c] = (uint32_t)0 - k * left;
+            d[(size_t)(w + k) * ch + c] = d[(size_t)w * ch + c] + k * right;
+        }
+    }
+}
+
+// Média de caixa (2r+1) x (2r+1) in-place, com as bordas replicadas. O
+// custo por pixel não depende do raio: a tabela custa duas passadas e cada
+// pixel de saída lê duas entradas de uma linha montada a partir dela.
+inline void boxMean(unsigned char *data, size_t rowBytes, int w, int h, int channels, int radius,
+                    BoxMeanKernel kernel, ThreadPool &pool = ThreadPool::shared()) {
+    int r = min(radius, BOX_MAX_RADIUS);
+    if (r <= 0 || w <= 0 || h <= 0) return;
+    SummedArea t;
+    buildSummedArea(data, rowBytes, w, h, channels, t, pool);
+    float inv = 1.0f / ((float)(2 * r + 1) * (float)(2 * r + 1));
+    size_t extLen = ((size_t)w + 2 * r + 1) * channels;
+    parallelRows(w, h, channels, [&](int y0, int y1) {
+        vector<uint32_t> ext(extLen);
+        for (int y = y0; y < y1; y++) {
+            boxWindowRow(t, y, r, ext.data());
+            kernel(ext.data(), ext.data() + (size_t)(2 * r + 1) * channels, inv, (size_t)w * channels,
+                   data + (size_t)y * rowBytes);
+        }
+    }, pool);
+}
+
+inline void boxMean(unsigned char *data, int w, int h, int channels, int radius) {
+    static const BoxMeanKernel kernel = boxMeanKernelFor(activeSimdLevel());
+    boxMean(data, (size_t)w * channels, w, h, channels, radius, kernel);
+}
+
+// Imagem ou máscara (1 canal) de ImageBuffer, com o stride dela.
+inline void boxMean(ImageBuffer &img, int radius) {
+    static const BoxMeanKernel kernel = boxMeanKernelFor(activeSimdLevel());
+    boxMean(img.data(), img.getStride(), img.getWidth(), img.getHeight(), img.getChannels(), radius, kernel);
+}
+
+#endif /* SummedArea_h */
@@ -0,0 +1,176 @@
+//
+//  ThreadPool.h
+//  Pool de threads fixo e execução de filtros por faixas de linhas.
+//
+//  A imagem é dividida em faixas de linhas inteiras com tamanho próximo ao
+//  cache L2; as threads pegam faixas de um contador atômico. Cada faixa é
+//  processada por inteiro por uma única thread e faixas não se sobrepõem,
+//  então filtros pontuais dão exatamente o resultado da versão serial, seja
+//  qual for o número de threads ou a ordem em que as faixas terminam.
+//
+
+#ifndef ThreadPool_h
+#define ThreadPool_h
+
+#include <atomic>
+#include <condition_variable>
+#include <functional>
+#include <mutex>
+#include <thread>
+#include <vector>
+#include <stddef.h>
+#include <stdlib.h>
+
+using namespace std;
+
+class ThreadPool {
+public:
+    // threads = total de threads trabalhando, contando a que chama run()
+    explicit ThreadPool(unsigned int threads) {
+        if (threads == 0) threads = 1;
+        for (unsigned int i = 1; i < threads; i++) {
+            workers.emplace_back([this]() { workerLoop(); });
+        }
+    }
+
+    ~ThreadPool() {
+        {
+            lock_guard<mutex> lock(mtx);
+            stopping = true;
+        }
+        wake.notify_all();
+        for (thread &t : workers) t.join();
+    }
+
+    ThreadPool(const ThreadPool &) = delete;
+    ThreadPool &operator=(const ThreadPool &) = delete;
+
+    unsigned int size() const { return (unsigned int)workers.size() + 1; }
+
+    // Executa task(0) .. task(count - 1) e só retorna quando todas terminarem.
+    // Chamadas de dentro de uma tarefa rodam em série na própria thread.
+    void run(size_t count, const function<void(size_t)> &task) {
+        if (count == 0) return;
+        if (workers.empty() || count == 1 || insideTask()) {
+            for (size_t i = 0; i < count; i++) task(i);
+            return;
+        }
+        lock_guard<mutex> serial(runMtx); // um trabalho por vez no pool
+        unique_lock<mutex> lock(mtx);
+        // nenhuma thread pode estar ainda lendo o trabalho anterior
+        done.wait(lock, [this]() { return active == 0; });
+        job = &task;
+        jobCount = count;
+        next.store(0);
+        pending.store(count);
+        generation++;
+        lock.unlock();
+        wake.notify_all();
+        work();
+        lock.lock();
+        done.wait(lock, [this]() { return pending.load() == 0 && active == 0; });
+        job = nullptr;
+    }
+
+    // Pool compartilhado pelos filtros; PG_THREADS limita o número de threads.
+    static ThreadPool &shared() {
+        static ThreadPool pool([]() {
+            unsigned int n = thread::hardware_concurrency();
+            const char *env = getenv("PG_THREADS");
+            if (env && atoi(env) > 0) n = (unsigned int)atoi(env);
+            return n;
+        }());
+        return pool;
+    }
+
+private:
+    static bool &insideTask() {
+        static thread_local bool inside = false;
+        return inside;
+    }
+
+    void work() {
+        insideTask() = true;
+        size_t i;
+        while ((i = next.fetch_add(1)) < jobCount) {
+            (*job)(i);
+            if (pending.fetch_sub(1) == 1) {
+                lock_guard<mutex> lock(mtx);
+                done.notify_all();
+            }
+        }
+        insideTask() = false;
+    }
+
+    void workerLoop() {
+        size_t seen = 0;
+        for (;;) {
+            {
+                unique_lock<mutex> lock(mtx);
+                wake.wait(lock, [&]() { return stopping || generation != seen; });
+                if (stopping) return;
+                seen = generation;
+                active++;
+            }
+            work();
+            lock_guard<mutex> lock(mtx);
+            if (--active == 0) done.notify_all();
+        }
+    }
+
+    vector<thread> workers;
+    mutex mtx;
+    mutex runMtx;
+    condition_variable wake;
+    condition_variable done;
+    bool stopping = false;
+    size_t generation = 0;
+    unsigned int active = 0; // workers dentro de work()
+    const function<void(size_t)> *job = nullptr;
+    size_t jobCount = 0;
+    atomic<size_t> next{0};
+    atomic<size_t> pending{0};
+};
+
+// Altura das faixas: ~256 KiB por faixa (cabe no L2 junto com a saída), mas
+// com pelo menos 4 faixas por thread para equilibrar a carga e nunca menos
+// de 16 KiB por faixa, para o custo de despacho não dominar.
+inline int bandRows(int width, int height, int channels, unsigned int threads) {
+    const size_t targetBytes = 256 * 1024;
+    const size_t minBytes = 16 * 1024;
+    size_t rowBytes = (size_t)width * channels;
+    if (rowBytes == 0 || height <= 0) return 1;
+    size_t rows = targetBytes / rowBytes;
+    size_t balanced = (size_t)height / (4 * (size_t)threads);
+    if (balanced < rows) rows = balanced;
+    size_t minRows = (minBytes + rowBytes - 1) / rowBytes;
+    if (rows < minRows) rows = minRows;
+    if (rows < 1) rows = 1;
+    if (rows > (size_t)height) rows = height;
+    return (int)rows;
+}
+
+// Chama f(y0, y1) para faixas [y0, y1) que cobrem as linhas [0, height).
+template <typename F>
+void parallelRows(int width, int height, int channels, F f, ThreadPool &pool = ThreadPool::shared()) {
+    if (height <= 0) return;
+    int rows = bandRows(width, height, channels, pool.size());
+    size_t bands = (size_t)((height + rows - 1) / rows);
+    pool.run(bands, [&](size_t b) {
+        int y0 = (int)b * rows;
+        int y1 = y0 + rows < height ? y0 + rows : height;
+        f(y0, y1);
+    });
+}
+
+// Para filtros pontuais sobre RGB intercalado: f(pixels da faixa, número de
+// pixels, índice do primeiro pixel da faixa na imagem).
+template <typename F>
+void parallelPixels(unsigned char *data, int width, int height, F f, ThreadPool &pool = ThreadPool::shared()) {
+    parallelRows(width, height, 3, [&](int y0, int y1) {
+        size_t first = (size_t)y0 * width;
+        f(data + first * 3, (size_t)(y1 - y0) * width, first);
+    }, pool);
+}
+
+#endif /* ThreadPool_h */
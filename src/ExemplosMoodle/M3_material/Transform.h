@@ -0,0 +1,456 @@
+//
+//  Transform.h
+//  Rotações de 90/180/270 graus, transposição e espelhamentos, com SIMD,
+//  em blocos e com threads.
+//
+//  Girar 90 graus lendo a origem linha a linha e escrevendo a saída coluna a
+//  coluna (ou o contrário) toca uma página diferente a cada pixel: numa
+//  imagem de 1080p são milhares de páginas por coluna, a TLB e o cache não
+//  dão conta e a rotação fica mais lenta que decodificar o arquivo. Aqui a
+//  imagem é percorrida em ladrilhos de TRANSFORM_TILE x TRANSFORM_TILE
+//  pixels: cada ladrilho toca poucas linhas de origem e poucas de destino,
+//  que ficam no L1 (e na TLB) enquanto ele é copiado.
+//
+//  Rotação de 90/270 graus, transposição e transversa são a mesma operação:
+//  o pixel (x, y) vai para a linha x (ou w-1-x) e a coluna y (ou h-1-y) da
+//  saída. Dentro do ladrilho os kernels SIMD transpõem blocos de 4x4
+//  (SSSE3) ou 8x8 (AVX2) pixels: cada pixel RGB vira 32 bits com pshufb, a
+//  transposição é feita com unpack e volta a 3 bytes antes de gravar.
+//  Inverter a coluna é só ler as linhas do bloco de baixo para cima.
+//
+//  Espelhamento horizontal e rotação de 180 graus invertem a ordem dos
+//  pixels de cada linha (pshufb); o vertical só troca linhas. Esses três
+//  podem rodar no próprio buffer (transformInPlace); os que trocam os eixos
+//  precisam de um buffer novo (transformBuffer tira do ImagePool).
+//
+
+#ifndef Transform_h
+#define Transform_h
+
+#include <algorithm>
+#include <stddef.h>
+#include <string.h>
+#include <string>
+#include <vector>
+
+#include "CpuFeatures.h"
+#include "ThreadPool.h"
+#include "ImageBuffer.h"
+
+using namespace std;
+
+enum ImageTransform {
+    TRANSFORM_ROTATE_90,  // horário
+    TRANSFORM_ROTATE_180,
+    TRANSFORM_ROTATE_270, // anti-horário
+    TRANSFORM_TRANSPOSE,  // espelha na diagonal principal
+    TRANSFORM_TRANSVERSE, // espelha na outra diagonal
+    TRANSFORM_FLIP_H,     // espelha da esquerda para a direita
+    TRANSFORM_FLIP_V,     // espelha de cima para baixo
+};
+
+inline bool parseImageTransform(const string &name, ImageTransform &t) {
+    if (name == "rot90" || name == "90" || name == "cw") {
+        t = TRANSFORM_ROTATE_90;
+    } else if (name == "rot180" || name == "180") {
+        t = TRANSFORM_ROTATE_180;
+    } else if (name == "rot270" || name == "270" || name == "ccw") {
+        t = TRANSFORM_ROTATE_270;
+    } else if (name == "transpose") {
+        t = TRANSFORM_TRANSPOSE;
+    } else if (name == "transverse") {
+        t = TRANSFORM_TRANSVERSE;
+    } else if (name == "fliph" || name == "mirror") {
+        t = TRANSFORM_FLIP_H;
+    } else if (name == "flipv" || name == "flip") {
+        t = TRANSFORM_FLIP_V;
+    } else {
+        return false;
+    }
+    return true;
+}
+
+// A saída tem largura h e altura w?
+inline bool transformSwapsAxes(ImageTransform t) {
+    return t == TRANSFORM_ROTATE_90 || t == TRANSFORM_ROTATE_270 || t == TRANSFORM_TRANSPOSE
+        || t == TRANSFORM_TRANSVERSE;
+}
+
+inline bool transformInPlaceCapable(ImageTransform t) {
+    return t == TRANSFORM_FLIP_H || t == TRANSFORM_FLIP_V || t == TRANSFORM_ROTATE_180;
+}
+
+// Lado do ladrilho em pixels: 32 linhas de origem e 32 de destino de até
+// 128 bytes cada ficam no L1 e em 64 páginas no pior caso.
+static const int TRANSFORM_TILE = 32;
+
+// Transposição (com ou sem inversão): o pixel (x, y) da origem vai para a
+// linha x (w-1-x com revRows) e coluna y (h-1-y com revCols) de dst.
+struct TransposeJob {
+    const unsigned char *src;
+    unsigned char *dst;
+    int w, h, channels;
+    bool revRows, revCols;
+
+    const unsigned char *in(int x, int y) const { return src + ((size_t)y * w + x) * channels; }
+    unsigned char *out(int x, int y) const {
+        size_t row = revRows ? w - 1 - x : x;
+        size_t col = revCols ? h - 1 - y : y;
+        return dst + (row * h + col) * channels;
+    }
+};
+
+template <int CH>
+inline void transposeRectScalar(const TransposeJob &job, int x0, int x1, int y0, int y1) {
+    const int ch = CH ? CH : job.channels;
+    // x + 1 está uma linha abaixo (ou acima) na saída
+    const ptrdiff_t step = (job.revRows ? -1 : 1) * (ptrdiff_t)job.h * ch;
+    for (int y = y0; y < y1; y++) {
+        const unsigned char *s = job.in(x0, y);
+        unsigned char *d = job.out(x0, y);
+        for (int x = x0; x < x1; x++, s += ch, d += step) {
+            for (int c = 0; c < ch; c++) d[c] = s[c];
+        }
+    }
+}
+
+// Copia o retângulo [x0, x1) x [y0, y1) da origem (um ladrilho).
+inline void transposeTileScalar(const TransposeJob &job, int x0, int x1, int y0, int y1) {
+    switch (job.channels) {
+        case 1:  transposeRectScalar<1>(job, x0, x1, y0, y1); break;
+        case 3:  transposeRectScalar<3>(job, x0, x1, y0, y1); break;
+        case 4:  transposeRectScalar<4>(job, x0, x1, y0, y1); break;
+        default: transposeRectScalar<0>(job, x0, x1, y0, y1); break;
+    }
+}
+
+// Inverte a ordem dos pixels: dst[i] = src[pixels-1-i] (sem sobreposição).
+template <int CH>
+inline void reversePixelsScalar(const unsigned char *src, unsigned char *dst, size_t pixels, int channels) {
+    const int ch = CH ? CH : channels;
+    const unsigned char *s = src + (pixels - 1) * ch;
+    for (size_t i = 0; i < pixels; i++, s -= ch, dst += ch) {
+        for (int c = 0; c < ch; c++) dst[c] = s[c];
+    }
+}
+
+inline void reverseRowScalar(const unsigned char *src, unsigned char *dst, size_t pixels, int channels) {
+    if (pixels == 0) return;
+    switch (channels) {
+        case 1:  reversePixelsScalar<1>(src, dst, pixels, channels); break;
+        case 3:  reversePixelsScalar<3>(src, dst, pixels, channels); break;
+        case 4:  reversePixelsScalar<4>(src, dst, pixels, channels); break;
+        default: reversePixelsScalar<0>(src, dst, pixels, channels); break;
+    }
+}
+
+#if PG_SIMD_X86
+
+// Primeira coluna do retângulo em que os blocos SIMD deixam de caber: blocos
+// inteiros de B pixels cuja leitura (bytes além do bloco incluídos) não
+// passa do fim da linha.
+inline int transposeSimdEnd(const TransposeJob &job, int x0, int x1, int B, int readPixels) {
+    int end = x0 + (x1 - x0) / B * B;
+    while (end > x0 && end - B + readPixels > job.w) end -= B;
+    return end;
+}
+
+// Grava os 12 bytes baixos de v (quatro pixels RGB).
+PG_TARGET("ssse3")
+inline void storeRgb4(unsigned char *p, __m128i v) {
+    _mm_storel_epi64((__m128i *)p, v);
+    int tail = _mm_cvtsi128_si32(_mm_srli_si128(v, 8));
+    memcpy(p + 8, &tail, 4);
+}
+
+// Bloco 4x4 a partir de (x, y): as linhas são lidas na ordem em que as
+// colunas aparecem na saída, e a transposição 32 bits põe em o[j] os quatro
+// pixels da coluna x+j.
+PG_TARGET("ssse3")
+inline void transposeBlockSSSE3(const TransposeJob &job, int x, int y) {
+    const __m128i expand = _mm_setr_epi8(0, 1, 2, -1, 3, 4, 5, -1, 6, 7, 8, -1, 9, 10, 11, -1);
+    const __m128i pack = _mm_setr_epi8(0, 1, 2, 4, 5, 6, 8, 9, 10, 12, 13, 14, -1, -1, -1, -1);
+    const bool rgb = job.channels == 3;
+    __m128i r[4];
+    for (int i = 0; i < 4; i++) {
+        int yy = job.revCols ? y + 3 - i : y + i;
+        r[i] = _mm_loadu_si128((const __m128i *)job.in(x, yy));
+        if (rgb) r[i] = _mm_shuffle_epi8(r[i], expand);
+    }
+    __m128i t0 = _mm_unpacklo_epi32(r[0], r[1]), t1 = _mm_unpacklo_epi32(r[2], r[3]);
+    __m128i t2 = _mm_unpackhi_epi32(r[0], r[1]), t3 = _mm_unpackhi_epi32(r[2], r[3]);
+    __m128i o[4] = {_mm_unpacklo_epi64(t0, t1), _mm_unpackhi_epi64(t0, t1),
+                    _mm_unpacklo_epi64(t2, t3), _mm_unpackhi_epi64(t2, t3)};
+    int firstY = job.revCols ? y + 3 : y;
+    for (int j = 0; j < 4; j++) {
+        unsigned char *d = job.out(x + j, firstY);
+        if (rgb) {
+            storeRgb4(d, _mm_shuffle_epi8(o[j], pack));
+        } else {
+            _mm_storeu_si128((__m128i *)d, o[j]);
+        }
+    }
+}
+
+// Blocos 4x4 no interior do ladrilho, escalar nas bordas. Só RGB e RGBA;
+// em RGB a leitura de 16 bytes passa 4 bytes do bloco.
+PG_TARGET("ssse3")
+inline void transposeTileSSSE3(const TransposeJob &job, int x0, int x1, int y0, int y1) {
+    if (job.channels != 3 && job.channels != 4) {
+        transposeTileScalar(job, x0, x1, y0, y1);
+        return;
+    }
+    int xEnd = transposeSimdEnd(job, x0, x1, 4, job.channels == 3 ? 6 : 4);
+    int yEnd = y0 + (y1 - y0) / 4 * 4;
+    for (int y = y0; y < yEnd; y += 4) {
+        for (int x = x0; x < xEnd; x += 4) transposeBlockSSSE3(job, x, y);
+    }
+    if (xEnd < x1) transposeTileScalar(job, xEnd, x1, y0, y1);
+    if (yEnd < y1) transposeTileScalar(job, x0, xEnd, yEnd, y1);
+}
+
+// Bloco 8x8: cada linha tem os pixels x..x+3 na metade baixa e x+4..x+7 na
+// alta; unpack 32/64 transpõe 4x4 dentro de cada metade e permute2x128
+// junta as metades das linhas 0-3 e 4-7.
+PG_TARGET("avx2")
+inline void transposeBlockAVX2(const TransposeJob &job, int x, int y) {
+    const __m256i expand = _mm256_setr_epi8(0, 1, 2, -1, 3, 4, 5, -1, 6, 7, 8, -1, 9, 10, 11, -1,
+                                            0, 1, 2, -1, 3, 4, 5, -1, 6, 7, 8, -1, 9, 10, 11, -1);
+    const __m256i pack = _mm256_setr_epi8(0, 1, 2, 4, 5, 6, 8, 9, 10, 12, 13, 14, -1, -1, -1, -1,
+                                          0, 1, 2, 4, 5, 6, 8, 9, 10, 12, 13, 14, -1, -1, -1, -1);
+    const __m256i join = _mm256_setr_epi32(0, 1, 2, 4, 5, 6, 3, 7);
+    const bool rgb = job.channels == 3;
+    __m256i r[8];
+    for (int i = 0; i < 8; i++) {
+        const unsigned char *s = job.in(x, job.revCols ? y + 7 - i : y + i);
+        if (rgb) {
+            __m128i lo = _mm_loadu_si128((const __m128i *)s);
+            __m128i hi = _mm_loadu_si128((const __m128i *)(s + 12));
+            r[i] = _mm256_shuffle_epi8(_mm256_inserti128_si256(_mm256_castsi128_si256(lo), hi, 1), expand);
+        } else {
+            r[i] = _mm256_loadu_si256((const __m256i *)s);
+        }
+    }
+    __m256i u[8];
+    for (int i = 0; i < 8; i += 4) {
+        __m256i t0 = _mm256_unpacklo_epi32(r[i], r[i + 1]), t1 = _mm256_unpackhi_epi32(r[i], r[i + 1]);
+        __m256i t2 = _mm256_unpacklo_epi32(r[i + 2], r[i + 3]), t3 = _mm256_unpackhi_epi32(r[i + 2], r[i + 3]);
+        u[i]     = _mm256_unpacklo_epi64(t0, t2);
+        u[i + 1] = _mm256_unpackhi_epi64(t0, t2);
+        u[i + 2] = _mm256_unpacklo_epi64(t1, t3);
+        u[i + 3] = _mm256_unpackhi_epi64(t1, t3);
+    }
+    int firstY = job.revCols ? y + 7 : y;
+    for (int j = 0; j < 4; j++) {
+        __m256i o[2] = {_mm256_permute2x128_si256(u[j], u[j + 4], 0x20),
+                        _mm256_permute2x128_si256(u[j], u[j + 4], 0x31)};
+        for (int k = 0; k < 2; k++) {
+            unsigned char *d = job.out(x + j + 4 * k, firstY);
+            if (rgb) {
+                __m256i v = _mm256_permutevar8x32_epi32(_mm256_shuffle_epi8(o[k], pack), join);
+                _mm_storeu_si128((__m128i *)d, _mm256_castsi256_si128(v));
+                _mm_storel_epi64((__m128i *)(d + 16), _mm256_extracti128_si256(v, 1));
+            } else {
+                _mm256_storeu_si256((__m256i *)d, o[k]);
+            }
+        }
+    }
+}
+
+PG_TARGET("avx2")
+inline void transposeTileAVX2(const TransposeJob &job, int x0, int x1, int y0, int y1) {
+    if (job.channels != 3 && job.channels != 4) {
+        transposeTileScalar(job, x0, x1, y0, y1);
+        return;
+    }
+    int xEnd = transposeSimdEnd(job, x0, x1, 8, job.channels == 3 ? 10 : 8);
+    int yEnd = y0 + (y1 - y0) / 8 * 8;
+    for (int y = y0; y < yEnd; y += 8) {
+        for (int x = x0; x < xEnd; x += 8) transposeBlockAVX2(job, x, y);
+    }
+    // sobras de 4 colunas ou 4 linhas ainda vão em blocos 4x4
+    if (xEnd < x1) transposeTileSSSE3(job, xEnd, x1, y0, y1);
+    if (yEnd < y1) transposeTileSSSE3(job, x0, xEnd, yEnd, y1);
+}
+
+// Quatro pixels RGB por vez, de trás para a frente. A leitura começa 4 bytes
+// antes do bloco (nunca depois do fim da linha); o laço para com pelo menos
+// dois pixels sobrando no começo da origem, que vão no escalar.
+PG_TARGET("ssse3")
+inline void reverseRowSSSE3(const unsigned char *src, unsigned char *dst, size_t pixels, int channels) {
+    size_t i = 0;
+    if (channels == 3) {
+        const __m128i rev = _mm_setr_epi8(13, 14, 15, 10, 11, 12, 7, 8, 9, 4, 5, 6, -1, -1, -1, -1);
+        for (; i + 6 <= pixels; i += 4) {
+            __m128i v = _mm_loadu_si128((const __m128i *)(src + (pixels - 4 - i) * 3 - 4));
+            storeRgb4(dst + i * 3, _mm_shuffle_epi8(v, rev));
+        }
+    } else if (channels == 4) {
+        for (; i + 4 <= pixels; i += 4) {
+            __m128i v = _mm_loadu_si128((const __m128i *)(src + (pixels - 4 - i) * 4));
+            _mm_storeu_si128((__m128i *)(dst + i * 4), _mm_shuffle_epi32(v, 0x1B));
+        }
+    } else if (channels == 1) {
+        const __m128i rev = _mm_setr_epi8(15, 14, 13, 12, 11, 10, 9, 8, 7, 6, 5, 4, 3, 2, 1, 0);
+        for (; i + 16 <= pixels; i += 16) {
+            __m128i v = _mm_loadu_si128((const __m128i *)(src + pixels - 16 - i));
+            _mm_storeu_si128((__m128i *)(dst + i), _mm_shuffle_epi8(v, rev));
+        }
+    }
+    if (i < pixels) reverseRowScalar(src, dst + i * channels, pixels - i, channels);
+}
+
+// Oito pixels RGB: cada metade inverte quatro (a baixa os últimos, a alta
+// os anteriores) e permutevar junta os 24 bytes.
+PG_TARGET("avx2")
+inline void reverseRowAVX2(const unsigned char *src, unsigned char *dst, size_t pixels, int channels) {
+    size_t i = 0;
+    if (channels == 3) {
+        const __m256i rev = _mm256_setr_epi8(13, 14, 15, 10, 11, 12, 7, 8, 9, 4, 5, 6, -1, -1, -1, -1,
+                                             13, 14, 15, 10, 11, 12, 7, 8, 9, 4, 5, 6, -1, -1, -1, -1);
+        const __m256i join = _mm256_setr_epi32(0, 1, 2, 4, 5, 6, 3, 7);
+        for (; i + 10 <= pixels; i += 8) {
+            __m128i lo = _mm_loadu_si128((const __m128i *)(src + (pixels - 4 - i) * 3 - 4));
+            __m128i hi = _mm_loadu_si128((const __m128i *)(src + (pixels - 8 - i) * 3 - 4));
+            __m256i v = _mm256_inserti128_si256(_mm256_castsi128_si256(lo), hi, 1);
+            v = _mm256_permutevar8x32_epi32(_mm256_shuffle_epi8(v, rev), join);
+            _mm_storeu_si128((__m128i *)(dst + i * 3), _mm256_castsi256_si128(v));
+            _mm_storel_epi64((__m128i *)(dst + i * 3 + 16), _mm256_extracti128_si256(v, 1));
+        }
+    } else if (channels == 4) {
+        const __m256i rev = _mm256_setr_epi32(7, 6, 5, 4, 3, 2, 1, 0);
+        for (; i + 8 <= pixels; i += 8) {
+            __m256i v = _mm256_loadu_si256((const __m256i *)(src + (pixels - 8 - i) * 4));
+            _mm256_storeu_si256((__m256i *)(dst + i * 4), _mm256_permutevar8x32_epi32(v, rev));
+        }
+    }
+    if (i < pixels) reverseRowSSSE3(src, dst + i * channels, pixels - i, channels);
+}
+
+#endif /* PG_SIMD_X86 */
+
+typedef void (*TransposeKernel)(const TransposeJob &job, int x0, int x1, int y0, int y1);
+typedef void (*ReverseKernel)(const unsigned char *src, unsigned char *dst, size_t pixels, int channels);
+
+// Não há versões AVX-512: os blocos 8x8 já gravam linhas de 24/32 bytes e a
+// cópia fica limitada pela memória.
+inline TransposeKernel transposeKernelFor(SimdLevel level) {
+#if PG_SIMD_X86
+    switch (level) {
+        case SIMD_AVX512:
+        case SIMD_AVX2:   return transposeTileAVX2;
+        case SIMD_SSSE3:  return transposeTileSSSE3;
+        default:          break;
+    }
+#else
+    (void)level;
+#endif
+    return transposeTileScalar;
+}
+
+inline ReverseKernel reverseKernelFor(SimdLevel level) {
+#if PG_SIMD_X86
+    switch (level) {
+        case SIMD_AVX512:
+        case SIMD_AVX2:   return reverseRowAVX2;
+        case SIMD_SSSE3:  return reverseRowSSSE3;
+        default:          break;
+    }
+#else
+    (void)level;
+#endif
+    return reverseRowScalar;
+}
+
+// Transposições: as faixas são de linhas da saída (colunas da origem), e
+// cada faixa anda pela origem em ladrilhos, de cima para baixo.
+inline void transposeImage(const TransposeJob &job, TransposeKernel kernel, ThreadPool &pool) {
+    parallelRows(job.h, job.w, job.channels, [&](int r0, int r1) {
+        int x0 = job.revRows ? job.w - r1 : r0;
+        int x1 = job.revRows ? job.w - r0 : r1;
+        for (int ty = 0; ty < job.h; ty += TRANSFORM_TILE) {
+            int ty1 = min(ty + TRANSFORM_TILE, job.h);
+            for (int tx = x0; tx < x1; tx += TRANSFORM_TILE) kernel(job, tx, min(tx + TRANSFORM_TILE, x1), ty, ty1);
+        }
+    }, pool);
+}
+
+// src (w x h) -> dst, que tem h x w pixels quando transformSwapsAxes(t).
+// src e dst não podem se sobrepor.
+inline void transformImage(const unsigned char *src, int w, int h, int channels, ImageTransform t,
+                           unsigned char *dst, TransposeKernel transpose, ReverseKernel reverse,
+                           ThreadPool &pool = ThreadPool::shared()) {
+    if (w <= 0 || h <= 0) return;
+    size_t rowBytes = (size_t)w * channels;
+    if (transformSwapsAxes(t)) {
+        TransposeJob job = {src, dst, w, h, channels, t == TRANSFORM_ROTATE_270 || t == TRANSFORM_TRANSVERSE,
+                            t == TRANSFORM_ROTATE_90 || t == TRANSFORM_TRANSVERSE};
+        transposeImage(job, transpose, pool);
+        return;
+    }
+    parallelRows(w, h, channels, [&](int y0, int y1) {
+        for (int y = y0; y < y1; y++) {
+            unsigned char *d = dst + y * rowBytes;
+            switch (t) {
+                case TRANSFORM_FLIP_V:     memcpy(d, src + (h - 1 - y) * rowBytes, rowBytes); break;
+                case TRANSFORM_FLIP_H:     reverse(src + y * rowBytes, d, w, channels); break;
+                case TRANSFORM_ROTATE_180: reverse(src + (h - 1 - y) * rowBytes, d, w, channels); break;
+                default:                   break;
+            }
+        }
+    }, pool);
+}
+
+inline void transformImage(const unsigned char *src, int w, int h, int channels, ImageTransform t,
+                           unsigned char *dst) {
+    static const TransposeKernel transpose = transposeKernelFor(activeSimdLevel());
+    static const ReverseKernel reverse = reverseKernelFor(activeSimdLevel());
+    transformImage(src, w, h, channels, t, dst, transpose, reverse);
+}
+
+// Espelhamentos e 180 graus no próprio buffer: as linhas y e h-1-y são
+// trocadas (e invertidas) passando uma delas por uma cópia de uma linha.
+// Devolve false para as transformações que trocam os eixos.
+inline bool transformInPlace(unsigned char *data, int w, int h, int channels, ImageTransform t,
+                             ReverseKernel reverse, ThreadPool &pool = ThreadPool::shared()) {
+    if (!transformInPlaceCapable(t)) return false;
+    if (w <= 0 || h <= 0) return true;
+    size_t rowBytes = (size_t)w * channels;
+    int rows = t == TRANSFORM_FLIP_H ? h : (h + 1) / 2;
+    parallelRows(w, rows, channels * 2, [&](int y0, int y1) {
+        vector<unsigned char> tmp(rowBytes);
+        for (int y = y0; y < y1; y++) {
+            unsigned char *a = data + y * rowBytes;
+            unsigned char *b = data + (h - 1 - y) * rowBytes;
+            memcpy(tmp.data(), a, rowBytes);
+            if (t == TRANSFORM_FLIP_H || a == b) {
+                // a linha do meio gira 180 graus sozinha; no vertical fica
+                if (t != TRANSFORM_FLIP_V) reverse(tmp.data(), a, w, channels);
+            } else if (t == TRANSFORM_FLIP_V) {
+                memcpy(a, b, rowBytes);
+                memcpy(b, tmp.data(), rowBytes);
+            } else {
+                reverse(b, a, w, channels);
+                reverse(tmp.data(), b, w, channels);
+            }
+        }
+    }, pool);
+    return true;
+}
+
+inline bool transformInPlace(unsigned char *data, int w, int h, int channels, ImageTransform t) {
+    static const ReverseKernel reverse = reverseKernelFor(activeSimdLevel());
+    return transformInPlace(data, w, h, channels, t, reverse);
+}
+
+// Aplica t a img: no próprio buffer quando dá, senão numa cópia vinda do
+// pool que toma o lugar de img.
+inline void transformBuffer(ImageBuffer &img, ImageTransform t) {
+    int w = img.getWidth(), h = img.getHeight(), ch = img.getChannels();
+    if (transformInPlace(img.data(), w, h, ch, t)) return;
+    ImageBuffer out = ImagePool::shared().acquire(h, w, ch);
+    transformImage(img.data(), w, h, ch, t, out.data());
+    img = std::move(out);
+}
+
+#endif /* Transform_h */
@@ -6,65 +6,42 @@
 #include <sstream>
 #include <math.h>
 
+#define STB_IMAGE_IMPLEMENTATION
+#include "ImageIO.h"
+#include "PpmIO.h"
+#include "GrayScale.h"
+#include "ChromaKey.h"
+#include "SoftKey.h"
+#include "ThreadPool.h"
+#include "FilterChain.h"
+#include "Blur.h"
+#include "CubeLut.h"
+#include "Resize.h"
+#include "Transform.h"
+#include "ColorSpace.h"
+#include "Dither.h"
+#include "Batch.h"
+#include <vector>
+
 using namespace std;
 
-unsigned char *open(string file, int &width, int &height) {
-    ifstream arq(file);
-    char BUFFER[1024];
-    arq.getline(BUFFER, 1024);
-    char type = BUFFER[1];
-    cout << BUFFER << endl;
-    do {
-        arq.getline(BUFFER, 1024);
-        cout << "." << BUFFER << "." << endl;
-    } while (BUFFER[0] == '#');
-    stringstream sstr(BUFFER);
-    int w;
-    int h;
-    sstr >> w;
-    sstr >> h;
-    width = w;
-    height = h;
-    int maxValue;
-    arq >> maxValue;
-    cout << w << " X " << h << " mv: " << maxValue << endl; 
-    unsigned char *data = new unsigned char [w * h * 3];
-    if (type == '3') {
-        // modo texto
-        int j=0;
-        while (!arq.eof()) {
-            int g;
-            arq >> g;
-            data[j++] = (unsigned char)g;
-        }
-    } else { 
-        // modo binário
-        arq.read(reinterpret_cast<char*> (&data), sizeof(data));
+bool open(string file, ImageBuffer &image) {
+    // PPM: lê o arquivo inteiro de uma vez, P3 convertido em paralelo com
+    // from_chars; PNG, JPEG, TGA...: decodificado pela stb_image
+    if (!loadImage(file, image)) {
+        return false;
     }
-    arq.close();
-    return data;
-}
-
-void save(string file, unsigned char *data, int &w, int &h) {
-    ofstream arq(file);
-    arq << "P3" << endl;
-    arq << "#Gerado por chroma-key." << endl;
-    arq << w << " " << h << endl << "255" << endl;
-    int length = w * h * 3;
-    for (int i = 0; i < length; i++) {
-        arq << (int)data[i] << endl;
-    }    
-    arq.close();
+    cout << image.getWidth() << " X " << image.getHeight() << endl;
+    return true;
 }
 
-double dist(int &r1, int &g1, int &b1, int &r2, int &g2, int &b2) {
-    double r = r1 - r2;
-    double g = g1 - g2;
-    double b = b1 - b2;
-    return sqrt(r*r + g*g + b*b);
+// binary: P6 (padrão) ou P3 em texto
+void save(string file, unsigned char *data, int &w, int &h, bool binary = true) {
+    savePPM(file, data, w, h, binary);
 }
 
-void chromaKey(unsigned char *data, int w, int h) {
+// mask (opcional): recebe 255 nos pixels chaveados, na mesma passada do filtro
+void chromaKey(unsigned char *data, int w, int h, unsigned char *mask = nullptr) {
     int r, g, b;
     cout << "Cor-chave: " << endl;
     cout << "\tR: ";
@@ -79,20 +56,30 @@ void chromaKey(unsigned char *data, int w, int h) {
     cin >> t;
     
 
-    double dmax = 441.6729559301;
-
-    int length = w * h * 3;
-    for (int i = 0; i < length; i += 3) {
-        int ri = data[i] & 0xff;
-        int gi = data[i+1] & 0xff;
-        int bi = data[i+2] & 0xff;
-        double d = dist(r, g, b, ri, gi, bi);
-        if (d/dmax < t) {
-            data[i] = 0;
-            data[i+1] = 0;
-            data[i+2] = 0;
-        }
-    }
+    // d/dmax < t vira uma comparação inteira de d^2 com um limiar pré-calculado
+    ChromaKeyColor key = chromaKeyColor(r, g, b, t);
+    parallelPixels(data, w, h, [&](unsigned char *band, size_t pixels, size_t first) {
+        chromaKeyFixed(band, pixels, key, mask ? mask + first : nullptr);
+    });
+}
+
+// Chroma-key suave: alfa entre as tolerâncias interna e externa, vazamento
+// da cor-chave removido do primeiro plano; RGBA numa passada só.
+void softChromaKey(const unsigned char *data, int w, int h, ImageBuffer &rgba) {
+    int r, g, b;
+    cout << "Cor-chave: " << endl;
+    cout << "\tR: ";
+    cin >> r;
+    cout << "\tG: ";
+    cin >> g;
+    cout << "\tB: ";
+    cin >> b;
+    double inner, outer, spill;
+    cout << "Tolerâncias interna e externa (0..1): ";
+    cin >> inner >> outer;
+    cout << "Supressão de vazamento (0..1): ";
+    cin >> spill;
+    softKeyRgba(data, w, h, softKey(r, g, b, inner, outer, spill), rgba);
 }
 
 void grayScale(unsigned char *data, int w, int h) {
@@ -108,52 +95,176 @@ void grayScale(unsigned char *data, int w, int h) {
         bw = 0.0721;
     }
 
-    int length = w * h * 3;
-    for (int i = 0; i < length; i += 3) {
-        int ri = data[i] & 0xff;
-        int gi = data[i+1] & 0xff;
-        int bi = data[i+2] & 0xff;
+    // pesos em ponto fixo; o kernel SIMD é escolhido conforme a CPU
+    LumaWeights lw = lumaWeights(rw, gw, bw);
+    parallelPixels(data, w, h, [&](unsigned char *band, size_t pixels, size_t) {
+        grayScaleFixed(band, pixels, lw);
+    });
+}
+
+// Tinge mantendo a luminosidade de cada pixel (colorize em HSL, em ponto
+// fixo: ColorSpace.h).
+void colorize(unsigned char *data, int w, int h) {
+    double hue, sat;
+    cout << "Matiz (graus, 0 = vermelho, 120 = verde, 240 = azul): ";
+    cin >> hue;
+    cout << "Saturação (0..1): ";
+    cin >> sat;
+    sat = sat < 0 ? 0 : (sat > 1 ? 1 : sat);
+    applyTint(data, w, h, tint(hue, sat));
+}
+
+void negative(unsigned char *data, int w, int h) {
+    parallelPixels(data, w, h, [](unsigned char *band, size_t pixels, size_t) {
+        size_t length = pixels * 3;
+        for (size_t i = 0; i < length; i += 3) {
+            int ri = band[i] & 0xff;
+            int gi = band[i+1] & 0xff;
+            int bi = band[i+2] & 0xff;
 
-        data[i] = data[i+1] = data[i+2] = (int)(ri * rw + gi * gw + bi * bw);
+            band[i]   = ri ^ 255;
+            band[i+1] = gi ^ 255;
+            band[i+2] = bi ^ 255;
+        }
+    });
+}
+
+// Estica cada canal para 0..255 a partir do histograma da própria imagem.
+void autoLevels(unsigned char *data, int w, int h) {
+    double clip;
+    cout << "Fração de pixels descartada em cada ponta (0..0.5, ex.: 0.005): ";
+    cin >> clip;
+    FilterChain filters;
+    filters.addHistogramStage(FilterStage::AUTO_LEVELS, clip);
+    filters.apply(data, w, h);
+}
+
+void equalize(unsigned char *data, int w, int h) {
+    FilterChain filters;
+    filters.addHistogramStage(FilterStage::EQUALIZE);
+    filters.apply(data, w, h);
+}
+
+// Gaussiano (por sigma) ou de caixa (por raio); duas passadas 1D com SIMD e threads
+// (caixa de raio grande: média por tabela de somas, custo fixo por pixel).
+void blur(unsigned char *data, int w, int h) {
+    cout << "Gaussiano (G) ou caixa (C)? ";
+    char op;
+    cin >> op;
+    if ((op == 'C') || (op == 'c')) {
+        int r;
+        cout << "Raio (pixels): ";
+        cin >> r;
+        boxBlur(data, w, h, r);
+    } else {
+        double sigma;
+        cout << "Sigma (pixels): ";
+        cin >> sigma;
+        gaussianBlur(data, w, h, sigma);
     }
 }
 
-void colorize(unsigned char *data, int w, int h) {
-    int r, g, b;
-    cout << "Cor de base: " << endl;
-    cout << "\tR: ";
-    cin >> r;
-    cout << "\tG: ";
-    cin >> g;
-    cout << "\tB: ";
-    cin >> b;
-    
-    int length = w * h * 3;
-    for (int i = 0; i < length; i += 3) {
-        int ri = data[i] & 0xff;
-        int gi = data[i+1] & 0xff;
-        int bi = data[i+2] & 0xff;
-
-        data[i]   = ri | r;
-        data[i+1] = gi | g;
-        data[i+2] = bi | b;
+// LUT 3D de um arquivo .cube (17^3, 33^3, 65^3...), interpolação tetraédrica.
+bool cubeLut(unsigned char *data, int w, int h) {
+    string path;
+    cout << "Arquivo .cube: ";
+    cin >> ws;
+    getline(cin, path);
+    CubeLut lut;
+    string error;
+    if (!lut.load(path, error)) {
+        cout << "LUT inválida: " << error << endl;
+        return false;
     }
+    applyCubeLut(data, w, h, lut);
+    return true;
 }
 
-void negative(unsigned char *data, int w, int h) {
-    int length = w * h * 3;
-    for (int i = 0; i < length; i += 3) {
-        int ri = data[i] & 0xff;
-        int gi = data[i+1] & 0xff;
-        int bi = data[i+2] & 0xff;
-
-        data[i]   = ri ^ 255;
-        data[i+1] = gi ^ 255;
-        data[i+2] = bi ^ 255;
+// Nova largura e altura (uma delas 0 mantém a proporção); o resultado vai
+// para out, e data/w/h passam a apontar para ele.
+bool resize(unsigned char *&data, int &w, int &h, ImageBuffer &out) {
+    int nw, nh;
+    string name;
+    cout << "Nova largura e altura (0 mantém a proporção): ";
+    cin >> nw >> nh;
+    cout << "Filtro (box, bilinear, lanczos3): ";
+    cin >> name;
+    ResizeFilter filter;
+    if (!parseResizeFilter(name, filter) || nw < 0 || nh < 0 || !resizeTarget(w, h, nw, nh)) {
+        cout << "Tamanho ou filtro inválido" << endl;
+        return false;
+    }
+    out = ImagePool::shared().acquire(nw, nh);
+    resizeImage(data, w, h, out.data(), nw, nh, 3, filter);
+    data = out.data();
+    w = nw;
+    h = nh;
+    return true;
+}
+
+// Giro ou espelhamento; os espelhamentos e o 180 ficam no próprio buffer,
+// os demais vão para out, e data/w/h passam a apontar para ele.
+bool transform(unsigned char *&data, int &w, int &h, ImageBuffer &out) {
+    string name;
+    cout << "Transformação (rot90, rot180, rot270, transpose, transverse, fliph, flipv): ";
+    cin >> name;
+    ImageTransform t;
+    if (!parseImageTransform(name, t)) {
+        cout << "Transformação inválida" << endl;
+        return false;
     }
+    if (transformInPlace(data, w, h, 3, t)) return true;
+    out = ImagePool::shared().acquire(h, w);
+    transformImage(data, w, h, 3, t, out.data());
+    data = out.data();
+    swap(w, h);
+    return true;
 }
 
-int main() {
+// Paleta de poucas cores tirada da própria imagem (median-cut, refinada ou
+// não por k-means) e difusão de erro em frente de onda (Dither.h).
+bool reduceColors(unsigned char *data, int w, int h) {
+    int colors;
+    string method, dither;
+    cout << "Número de cores (2..256): ";
+    cin >> colors;
+    cout << "Paleta (mediancut, kmeans): ";
+    cin >> method;
+    cout << "Difusão de erro (fs, atkinson, none): ";
+    cin >> dither;
+    PaletteMethod pm;
+    DitherMethod dm;
+    if (colors < 2 || colors > 256 || !parsePaletteMethod(method, pm) || !parseDitherMethod(dither, dm)) {
+        cout << "Paleta ou difusão inválida" << endl;
+        return false;
+    }
+    Palette pal = buildPalette(data, (size_t)w * h, colors, pm);
+    ditherImage(data, w, h, pal, dm);
+    return true;
+}
+
+// Vários filtros numa passada só, por exemplo: grayscale | colorize(40,0,80) | negative
+bool chain(unsigned char *data, int w, int h, unsigned char *mask) {
+    cout << "Cadeia (chromakey(r,g,b,t) | grayscale[(s)] | colorize(r,g,b) | negative | autolevels[(f)] | equalize | blur(sigma) | boxblur(r) | lut3d(arquivo) | huesat(graus,fator) | tint(graus,sat)): ";
+    string spec;
+    cin >> ws;
+    getline(cin, spec);
+    FilterChain filters;
+    string error;
+    if (!filters.parse(spec, error)) {
+        cout << "Cadeia inválida: " << error << endl;
+        return false;
+    }
+    filters.apply(data, w, h, mask);
+    return true;
+}
+
+int main(int argc, char **argv) {
+    // com argumentos roda em lote, sem perguntas (ver batchUsage em Batch.h)
+    if (argc > 1) {
+        return batchMain(argc, argv);
+    }
+
     string file;
     
     // AQUI PRA LER DO USUÁRIO O NOME DO ARQUIVO
@@ -162,26 +273,74 @@ int main() {
     file = "../src/ExemplosMoodle/M3_material/M3_exemplo1.ppm";
 
     int w, h;
-    unsigned char *data = open(file, w, h);
+    unsigned char *data;
+    // P6 é mapeado em copy-on-write: os filtros trabalham direto sobre os pixels
+    // mapeados e o arquivo de entrada não é alterado
+    MappedImage mapped;
+    ImageBuffer image;
+    if (openMapped(file, mapped)) {
+        data = mapped.pixels;
+        w = mapped.width;
+        h = mapped.height;
+    } else {
+        if (!open(file, image)) {
+            return EXIT_FAILURE;
+        }
+        data = image.data();
+        w = image.getWidth();
+        h = image.getHeight();
+    }
     // cout << ((int)data[0]) << "..." << ((int)data[w * h * 3 - 1]) << endl;
 
 
     int opt;
-    cout << "Qual opção de filtro você quer aplicar (1-chroma-key, 2-gray-scale, 3-colorize, 4-negative)? ";
+    vector<unsigned char> mask;
+    ImageBuffer resized, rgba;
+    cout << "Qual opção de filtro você quer aplicar (1-chroma-key, 2-gray-scale, 3-colorize, 4-negative, 5-cadeia, 6-auto-levels, 7-equalização, 8-desfoque, 9-LUT 3D, 10-redimensionar, 11-chroma-key suave, 12-girar/espelhar, 13-reduzir cores)? ";
     cin >> opt;
 
     switch(opt) {
-        case 1:  chromaKey(data, w, h); break;
+        case 1:
+            mask.resize((size_t)w * h);
+            chromaKey(data, w, h, mask.data());
+            break;
         case 2:  grayScale(data, w, h); break;
         case 3:  colorize(data, w, h);  break;
         case 4:  negative(data, w, h);  break;
-        default: cout << "Opção inválida!!";
+        case 5:
+            mask.resize((size_t)w * h);
+            if (!chain(data, w, h, mask.data())) opt = 0;
+            break;
+        case 6:  autoLevels(data, w, h); break;
+        case 7:  equalize(data, w, h);   break;
+        case 8:  blur(data, w, h);       break;
+        case 9:
+            if (!cubeLut(data, w, h)) opt = 0;
+            break;
+        case 10:
+            if (!resize(data, w, h, resized)) opt = 0;
+            break;
+        case 11: softChromaKey(data, w, h, rgba); break;
+        case 12:
+            if (!transform(data, w, h, resized)) opt = 0;
+            break;
+        case 13:
+            if (!reduceColors(data, w, h)) opt = 0;
+            break;
+        default:
+            cout << "Opção inválida!!";
+            opt = 0;
     }
 
-    if ((opt > 0) && (opt < 5)){
+    if ((opt > 0) && (opt != 11)){
         save("../src/ExemplosMoodle/M3_material/output.ppm", data, w, h);
     }
-    
-    delete [] data;
+    if (opt == 11) {
+        // RGBA com o alfa: PAM (P7)
+        savePAM("../src/ExemplosMoodle/M3_material/output.pam", rgba.data(), w, h);
+    }
+    if ((opt > 0) && !mask.empty()) {
+        savePGM("../src/ExemplosMoodle/M3_material/output_mask.pgm", mask.data(), w, h);
+    }
     return EXIT_SUCCESS;
 }
@@ -0,0 +1,732 @@
+//
+//  exemplo_03_bench
+//  Micro-benchmarks do exemplo_03: leitores de PPM e cada filtro sobre imagens
+//  sintéticas de tamanhos que cabem no L1, no L2 ou só na DRAM, nas versões
+//  escalar, SIMD e com threads. Com --gpu compara também a cadeia na GPU
+//  (envio, shader e leitura de volta) com a mesma cadeia na CPU.
+//
+//  Uso: exemplo_03_bench [-r repetições] [-s L1|L2|DRAM] [-f filtro] [--gpu] [arquivo.ppm]
+//
+
+#include <iostream>
+#include <string>
+#include <stdio.h>
+#include <stdlib.h>
+#include <fstream>
+#include <sstream>
+#include <chrono>
+#include <algorithm>
+#include <vector>
+#include <random>
+#include <functional>
+
+#include "PpmIO.h"
+#include "GrayScale.h"
+#include "ChromaKey.h"
+#include "SoftKey.h"
+#include "FilterChain.h"
+#include "ThreadPool.h"
+#include "PlanarImage.h"
+#include "Histogram.h"
+#include "Blur.h"
+#include "CubeLut.h"
+#include "Resize.h"
+#include "Transform.h"
+#include "ColorSpace.h"
+#include "Dither.h"
+#include "ImageBuffer.h"
+#include "ImageCompare.h"
+#include "GpuFilters.h"
+
+using namespace std;
+
+// Leitor original do exemplo_03 (istream, um inteiro por vez), mantido aqui
+// só como referência de comparação.
+unsigned char *openIostream(string file, int &width, int &height) {
+    ifstream arq(file);
+    char BUFFER[1024];
+    arq.getline(BUFFER, 1024);
+    do {
+        arq.getline(BUFFER, 1024);
+    } while (BUFFER[0] == '#');
+    stringstream sstr(BUFFER);
+    int w;
+    int h;
+    sstr >> w;
+    sstr >> h;
+    width = w;
+    height = h;
+    int maxValue;
+    arq >> maxValue;
+    int length = w * h * 3;
+    unsigned char *data = new unsigned char [length];
+    int j = 0;
+    int g;
+    while (j < length && arq >> g) {
+        data[j++] = (unsigned char)g;
+    }
+    return data;
+}
+
+struct Timing {
+    double median; // ms por chamada
+    double p95;
+};
+
+// warmup chamadas descartadas e depois reps amostras. Cada amostra repete f
+// até passar de ~2 ms, para imagens pequenas não ficarem abaixo da resolução
+// do relógio; o tempo por chamada é a média dentro da amostra.
+template <typename F>
+Timing measure(int warmup, int reps, F f) {
+    for (int i = 0; i < warmup; i++) f();
+    int inner = 1;
+    for (;;) {
+        auto t0 = chrono::steady_clock::now();
+        for (int i = 0; i < inner; i++) f();
+        double ms = chrono::duration<double, milli>(chrono::steady_clock::now() - t0).count();
+        if (ms >= 2.0 || inner >= (1 << 20)) break;
+        inner *= 2;
+    }
+    vector<double> t;
+    for (int r = 0; r < reps; r++) {
+        auto t0 = chrono::steady_clock::now();
+        for (int i = 0; i < inner; i++) f();
+        t.push_back(chrono::duration<double, milli>(chrono::steady_clock::now() - t0).count() / inner);
+    }
+    sort(t.begin(), t.end());
+    Timing tm;
+    tm.median = t[t.size() / 2];
+    tm.p95 = t[(t.size() * 95 + 99) / 100 - 1];
+    return tm;
+}
+
+void reportIO(const string &name, Timing t, double bytes) {
+    printf("%-28s %10.2f ms (p95 %8.2f) %10.3f GB/s\n", name.c_str(), t.median, t.p95, bytes / (t.median * 1e-3) / 1e9);
+}
+
+void benchLoaders(const string &file, int reps) {
+    vector<char> raw;
+    if (!readWholeFile(file, raw)) {
+        cout << "(leitura de PPM não medida: " << file << " não encontrado)" << endl;
+        return;
+    }
+    double bytes = (double)raw.size();
+    cout << "== Leitura P3: " << file << " (" << raw.size() << " bytes)" << endl;
+
+    int w, h;
+    unsigned char *ref = openIostream(file, w, h);
+    size_t length = (size_t)w * h * 3;
+
+    reportIO("iostream (original)", measure(1, reps, [&]() {
+        int ww, hh;
+        delete [] openIostream(file, ww, hh);
+    }), bytes);
+
+    unsigned int hw = thread::hardware_concurrency();
+    vector<unsigned int> threadCounts = {1};
+    if (hw > 1) threadCounts.push_back(hw);
+    for (unsigned int n : threadCounts) {
+        ImageBuffer img;
+        bool same = loadPPM(file, img, n) && equal(ref, ref + length, img.data());
+        reportIO("from_chars " + to_string(n) + " thread(s)" + (same ? "" : " DIFERENTE"), measure(1, reps, [&]() {
+            loadPPM(file, img, n);
+        }), bytes);
+    }
+    delete [] ref;
+}
+
+// Imagem RGB com ruído uniforme, sempre a mesma para a mesma semente.
+vector<unsigned char> syntheticImage(int w, int h, unsigned int seed = 42) {
+    vector<unsigned char> img((size_t)w * h * 3);
+    mt19937 rng(seed);
+    for (unsigned char &c : img) c = (unsigned char)rng();
+    return img;
+}
+
+struct BenchSize {
+    const char *name;
+    int w, h;
+};
+
+// 4,5 KiB, 120 KiB e ~100 MiB de pixels
+const BenchSize SIZES[] = {
+    {"L1", 48, 32},
+    {"L2", 256, 160},
+    {"DRAM", 7680, 4320},
+};
+
+typedef function<void(unsigned char *data, int w, int h)> FilterRun;
+
+struct Variant {
+    string name;
+    FilterRun run;
+};
+
+struct FilterBench {
+    string name;
+    vector<Variant> variants; // a primeira é a referência
+};
+
+// Laços originais do exemplo_03, sem threads, como referência.
+void colorizeLoop(unsigned char *data, int w, int h, int r, int g, int b) {
+    size_t length = (size_t)w * h * 3;
+    for (size_t i = 0; i < length; i += 3) {
+        data[i] |= r;
+        data[i+1] |= g;
+        data[i+2] |= b;
+    }
+}
+
+void negativeLoop(unsigned char *data, int w, int h) {
+    size_t length = (size_t)w * h * 3;
+    for (size_t i = 0; i < length; i++) data[i] ^= 255;
+}
+
+// Histograma com um contador por valor, sem threads, como referência.
+Histogram histogramLoop(const unsigned char *data, size_t pixels) {
+    Histogram h;
+    for (size_t i = 0; i < pixels; i++) {
+        h.bins[0][data[i * 3]]++;
+        h.bins[1][data[i * 3 + 1]]++;
+        h.bins[2][data[i * 3 + 2]]++;
+    }
+    return h;
+}
+
+volatile uint64_t histogramSink;
+
+uint64_t sumBins(const Histogram &h) {
+    uint64_t s = 0;
+    for (int c = 0; c < 3; c++) {
+        for (int v = 0; v < 256; v++) s += h.bins[c][v] * (v + 1);
+    }
+    return s;
+}
+
+// Pool de uma thread só, para medir os kernels sem o ganho das threads.
+ThreadPool &serialPool() {
+    static ThreadPool pool(1);
+    return pool;
+}
+
+FilterChain chainOf(const string &spec, PixelLayout layout = LAYOUT_ANY) {
+    FilterChain c;
+    string error;
+    if (!c.parse(spec, error)) cerr << spec << ": " << error << endl;
+    c.setLayout(layout);
+    return c;
+}
+
+vector<FilterBench> filterBenches() {
+    vector<FilterBench> benches;
+    string threads = "threads(" + to_string(ThreadPool::shared().size()) + ")";
+    SimdLevel best = cpuSimdLevel();
+
+    LumaWeights lw = lumaWeights(0.2125, 0.7154, 0.0721);
+    FilterBench gray{"grayscale", {}};
+    for (int l = SIMD_SCALAR; l <= best; l++) {
+        GrayKernel k = grayKernelFor((SimdLevel)l);
+        gray.variants.push_back({simdLevelName((SimdLevel)l), [=](unsigned char *d, int w, int h) {
+            k(d, (size_t)w * h, lw);
+        }});
+    }
+    gray.variants.push_back({string(simdLevelName(best)) + "+" + threads, [=](unsigned char *d, int w, int h) {
+        GrayKernel k = grayKernelFor(best);
+        parallelPixels(d, w, h, [&](unsigned char *band, size_t n, size_t) { k(band, n, lw); });
+    }});
+    benches.push_back(gray);
+
+    ChromaKeyColor key = chromaKeyColor(0, 255, 0, 0.4);
+    FilterBench chroma{"chromakey", {}};
+    for (int l = SIMD_SCALAR; l <= best; l++) {
+        ChromaKernel k = chromaKernelFor((SimdLevel)l);
+        chroma.variants.push_back({simdLevelName((SimdLevel)l), [=](unsigned char *d, int w, int h) {
+            k(d, (size_t)w * h, key, nullptr);
+        }});
+    }
+    chroma.variants.push_back({string(simdLevelName(best)) + "+" + threads, [=](unsigned char *d, int w, int h) {
+        ChromaKernel k = chromaKernelFor(best);
+        parallelPixels(d, w, h, [&](unsigned char *band, size_t n, size_t) { k(band, n, key, nullptr); });
+    }});
+    benches.push_back(chroma);
+
+    // chroma-key suave: RGB -> RGBA numa passada; os 3/4 iniciais da saída
+    // voltam para a imagem para a comparação entre variantes valer
+    SoftKey soft = softKey(0, 255, 0, 0.2, 0.4, 1.0);
+    auto softRun = [soft](unsigned char *d, int w, int h, SoftKeyKernel k, ThreadPool &pool) {
+        ImageBuffer out = ImagePool::shared().acquire(w, h, 4);
+        softKeyRgba(d, w, h, soft, out.data(), k, pool);
+        memcpy(d, out.data(), (size_t)w * h * 3);
+    };
+    FilterBench softBench{"chromakey suave rgba", {}};
+    for (int l = SIMD_SCALAR; l <= best; l++) {
+        SoftKeyKernel k = softKeyKernelFor((SimdLevel)l);
+        softBench.variants.push_back({simdLevelName((SimdLevel)l), [=](unsigned char *d, int w, int h) {
+            softRun(d, w, h, k, serialPool());
+        }});
+    }
+    softBench.variants.push_back({string(simdLevelName(best)) + "+" + threads, [=](unsigned char *d, int w, int h) {
+        softRun(d, w, h, softKeyKernelFor(best), ThreadPool::shared());
+    }});
+    benches.push_back(softBench);
+
+    FilterChain colorizeLut = chainOf("colorize(40,0,80)", LAYOUT_INTERLEAVED);
+    FilterChain colorizePlanar = chainOf("colorize(40,0,80)", LAYOUT_PLANAR);
+    benches.push_back({"colorize", {
+        {"original", [](unsigned char *d, int w, int h) { colorizeLoop(d, w, h, 40, 0, 80); }},
+        {"lut", [=](unsigned char *d, int w, int h) { colorizeLut.applyPixels(d, (size_t)w * h); }},
+        {"lut+" + threads, [=](unsigned char *d, int w, int h) { colorizeLut.apply(d, w, h); }},
+        {"planar", [=](unsigned char *d, int w, int h) { colorizePlanar.applyPixels(d, (size_t)w * h); }},
+    }});
+
+    // HSL/HSV: kernels sobre planos, com cada bloco de 4096 pixels separado e
+    // juntado como em hueSatRgb; serialPool nas variantes de um nível só
+    auto inPlanes = [](unsigned char *d, int w, int h, ThreadPool &pool,
+                       const function<void(unsigned char *, unsigned char *, unsigned char *, size_t)> &k) {
+        parallelPixels(d, w, h, [&](unsigned char *band, size_t pixels, size_t) {
+            alignas(64) unsigned char planes[3][HSX_BLOCK];
+            for (size_t i = 0; i < pixels; i += HSX_BLOCK) {
+                size_t n = min(pixels - i, HSX_BLOCK);
+                deinterleaveRgb(band + i * 3, n, planes[0], planes[1], planes[2]);
+                k(planes[0], planes[1], planes[2], n);
+                interleaveRgb(planes[0], planes[1], planes[2], n, band + i * 3);
+            }
+        }, pool);
+    };
+    HueSat shift = hueSat(30, 1.2);
+    FilterBench huesat{"huesat(30,1.2)", {}};
+    for (int l = SIMD_SCALAR; l <= best; l++) {
+        HueSatKernel k = hueSatKernelFor((SimdLevel)l);
+        huesat.variants.push_back({simdLevelName((SimdLevel)l), [=](unsigned char *d, int w, int h) {
+            inPlanes(d, w, h, serialPool(), [&](unsigned char *r, unsigned char *g, unsigned char *b, size_t n) {
+                k(r, g, b, n, shift);
+            });
+        }});
+    }
+    huesat.variants.push_back({string(simdLevelName(best)) + "+" + threads, [=](unsigned char *d, int w, int h) {
+        applyHueSat(d, w, h, shift);
+    }});
+    benches.push_back(huesat);
+
+    // colorize em HSL: float como referência; o ponto fixo difere em até 1
+    HueSat tintFloat = hueSat(200, 0.5, true);
+    Tint tintFixed = tint(200, 0.5);
+    FilterBench tinting{"tint(200,0.5)", {}};
+    for (int l = SIMD_SCALAR; l <= best; l++) {
+        HueSatKernel k = hueSatKernelFor((SimdLevel)l);
+        tinting.variants.push_back({string("float ") + simdLevelName((SimdLevel)l), [=](unsigned char *d, int w, int h) {
+            inPlanes(d, w, h, serialPool(), [&](unsigned char *r, unsigned char *g, unsigned char *b, size_t n) {
+                k(r, g, b, n, tintFloat);
+            });
+        }});
+    }
+    for (int l = SIMD_SCALAR; l <= best; l++) {
+        TintKernel k = tintKernelFor((SimdLevel)l);
+        tinting.variants.push_back({string("fixo ") + simdLevelName((SimdLevel)l) + " (±1)", [=](unsigned char *d, int w, int h) {
+            inPlanes(d, w, h, serialPool(), [&](unsigned char *r, unsigned char *g, unsigned char *b, size_t n) {
+                k(r, g, b, n, tintFixed);
+            });
+        }});
+    }
+    tinting.variants.push_back({string("fixo ") + simdLevelName(best) + "+" + threads, [=](unsigned char *d, int w, int h) {
+        applyTint(d, w, h, tintFixed);
+    }});
+    benches.push_back(tinting);
+
+    // ida e volta RGB -> HSV -> RGB (floats num bloco no L1)
+    FilterBench hsv{"rgb->hsv->rgb", {}};
+    for (int l = SIMD_SCALAR; l <= best; l++) {
+        RgbToHsxKernel to = rgbToHsvKernelFor((SimdLevel)l);
+        HsxToRgbKernel from = hsvToRgbKernelFor((SimdLevel)l);
+        hsv.variants.push_back({simdLevelName((SimdLevel)l), [=](unsigned char *d, int w, int h) {
+            inPlanes(d, w, h, serialPool(), [&](unsigned char *r, unsigned char *g, unsigned char *b, size_t n) {
+                alignas(64) float hsx[3][HSX_BLOCK];
+                to(r, g, b, n, hsx[0], hsx[1], hsx[2]);
+                from(hsx[0], hsx[1], hsx[2], n, r, g, b);
+            });
+        }});
+    }
+    benches.push_back(hsv);
+
+    FilterChain negativeLut = chainOf("negative", LAYOUT_INTERLEAVED);
+    FilterChain negativePlanar = chainOf("negative", LAYOUT_PLANAR);
+    benches.push_back({"negative", {
+        {"original", [](unsigned char *d, int w, int h) { negativeLoop(d, w, h); }},
+        {"lut", [=](unsigned char *d, int w, int h) { negativeLut.applyPixels(d, (size_t)w * h); }},
+        {"lut+" + threads, [=](unsigned char *d, int w, int h) { negativeLut.apply(d, w, h); }},
+        {"planar", [=](unsigned char *d, int w, int h) { negativePlanar.applyPixels(d, (size_t)w * h); }},
+    }});
+
+    // ida e volta RGB -> planos -> RGB; a saída tem de ser igual à entrada
+    FilterBench planar{"rgb->planos->rgb", {}};
+    for (int l = SIMD_SCALAR; l <= best; l++) {
+        DeinterleaveKernel split = deinterleaveKernelFor((SimdLevel)l);
+        InterleaveKernel merge = interleaveKernelFor((SimdLevel)l);
+        planar.variants.push_back({simdLevelName((SimdLevel)l), [=](unsigned char *d, int w, int h) {
+            static PlanarImage img;
+            size_t n = (size_t)w * h;
+            if (img.pixels() != n) img.resize(w, h);
+            split(d, n, img.plane(0), img.plane(1), img.plane(2));
+            merge(img.plane(0), img.plane(1), img.plane(2), n, d);
+        }});
+    }
+    benches.push_back(planar);
+
+    // o histograma não altera a imagem; o total vai para histogramSink para
+    // a contagem não ser eliminada pelo compilador
+    benches.push_back({"histograma", {
+        {"1 contador", [](unsigned char *d, int w, int h) { histogramSink = sumBins(histogramLoop(d, (size_t)w * h)); }},
+        {"4 contadores", [](unsigned char *d, int w, int h) {
+            Histogram hist;
+            {
+                HistogramAccumulator acc(hist);
+                acc.add(d, (size_t)w * h);
+            }
+            histogramSink = sumBins(hist);
+        }},
+        {"4 contadores+" + threads, [](unsigned char *d, int w, int h) {
+            histogramSink = sumBins(computeHistogram(d, (size_t)w * h));
+        }},
+    }});
+
+    // equalização: ferramenta separada (lê a imagem duas vezes) contra a cadeia
+    FilterChain equalize = chainOf("equalize");
+    benches.push_back({"equalize", {
+        {"histograma + lut", [](unsigned char *d, int w, int h) {
+            unsigned char lut[3][256];
+            equalizeLut(histogramLoop(d, (size_t)w * h), lut);
+            for (size_t i = 0; i < (size_t)w * h * 3; i += 3) {
+                d[i] = lut[0][d[i]];
+                d[i+1] = lut[1][d[i+1]];
+                d[i+2] = lut[2][d[i+2]];
+            }
+        }},
+        {"cadeia", [=](unsigned char *d, int w, int h) { equalize.applyPixels(d, (size_t)w * h); }},
+        {"cadeia+" + threads, [=](unsigned char *d, int w, int h) { equalize.apply(d, w, h); }},
+    }});
+
+    // desfoque separável: o mesmo kernel de convolução nas duas passadas
+    struct BlurCase {
+        string name;
+        BlurWeights weights;
+    };
+    for (const BlurCase &bc : {BlurCase{"blur sigma=2", gaussianWeights(2)},
+                               BlurCase{"blur sigma=8", gaussianWeights(8)},
+                               BlurCase{"boxblur r=4", boxWeights(4)}}) {
+        FilterBench fb{bc.name, {}};
+        BlurWeights bw = bc.weights;
+        for (int l = SIMD_SCALAR; l <= best; l++) {
+            ConvolveKernel k = convolveKernelFor((SimdLevel)l);
+            fb.variants.push_back({simdLevelName((SimdLevel)l), [=](unsigned char *d, int w, int h) {
+                separableBlur(d, w, h, 3, bw, k, serialPool());
+            }});
+        }
+        fb.variants.push_back({string(simdLevelName(best)) + "+" + threads, [=](unsigned char *d, int w, int h) {
+            separableBlur(d, w, h, 3, bw, convolveKernelFor(best));
+        }});
+        benches.push_back(fb);
+    }
+
+    // caixa de raio grande: média pela tabela de somas, de custo fixo por
+    // pixel, contra a convolução separável (2r+1 taps por passada), que
+    // arredonda os pesos em Q14 e por isso sai DIFERENTE em alguns pixels
+    FilterBench bigBox{"boxblur r=32", {}};
+    for (int l = SIMD_SCALAR; l <= best; l++) {
+        BoxMeanKernel k = boxMeanKernelFor((SimdLevel)l);
+        string name = string("tabela ") + simdLevelName((SimdLevel)l);
+        bigBox.variants.push_back({name, [=](unsigned char *d, int w, int h) {
+            boxMean(d, (size_t)w * 3, w, h, 3, 32, k, serialPool());
+        }});
+    }
+    bigBox.variants.push_back({string("tabela+") + threads, [=](unsigned char *d, int w, int h) {
+        boxMean(d, (size_t)w * 3, w, h, 3, 32, boxMeanKernelFor(best));
+    }});
+    BlurWeights box32 = boxWeights(32);
+    bigBox.variants.push_back({string("2 passadas ") + simdLevelName(best), [=](unsigned char *d, int w, int h) {
+        separableBlur(d, w, h, 3, box32, convolveKernelFor(best), serialPool());
+    }});
+    benches.push_back(bigBox);
+
+    // redimensionamento para um terço (miniatura); o resultado volta para o
+    // começo da imagem para a comparação entre variantes valer
+    struct ResizeCase {
+        string name;
+        ResizeFilter filter;
+    };
+    for (const ResizeCase &rc : {ResizeCase{"resize 1/3 bilinear", RESIZE_BILINEAR},
+                                 ResizeCase{"resize 1/3 lanczos3", RESIZE_LANCZOS3}}) {
+        FilterBench fb{rc.name, {}};
+        ResizeFilter f = rc.filter;
+        auto thumb = [f](unsigned char *d, int w, int h, ResampleKernel rows, ConvolveKernel conv, ThreadPool &pool) {
+            int tw = w / 3, th = h / 3;
+            ImageBuffer out = ImagePool::shared().acquire(tw, th);
+            resizeImage(d, w, h, out.data(), tw, th, 3, f, rows, conv, pool);
+            memcpy(d, out.data(), (size_t)tw * th * 3);
+        };
+        for (int l = SIMD_SCALAR; l <= best; l++) {
+            ResampleKernel rows = resampleKernelFor((SimdLevel)l);
+            ConvolveKernel conv = convolveKernelFor((SimdLevel)l);
+            fb.variants.push_back({simdLevelName((SimdLevel)l), [=](unsigned char *d, int w, int h) {
+                thumb(d, w, h, rows, conv, serialPool());
+            }});
+        }
+        fb.variants.push_back({string(simdLevelName(best)) + "+" + threads, [=](unsigned char *d, int w, int h) {
+            thumb(d, w, h, resampleKernelFor(best), convolveKernelFor(best), ThreadPool::shared());
+        }});
+        benches.push_back(fb);
+    }
+
+    // rotação de 90 graus: a referência percorre a saída linha a linha e lê a
+    // origem coluna a coluna, sem ladrilhos; o resultado volta para d
+    auto rotate = [](unsigned char *d, int w, int h, TransposeKernel k, ThreadPool &pool) {
+        ImageBuffer out = ImagePool::shared().acquire(h, w);
+        transformImage(d, w, h, 3, TRANSFORM_ROTATE_90, out.data(), k, reverseKernelFor(SIMD_SCALAR), pool);
+        memcpy(d, out.data(), (size_t)w * h * 3);
+    };
+    FilterBench rot{"rotate 90", {}};
+    rot.variants.push_back({"ingênuo", [](unsigned char *d, int w, int h) {
+        ImageBuffer out = ImagePool::shared().acquire(h, w);
+        unsigned char *o = out.data();
+        for (int x = 0; x < w; x++) {
+            for (int y = 0; y < h; y++, o += 3) memcpy(o, d + ((size_t)(h - 1 - y) * w + x) * 3, 3);
+        }
+        memcpy(d, out.data(), (size_t)w * h * 3);
+    }});
+    for (int l = SIMD_SCALAR; l <= best; l++) {
+        TransposeKernel k = transposeKernelFor((SimdLevel)l);
+        rot.variants.push_back({simdLevelName((SimdLevel)l), [=](unsigned char *d, int w, int h) {
+            rotate(d, w, h, k, serialPool());
+        }});
+    }
+    rot.variants.push_back({string(simdLevelName(best)) + "+" + threads, [=](unsigned char *d, int w, int h) {
+        rotate(d, w, h, transposeKernelFor(best), ThreadPool::shared());
+    }});
+    benches.push_back(rot);
+
+    FilterBench flip{"fliph no lugar", {}};
+    for (int l = SIMD_SCALAR; l <= best; l++) {
+        ReverseKernel k = reverseKernelFor((SimdLevel)l);
+        flip.variants.push_back({simdLevelName((SimdLevel)l), [=](unsigned char *d, int w, int h) {
+            transformInPlace(d, w, h, 3, TRANSFORM_FLIP_H, k, serialPool());
+        }});
+    }
+    flip.variants.push_back({string(simdLevelName(best)) + "+" + threads, [=](unsigned char *d, int w, int h) {
+        transformInPlace(d, w, h, 3, TRANSFORM_FLIP_H, reverseKernelFor(best));
+    }});
+    benches.push_back(flip);
+
+    // redução a 16 cores: paleta e difusão de erro com uma thread e com
+    // todas (frente de onda); o resultado não depende do número de threads
+    auto reduce = [](unsigned char *d, int w, int h, PaletteMethod pm, DitherMethod dm, ThreadPool &pool) {
+        Palette pal = buildPalette(d, (size_t)w * h, 16, pm, pool);
+        ditherImage(d, w, h, pal, dm, pool);
+    };
+    const struct { const char *name; PaletteMethod pm; DitherMethod dm; } reductions[] = {
+        {"paleta kmeans 16", PALETTE_KMEANS, DITHER_NONE},
+        {"dither fs 16", PALETTE_MEDIAN_CUT, DITHER_FLOYD_STEINBERG},
+        {"dither atkinson 16", PALETTE_MEDIAN_CUT, DITHER_ATKINSON},
+    };
+    for (const auto &r : reductions) {
+        PaletteMethod pm = r.pm;
+        DitherMethod dm = r.dm;
+        benches.push_back({r.name, {
+            {"serial", [=](unsigned char *d, int w, int h) { reduce(d, w, h, pm, dm, serialPool()); }},
+            {threads, [=](unsigned char *d, int w, int h) { reduce(d, w, h, pm, dm, ThreadPool::shared()); }},
+        }});
+    }
+
+    // comparação da imagem com ela mesma deslocada uma linha (só lê; o
+    // resultado vai para histogramSink para não ser descartado)
+    FilterBench diff{"compare mse", {}};
+    for (int l = SIMD_SCALAR; l <= best; l++) {
+        DiffKernel k = diffKernelFor((SimdLevel)l);
+        diff.variants.push_back({simdLevelName((SimdLevel)l), [=](unsigned char *d, int w, int h) {
+            histogramSink = diffImages(d, d + (size_t)w * 3, w, h - 1, k, serialPool()).maxDiff;
+        }});
+    }
+    diff.variants.push_back({string(simdLevelName(best)) + "+" + threads, [=](unsigned char *d, int w, int h) {
+        histogramSink = diffImages(d, d + (size_t)w * 3, w, h - 1, diffKernelFor(best)).maxDiff;
+    }});
+    benches.push_back(diff);
+
+    FilterBench ssim{"compare ssim 8x8", {}};
+    for (SimdLevel l : {SIMD_SCALAR, SIMD_AVX2}) {
+        if (l > best) continue;
+        SsimRowKernel k = ssimKernelFor(l);
+        ssim.variants.push_back({simdLevelName(l), [=](unsigned char *d, int w, int h) {
+            histogramSink = (size_t)(ssimImages(d, d + (size_t)w * 3, w, h - 1, 8, k, serialPool()) * 1000);
+        }});
+    }
+    ssim.variants.push_back({string(simdLevelName(best)) + "+" + threads, [=](unsigned char *d, int w, int h) {
+        histogramSink = (size_t)(ssimImages(d, d + (size_t)w * 3, w, h - 1, 8, ssimKernelFor(best)) * 1000);
+    }});
+    benches.push_back(ssim);
+
+    // LUT 3D 33^3 com uma curva qualquer; o SSSE3 não tem gather e usa a escalar
+    shared_ptr<CubeLut> grade = make_shared<CubeLut>();
+    grade->generate(33, [](double r, double g, double b, double out[3]) {
+        out[0] = pow(r, 0.8) * 0.9 + 0.08 * b;
+        out[1] = g * g * 0.7 + 0.3 * g;
+        out[2] = 0.2 * r + 0.3 * g + 0.5 * sqrt(b);
+    });
+    FilterBench cube{"lut3d 33", {}};
+    for (int l = SIMD_SCALAR; l <= best; l++) {
+        if (l == SIMD_SSSE3) continue;
+        CubeLutKernel k = cubeLutKernelFor((SimdLevel)l);
+        cube.variants.push_back({simdLevelName((SimdLevel)l), [=](unsigned char *d, int w, int h) {
+            alignas(64) static unsigned char planes[3][4096];
+            size_t pixels = (size_t)w * h;
+            for (size_t i = 0; i < pixels; i += 4096) {
+                size_t n = pixels - i < 4096 ? pixels - i : 4096;
+                deinterleaveRgb(d + i * 3, n, planes[0], planes[1], planes[2]);
+                k(planes[0], planes[1], planes[2], n, *grade);
+                interleaveRgb(planes[0], planes[1], planes[2], n, d + i * 3);
+            }
+        }});
+    }
+    cube.variants.push_back({string(simdLevelName(best)) + "+" + threads, [=](unsigned char *d, int w, int h) {
+        applyCubeLut(d, w, h, *grade);
+    }});
+    benches.push_back(cube);
+
+    // buffer por quadro: o custo de alocar e tocar as páginas de uma imagem
+    // nova a cada arquivo, contra reaproveitar o bloco do pool
+    benches.push_back({"buffer de quadro", {
+        {"new[] por quadro", [](unsigned char *d, int w, int h) {
+            size_t n = (size_t)w * h * 3;
+            unsigned char *p = new unsigned char [n];
+            memcpy(p, d, n);
+            histogramSink = p[n - 1];
+            delete [] p;
+        }},
+        {"ImagePool", [](unsigned char *d, int w, int h) {
+            size_t n = (size_t)w * h * 3;
+            ImageBuffer p = ImagePool::shared().acquire(w, h);
+            memcpy(p.data(), d, n);
+            histogramSink = p.data()[n - 1];
+        }},
+    }});
+
+    // cadeia: três passadas separadas contra a passada única fundida
+    FilterChain fused = chainOf("grayscale | colorize(40,0,80) | negative");
+    FilterChain fusedRgb = chainOf("grayscale | colorize(40,0,80) | negative", LAYOUT_INTERLEAVED);
+    FilterChain fusedPlanar = chainOf("grayscale | colorize(40,0,80) | negative", LAYOUT_PLANAR);
+    benches.push_back({"cadeia gray|colorize|neg", {
+        {"3 passadas", [=](unsigned char *d, int w, int h) {
+            grayScaleScalar(d, (size_t)w * h, lw);
+            colorizeLoop(d, w, h, 40, 0, 80);
+            negativeLoop(d, w, h);
+        }},
+        {"fundida", [=](unsigned char *d, int w, int h) { fused.applyPixels(d, (size_t)w * h); }},
+        {"fundida intercalada", [=](unsigned char *d, int w, int h) { fusedRgb.applyPixels(d, (size_t)w * h); }},
+        {"fundida planar", [=](unsigned char *d, int w, int h) { fusedPlanar.applyPixels(d, (size_t)w * h); }},
+        {"fundida+" + threads, [=](unsigned char *d, int w, int h) { fused.apply(d, w, h); }},
+    }});
+    return benches;
+}
+
+// Os filtros são in-place: as repetições rodam sobre a saída da anterior.
+// Todos os kernels medidos não têm desvios dependentes do dado (exceto os
+// laços escalares), então isso não muda o custo de forma relevante.
+void runFilterBench(const FilterBench &fb, const BenchSize &size, int reps) {
+    size_t pixels = (size_t)size.w * size.h;
+    double bytes = (double)pixels * 3;
+    vector<unsigned char> src = syntheticImage(size.w, size.h);
+    vector<unsigned char> ref = src;
+    fb.variants[0].run(ref.data(), size.w, size.h);
+
+    for (const Variant &v : fb.variants) {
+        vector<unsigned char> img = src;
+        v.run(img.data(), size.w, size.h);
+        bool same = img == ref;
+        img = src;
+        Timing t = measure(3, reps, [&]() { v.run(img.data(), size.w, size.h); });
+        printf("%-26s %-20s %-5s %10.3f %10.3f %10.3f%s\n", fb.name.c_str(), v.name.c_str(), size.name,
+               t.median * 1e6 / pixels, t.p95 * 1e6 / pixels, bytes / (t.median * 1e-3) / 1e9,
+               same ? "" : "  DIFERENTE");
+    }
+}
+
+// Tempo ponta a ponta da cadeia: na CPU (fundida + threads) e na GPU, com a
+// cópia para a textura e a leitura de volta incluídas.
+void benchGpu(const string &onlySize, const string &onlyFilter, int reps) {
+    const char *specs[] = {
+        "negative",
+        "grayscale | colorize(40,0,80) | negative",
+        "chromakey(0,255,0,0.4) | grayscale",
+    };
+    cout << "== GPU contra CPU (" << reps << " repetições)" << endl;
+    auto t0 = chrono::steady_clock::now();
+    string error;
+    if (!GpuContext::ensure(error)) {
+        cout << "(GPU não medida: " << error << ")" << endl;
+        return;
+    }
+    printf("GPU: %s (contexto em %.1f ms)\n", GpuContext::renderer().c_str(),
+           chrono::duration<double, milli>(chrono::steady_clock::now() - t0).count());
+    printf("%-40s %-5s %12s %12s %8s\n", "cadeia", "dados", "CPU ns/px", "GPU ns/px", "GPU/CPU");
+    for (const char *spec : specs) {
+        if (!onlyFilter.empty() && string(spec).find(onlyFilter) == string::npos) continue;
+        FilterChain chain = chainOf(spec);
+        GpuFilter gpu;
+        if (!gpu.init(chain, error)) {
+            cout << spec << ": " << error << endl;
+            continue;
+        }
+        for (const BenchSize &size : SIZES) {
+            if (!onlySize.empty() && onlySize != size.name) continue;
+            size_t pixels = (size_t)size.w * size.h;
+            vector<unsigned char> src = syntheticImage(size.w, size.h);
+            vector<unsigned char> cpuImg = src, gpuImg = src;
+            vector<unsigned char> cpuMask(pixels), gpuMask(pixels);
+            chain.apply(cpuImg.data(), size.w, size.h, cpuMask.data());
+            bool same = gpu.apply(gpuImg.data(), size.w, size.h, gpuMask.data())
+                        && cpuImg == gpuImg && cpuMask == gpuMask;
+            cpuImg = src;
+            gpuImg = src;
+            Timing cpu = measure(1, reps, [&]() { chain.apply(cpuImg.data(), size.w, size.h, cpuMask.data()); });
+            Timing gt = measure(1, reps, [&]() { gpu.apply(gpuImg.data(), size.w, size.h, gpuMask.data()); });
+            printf("%-40s %-5s %12.3f %12.3f %8.2f%s\n", spec, size.name, cpu.median * 1e6 / pixels,
+                   gt.median * 1e6 / pixels, gt.median / cpu.median, same ? "" : "  DIFERENTE");
+        }
+    }
+}
+
+int main(int argc, char **argv) {
+    string file = "../src/ExemplosMoodle/M3_material/M3_exemplo1.ppm";
+    string onlySize, onlyFilter;
+    int reps = 15;
+    bool gpu = false;
+    for (int i = 1; i < argc; i++) {
+        string a = argv[i];
+        if (a == "-r" && i + 1 < argc) {
+            reps = atoi(argv[++i]);
+            if (reps < 1) reps = 1;
+        } else if (a == "-s" && i + 1 < argc) {
+            onlySize = argv[++i];
+        } else if (a == "-f" && i + 1 < argc) {
+            onlyFilter = argv[++i];
+        } else if (a == "--gpu") {
+            gpu = true;
+        } else {
+            file = a;
+        }
+    }
+
+    cout << "CPU: " << simdLevelName(cpuSimdLevel()) << ", " << ThreadPool::shared().size() << " thread(s)" << endl;
+    if (onlyFilter.empty()) {
+        benchLoaders(file, reps < 5 ? reps : 5);
+    }
+
+    cout << "== Filtros (" << reps << " repetições)" << endl;
+    printf("%-26s %-20s %-5s %10s %10s %10s\n", "filtro", "variante", "dados", "ns/px", "ns/px p95", "GB/s");
+    for (const FilterBench &fb : filterBenches()) {
+        if (!onlyFilter.empty() && fb.name.find(onlyFilter) == string::npos) continue;
+        for (const BenchSize &size : SIZES) {
+            if (!onlySize.empty() && onlySize != size.name) continue;
+            runFilterBench(fb, size, reps);
+        }
+    }
+    if (gpu) benchGpu(onlySize, onlyFilter, reps);
+    return EXIT_SUCCESS;
+}
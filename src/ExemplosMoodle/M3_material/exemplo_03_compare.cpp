@@ -0,0 +1,136 @@
+//
+//  exemplo_03_compare
+//  Compara duas imagens (ou duas pastas, arquivo a arquivo pelo nome) e
+//  mostra MSE e PSNR por canal, a maior diferença, quantos pixels mudaram
+//  e o SSIM da luma. Serve para conferir uma variante otimizada de um
+//  filtro contra a saída da versão de referência: com --min-psnr,
+//  --min-ssim ou --max-diff o programa termina com erro se algum par não
+//  passar.
+//
+//  Uso: exemplo_03_compare [--heatmap saida] [--gain N] [--window N]
+//                          [--min-psnr dB] [--min-ssim S] [--max-diff N] a b
+//
+
+#include <filesystem>
+#include <iostream>
+#include <string>
+#include <vector>
+#include <math.h>
+#include <stdio.h>
+#include <stdlib.h>
+
+#define STB_IMAGE_IMPLEMENTATION
+#include "ImageIO.h"
+#include "PpmIO.h"
+#include "ImageBuffer.h"
+#include "ImageCompare.h"
+
+using namespace std;
+
+struct CompareOptions {
+    string a, b;
+    string heatmap;     // arquivo (ou pasta, comparando pastas) do mapa de diferença
+    double gain = 8;    // ganho do mapa: diferenças pequenas ficam visíveis
+    int window = 8;     // lado da janela do SSIM
+    double minPsnr = 0; // 0 = sem limite
+    double minSsim = -1;
+    int maxDiff = 255;
+};
+
+void usage(const char *prog) {
+    cout << "Uso: " << prog << " [--heatmap saida] [--gain N] [--window N] [--min-psnr dB] [--min-ssim S] [--max-diff N] a b" << endl
+         << "  a, b        imagens (PPM, PNG, JPEG, TGA ou BMP) ou pastas, comparadas arquivo a arquivo pelo nome" << endl
+         << "  --heatmap   grava o mapa de diferença (com pastas, uma pasta com <nome>_diff.ppm)" << endl
+         << "  --gain      multiplica as diferenças no mapa (padrão: 8)" << endl
+         << "  --window    lado da janela do SSIM, 1..256 (padrão: 8)" << endl
+         << "  --min-psnr, --min-ssim, --max-diff: falha (código 1) se algum par não atingir o limite" << endl;
+}
+
+bool parseArgs(int argc, char **argv, CompareOptions &opt) {
+    vector<string> files;
+    for (int i = 1; i < argc; i++) {
+        string a = argv[i];
+        bool hasValue = i + 1 < argc;
+        if (a == "--heatmap" && hasValue) {
+            opt.heatmap = argv[++i];
+        } else if (a == "--gain" && hasValue) {
+            opt.gain = atof(argv[++i]);
+            if (opt.gain <= 0) return false;
+        } else if (a == "--window" && hasValue) {
+            opt.window = atoi(argv[++i]);
+            if (opt.window < 1 || opt.window > SSIM_MAX_WINDOW) return false;
+        } else if (a == "--min-psnr" && hasValue) {
+            opt.minPsnr = atof(argv[++i]);
+        } else if (a == "--min-ssim" && hasValue) {
+            opt.minSsim = atof(argv[++i]);
+        } else if (a == "--max-diff" && hasValue) {
+            opt.maxDiff = atoi(argv[++i]);
+        } else if (!a.empty() && a[0] == '-') {
+            return false;
+        } else {
+            files.push_back(a);
+        }
+    }
+    if (files.size() != 2) return false;
+    opt.a = files[0];
+    opt.b = files[1];
+    return true;
+}
+
+// 0: igual ou dentro dos limites; 1: fora dos limites; 2: erro de leitura.
+int comparePair(const CompareOptions &opt, const string &pathA, const string &pathB, const string &heatmap) {
+    ImageBuffer a, b;
+    if (!loadImage(pathA, a) || !loadImage(pathB, b)) return 2;
+    int w = a.getWidth(), h = a.getHeight();
+    if (w != b.getWidth() || h != b.getHeight()) {
+        printf("%-40s tamanhos diferentes: %dx%d e %dx%d\n", pathA.c_str(), w, h, b.getWidth(), b.getHeight());
+        return 1;
+    }
+    ImageComparison r = compareImages(a.data(), b.data(), w, h, opt.window);
+    printf("%-40s PSNR %6.2f dB (R %6.2f G %6.2f B %6.2f)  MSE %8.3f  SSIM %.5f  máx %3d  %zu pixel(s) diferente(s)\n",
+           pathA.c_str(), r.psnr(), r.psnr(r.mse(0)), r.psnr(r.mse(1)), r.psnr(r.mse(2)), r.mse(), r.ssim,
+           r.diff.maxDiff, r.diff.differing);
+    if (!heatmap.empty()) {
+        ImageBuffer map = ImagePool::shared().acquire(w, h);
+        diffHeatmap(a.data(), b.data(), w, h, opt.gain, map.data());
+        if (!savePPM(heatmap, map.data(), w, h)) cerr << "Não foi possível gravar " << heatmap << endl;
+    }
+    bool ok = r.psnr() >= opt.minPsnr && r.ssim >= opt.minSsim && r.diff.maxDiff <= opt.maxDiff;
+    return ok ? 0 : 1;
+}
+
+int main(int argc, char **argv) {
+    namespace fs = std::filesystem;
+    CompareOptions opt;
+    if (!parseArgs(argc, argv, opt)) {
+        usage(argv[0]);
+        return 2;
+    }
+    error_code ec;
+    if (!fs::is_directory(opt.a, ec)) {
+        return comparePair(opt, opt.a, opt.b, opt.heatmap);
+    }
+
+    // pastas: cada imagem de a contra a de mesmo nome em b
+    vector<fs::path> names;
+    for (const fs::directory_entry &e : fs::directory_iterator(opt.a, ec)) {
+        if (e.is_regular_file(ec) && isImageExtension(e.path().extension().string())) {
+            names.push_back(e.path().filename());
+        }
+    }
+    sort(names.begin(), names.end());
+    if (!opt.heatmap.empty()) fs::create_directories(opt.heatmap, ec);
+    int worst = 0;
+    size_t failed = 0;
+    for (const fs::path &name : names) {
+        string heatmap;
+        if (!opt.heatmap.empty()) {
+            heatmap = (fs::path(opt.heatmap) / (name.stem().string() + "_diff.ppm")).string();
+        }
+        int r = comparePair(opt, (fs::path(opt.a) / name).string(), (fs::path(opt.b) / name).string(), heatmap);
+        if (r != 0) failed++;
+        worst = max(worst, r);
+    }
+    printf("Total: %zu par(es), %zu fora dos limites ou com erro\n", names.size(), failed);
+    return worst;
+}